@@ -56,12 +56,12 @@ class CBMP
 public:
 	static CBMP* LoadFile( const char *filename ); // implemented in library!
 	
-	CBMP( uint w, uint h )
+	// pixel_size is 4 for RGBA or 1 for palettized image
+	CBMP( uint w, uint h, uint pixel_size = 4 )
 	{
 		bmp_t bhdr;
 
-		const size_t cbPalBytes = 0; // UNUSED
-		const uint pixel_size = 4; // Always RGBA
+		const size_t cbPalBytes = ( pixel_size == 1 ) ? 256 * sizeof( rgbquad_t ) : 0;
 
 		bhdr.id[0] = 'B';
 		bhdr.id[1] = 'M';
@@ -93,7 +93,7 @@ public:
 		bmp_t *hdr = GetBitmapHdr();
 		bmp_t bhdr;
 
-		const int pixel_size = 4; // create 32 bit image everytime
+		const int pixel_size = GetPixelSize(); // keep format
 
 		memcpy( &bhdr, hdr, sizeof( bhdr ));
 
@@ -107,6 +107,7 @@ public:
 		assert( bhdr.height >= hdr->height );
 
 		byte *newData = new byte[bhdr.fileSize];
+		memcpy( newData, data, bhdr.bitmapDataOffset ); // with palette
 		memcpy( newData, &bhdr, sizeof( bhdr ));
 		memset( newData + bhdr.bitmapDataOffset, 0, bhdr.bitmapDataSize );
 	
@@ -117,10 +118,10 @@ public:
 		// to keep texcoords still valid, we copy old texture through the end
 		for( int y = 0; y < hdr->height; y++ )
 		{
-			byte *ydst = &dst[(y + (bhdr.height - hdr->height))* bhdr.width * 4];
-			byte *ysrc = &src[y * hdr->width * 4];
+			byte *ydst = &dst[(y + (bhdr.height - hdr->height))* bhdr.width * pixel_size];
+			byte *ysrc = &src[y * hdr->width * pixel_size];
 
-			memcpy( ydst, ysrc, 4 * hdr->width );
+			memcpy( ydst, ysrc, pixel_size * hdr->width );
 		}
 
 		delete []data;
@@ -166,6 +167,11 @@ public:
 		return GetBitmapHdr()->bitmapDataSize;
 	}
 
+	inline int GetPixelSize()
+	{
+		return GetBitmapHdr()->bitsPerPixel / 8;
+	}
+
 	inline rgbquad_t *GetPaletteData()
 	{
 		// palette is always right after header
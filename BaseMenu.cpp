@@ -28,6 +28,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "YesNoMessageBox.h"
 #include "BackgroundBitmap.h"
 #include "FontManager.h"
+#include "TextLayout.h"
+#include "DrawTrace.h"
+#include "Profiler.h"
+#include "DrawList.h"
 #ifdef CS16CLIENT
 #include "Scoreboard.h"
 #endif
@@ -276,6 +280,63 @@ void UI_DrawRectangleExt( int in_x, int in_y, int in_w, int in_h, const unsigned
 	}
 }
 
+/*
+=================
+UI_LayoutString
+
+Breaks string to lines and decodes characters and color codes,
+so drawing is just a replay of glyphs
+=================
+*/
+static void UI_LayoutString( textlayout_t *layout, HFont font, const char *string, int w, int charH, uint flags, bool multiline )
+{
+	CUtlVector<textbreak_t> lines;
+	int	ch, prev;
+
+	g_FontMgr->BreakLines( font, string, charH, w, multiline, !(flags & ETF_NOSIZELIMIT), lines );
+
+	for( int i = 0; i < lines.Count(); i++ )
+	{
+		const char *l = string + lines[i].start;
+		const char *end = string + lines[i].end;
+
+		layout->AddLine( lines[i].pixelWide );
+		prev = 0;
+
+		// decode it
+		while( l < end )
+		{
+			int len;
+
+			if( l + 1 < end && IsColorString( l ))
+			{
+				layout->AddGlyph( 0, ColorIndex( *(l+1) ));
+
+				l += 2;
+				continue;
+			}
+
+// when using custom font render, we use utf-8
+			ch = Utf8_Decode( l, len );
+			l += len;
+
+			if( !ch )
+				continue;
+
+			// same pairs as in BreakLines, so line is as wide as it was measured
+			layout->AddGlyph( ch, 0, g_FontMgr->GetKerningScaled( font, prev, ch, charH ));
+			prev = ch;
+		}
+
+		if( lines[i].ellipsis )
+		{
+			layout->AddGlyph( '.' );
+			layout->AddGlyph( '.' );
+			layout->AddGlyph( '.' );
+		}
+	}
+}
+
 /*
 =================
 UI_DrawString
@@ -286,12 +347,23 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 		int charH, uint justify, uint flags )
 {
 	uint	modulate, shadowModulate = 0;
-	int	xx = 0, yy, ofsX = 0, ofsY = 0, ch;
+	int	xx = 0, yy, ofsX = 0, ofsY = 0;
 	int maxX = x;
 
 	if( !string || !string[0] )
 		return x;
 
+	// layout doesn't depend on vertical position, only on
+	// whether there is free space for another line
+	bool multiline = h > charH;
+	textlayout_t *layout = TextLayout_Find( font, string, w, charH, flags, multiline );
+
+	if( !layout )
+	{
+		layout = TextLayout_Alloc( font, string, w, charH, flags, multiline );
+		UI_LayoutString( layout, font, string, w, charH, flags, multiline );
+	}
+
 	if( flags & ETF_SHADOW )
 	{
 		shadowModulate = PackAlpha( uiColorBlack, UnpackAlpha( color ));
@@ -314,119 +386,12 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 		yy = y + (h - charH)/2;
 	}
 
-	int i = 0;
-	int ellipsisWide = g_FontMgr->GetEllipsisWide( font );
-	bool giveup = false;
+	// shadows and glyphs of whole string are submitted at once
+	g_FontMgr->BeginTextBatch();
 
-	while( string[i] && !giveup )
+	for( int i = 0; i < layout->lines.Count(); i++ )
 	{
-		char line[1024], *l;
-		int j = i, len = 0;
-		int pixelWide = 0;
-		int save_pixelWide = 0;
-		int save_j = 0;
-
-		EngFuncs::UtfProcessChar( 0 );
-		while( string[j] )
-		{
-			if( string[j] == '\n' )
-			{
-				j++;
-				break;
-			}
-
-			if( len == sizeof( line ) - 1 )
-				break;
-
-			line[len] = string[j];
-
-			int uch = EngFuncs::UtfProcessChar( ( unsigned char )string[j] );
-
-			if( IsColorString( string + j )) // don't calc wides for colorstrings
-			{
-				line[len+1] = string[j+1];
-				len += 2;
-				j += 2;
-			}
-			else if( !uch ) // don't calc wides for invalid codepoints
-			{
-				len++;
-				j++;
-			}
-			else
-			{
-				int charWide;
-
-				// does we have free space for new line?
-				if( yy < (yy + h ) - charH )
-				{
-					if( uch == ' ' && pixelWide < w ) // remember last whitespace
-					{
-						save_pixelWide = pixelWide;
-						save_j = j;
-					}
-				}
-				else
-				{
-					// remember last position, when we still fit
-					if( pixelWide + ellipsisWide < w && j > 0 )
-					{
-						save_pixelWide = pixelWide;
-						save_j = j;
-					}
-				}
-
-				charWide = g_FontMgr->GetCharacterWidthScaled( font, uch, charH );
-
-				if( !(flags & ETF_NOSIZELIMIT) && pixelWide + charWide > w )
-				{
-					// do we have free space for new line?
-					if( yy < (yy + h) - charH )
-					{
-						// try to word wrap
-						if( save_j != 0 && save_pixelWide != 0 )
-						{
-							pixelWide = save_pixelWide;
-							len -= j - save_j; // skip whitespace
-							j = save_j + 1; // skip whitespace
-						}
-
-						break;
-					}
-					else
-					{
-
-						if( save_j != 0 && save_pixelWide != 0 )
-						{
-							pixelWide = save_pixelWide;
-							len -= j - save_j;
-							j = save_j;
-
-
-							if( len > 0 )
-							{
-								line[len] = '.';
-								line[len+1] = '.';
-								line[len+2] = '.';
-								len += 3;
-							}
-						}
-
-						// we don't have free space anymore, so just stop drawing
-						giveup = true;
-
-						break;
-					}
-				}
-				else
-				{
-					pixelWide += charWide;
-					j++;
-					len++;
-				}
-			}
-		}
-		line[len] = 0;
+		const textline_t &line = layout->lines[i];
 
 		// align the text as appropriate
 		if( justify & QM_LEFT  )
@@ -435,45 +400,36 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 		}
 		else if( justify & QM_RIGHT )
 		{
-			xx = x + (w - pixelWide);
+			xx = x + (w - line.pixelWide);
 		}
 		else // QM_LEFT
 		{
-			xx = x + (w - pixelWide) / 2.0f;
+			xx = x + (w - line.pixelWide) / 2.0f;
 		}
 
 		// draw it
-		l = line;
-		EngFuncs::UtfProcessChar( 0 );
-		while( *l )
+		for( int j = line.firstGlyph; j < line.firstGlyph + line.numGlyphs; j++ )
 		{
-			if( IsColorString( l ))
-			{
-				int colorNum = ColorIndex( *(l+1) );
+			textglyph_t &glyph = layout->glyphs[j];
+			int ch = glyph.ch;
 
-				if( colorNum == 7 && color != 0 )
+			if( !ch )
+			{
+				if( glyph.color == 7 && color != 0 )
 				{
 					modulate = color;
 				}
 				else if( !(flags & ETF_FORCECOL) )
 				{
-					modulate = PackAlpha( g_iColorTable[colorNum], UnpackAlpha( color ));
+					modulate = PackAlpha( g_iColorTable[glyph.color], UnpackAlpha( color ));
 				}
-
-				l += 2;
 				continue;
 			}
 
-			ch = *l++;
-			ch &= 255;
-
-// when using custom font render, we use utf-8
-			ch = EngFuncs::UtfProcessChar( (unsigned char) ch );
-			if( !ch )
-				continue;
+			xx += glyph.kern;
 
 			if( flags & ETF_SHADOW )
-				g_FontMgr->DrawCharacter( font, ch, Point( xx + ofsX, yy + ofsY ), charH, shadowModulate, flags & ETF_ADDITIVE );
+				g_FontMgr->DrawCharacter( font, ch, Point( xx + ofsX, yy + ofsY ), charH, shadowModulate, flags & ETF_ADDITIVE, true );
 
 #ifdef DEBUG_WHITESPACE
 			if( ch == ' ' )
@@ -484,16 +440,22 @@ int UI_DrawString( HFont font, int x, int y, int w, int h,
 			}
 #endif
 
-			xx += g_FontMgr->DrawCharacter( font, ch, Point( xx, yy ), charH, modulate, flags & ETF_ADDITIVE );
+			// advance isn't always the measured width, so take it from first draw
+			if( layout->measured )
+				g_FontMgr->DrawCharacter( font, ch, Point( xx, yy ), charH, modulate, flags & ETF_ADDITIVE );
+			else
+				glyph.advance = g_FontMgr->DrawCharacter( font, ch, Point( xx, yy ), charH, modulate, flags & ETF_ADDITIVE );
+
+			xx += glyph.advance;
 
 			maxX = Q_max( xx, maxX );
 		}
 		yy += charH;
-
-		i = j;
 	}
 
-	EngFuncs::UtfProcessChar( 0 );
+	layout->measured = true;
+
+	g_FontMgr->EndTextBatch();
 
 	return maxX;
 }
@@ -601,13 +563,14 @@ void UI_CloseMenu( void )
 
 /*
 =================
-UI_UpdateMenu
+UI_DrawMenuFrame
 =================
 */
-void UI_UpdateMenu( float flTime )
+static void UI_DrawMenuFrame( float flTime )
 {
-	if( !uiStatic.initialized )
-		return;
+	// real fonts replace bitmap ones only between frames, text is laid out again after that
+	if( g_FontMgr->UpdateFontBuilds( ))
+		uiStatic.menu.VidInit( true );
 
 	static bool loadStuff = true;
 
@@ -687,6 +650,23 @@ void UI_UpdateMenu( float flTime )
 	uiStatic.menu.Update();
 }
 
+/*
+=================
+UI_UpdateMenu
+=================
+*/
+void UI_UpdateMenu( float flTime )
+{
+	if( !uiStatic.initialized )
+		return;
+
+	DrawTrace_BeginFrame( flTime );
+	Profiler_BeginFrame();
+	UI_DrawMenuFrame( flTime );
+	Profiler_EndFrame();
+	DrawTrace_EndFrame();
+}
+
 /*
 =================
 UI_KeyEvent
@@ -1154,6 +1134,22 @@ void UI_Init( void )
 	// show cl_predict dialog
 	EngFuncs::CvarRegister( "menu_mp_firsttime", "1", FCVAR_ARCHIVE );
 
+	// don't prebuild font atlases, rasterize glyphs when they are drawn first time
+	EngFuncs::CvarRegister( "ui_font_dynamic", "0", FCVAR_ARCHIVE );
+
+	// put all menu fonts to one atlas, so glyphs of different fonts share texture
+	EngFuncs::CvarRegister( "ui_font_shared_atlas", "0", FCVAR_ARCHIVE );
+
+	// 8-bit palettized font atlases, engine must keep alpha from BMP palette
+	// 1 is for plain fonts only, 2 also packs outlined and scanline fonts to 16 grey x 16 alpha levels
+	EngFuncs::CvarRegister( "ui_font_8bit", "0", FCVAR_ARCHIVE );
+
+	// glyphs of all sizes are resolved from distance fields built once per typeface
+	EngFuncs::CvarRegister( "ui_font_sdf", "0", FCVAR_ARCHIVE );
+
+	// fonts are built in background, bitmap font is drawn until they are ready
+	EngFuncs::CvarRegister( "ui_font_async", "1", FCVAR_ARCHIVE );
+
 	for( CMenuEntry *entry = s_pEntries; entry; entry = entry->m_pNext )
 	{
 		if( entry->m_szCommand && entry->m_pfnShow )
@@ -1162,6 +1158,11 @@ void UI_Init( void )
 		}
 	}
 
+	// before anything is loaded, so recorder knows all image names
+	DrawTrace_Init();
+	Profiler_Init();
+	DrawList_Init();
+
 	g_FontMgr = new CFontManager();
 
 	// EngFuncs::Cmd_AddCommand( "menu_zoo", UI_Zoo_Menu );
@@ -1207,5 +1208,9 @@ void UI_Shutdown( void )
 
 	delete g_FontMgr;
 
+	DrawTrace_Shutdown();
+	Profiler_Shutdown();
+	DrawList_Shutdown();
+
 	memset( &uiStatic, 0, sizeof( uiStatic_t ));
 }
@@ -0,0 +1,742 @@
+/*
+DrawList.cpp - retained 2D draw list for menu frames
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "extdll_menu.h"
+#include "BaseMenu.h"
+#include "Utils.h"
+#include "utlvector.h"
+#include "DrawList.h"
+#include "Profiler.h"
+
+#define MAX_DRAWLIST_LOOKBACK	64	// batches passed when looking for same state
+#define MAX_DRAWLIST_OVERLAP	32	// commands tested one by one, bigger batches use bounds
+#define MAX_DRAWLIST_MERGE	16	// commands of batch tried for merging
+
+enum
+{
+	CMD_PIC = 0,
+	CMD_PIC_HOLES,
+	CMD_PIC_TRANS,
+	CMD_PIC_ADDITIVE,
+	CMD_FILL,
+	CMD_CHAR
+};
+
+struct dlbounds_t
+{
+	int left, top, right, bottom;
+};
+
+struct dlcmd_t
+{
+	int type;
+	HIMAGE pic;			// texture, font for characters
+	unsigned int color;
+	int x, y, w, h;		// as passed to engine
+	wrect_t rc;
+	bool hasRect;
+	int ch;
+	dlbounds_t bounds;	// screen area, clipped by scissor
+	int prev, next;		// in batch
+};
+
+// commands sharing state, submitted together
+struct dlbatch_t
+{
+	int type;
+	HIMAGE pic;
+	unsigned int color;
+	int scissor;		// index in s_scissors, -1 if disabled
+	int first, last;
+	int count;
+	dlbounds_t bounds;
+};
+
+struct dlscissor_t
+{
+	int x, y, w, h;
+};
+
+struct dlstats_t
+{
+	int recorded;		// 2D calls menu has made
+	int submitted;		// 2D calls engine has got
+	int merged;
+	int culled;
+};
+
+static ui_enginefuncs_t		s_next;		// functions hooks were installed over
+static CUtlVector<dlcmd_t>	s_cmds;
+static CUtlVector<dlbatch_t>	s_batches;
+static CUtlVector<dlscissor_t>	s_scissors;
+static cvar_t			*ui_drawlist;
+
+static bool		s_recording;
+static HIMAGE		s_curPic;		// as set by menu
+static unsigned int	s_curColor;
+static int		s_curScissor;
+static bool		s_setValid;		// what engine has got
+static HIMAGE		s_setPic;
+static unsigned int	s_setColor;
+static int		s_setScissor;
+
+static dlstats_t	s_frame;
+static dlstats_t	s_total;
+static int		s_frames;
+
+/*
+=================================================================
+
+RECORDING
+
+=================================================================
+*/
+static bool DrawList_Overlaps( const dlbounds_t &a, const dlbounds_t &b )
+{
+	return a.left < b.right && b.left < a.right && a.top < b.bottom && b.top < a.bottom;
+}
+
+static bool DrawList_SameState( const dlbatch_t &batch, const dlcmd_t &cmd )
+{
+	if( batch.type != cmd.type || batch.scissor != s_curScissor )
+		return false;
+
+	// characters carry own color
+	if( cmd.type != CMD_FILL && batch.pic != cmd.pic )
+		return false;
+
+	return cmd.type == CMD_CHAR || batch.color == cmd.color;
+}
+
+/*
+=================
+DrawList_BatchOverlaps
+
+true if command can't be moved before this batch
+=================
+*/
+static bool DrawList_BatchOverlaps( const dlbatch_t &batch, const dlcmd_t &cmd )
+{
+	if( !DrawList_Overlaps( batch.bounds, cmd.bounds ))
+		return false;
+
+	if( batch.count > MAX_DRAWLIST_OVERLAP )
+		return true;
+
+	for( int i = batch.first; i >= 0; i = s_cmds[i].next )
+	{
+		if( DrawList_Overlaps( s_cmds[i].bounds, cmd.bounds ))
+			return true;
+	}
+
+	return false;
+}
+
+/*
+=================
+DrawList_Bounds
+
+area command covers on screen, false if nothing will be visible
+=================
+*/
+static bool DrawList_Bounds( dlcmd_t &cmd )
+{
+	int w = cmd.w, h = cmd.h;
+
+	// engine takes size from source rectangle or picture
+	if( w == -1 && h == -1 && cmd.type < CMD_FILL )
+	{
+		if( cmd.hasRect )
+		{
+			w = cmd.rc.right - cmd.rc.left;
+			h = cmd.rc.bottom - cmd.rc.top;
+		}
+		else
+		{
+			w = s_next.pfnPIC_Width( cmd.pic );
+			h = s_next.pfnPIC_Height( cmd.pic );
+		}
+	}
+
+	cmd.bounds.left = cmd.x;
+	cmd.bounds.top = cmd.y;
+	cmd.bounds.right = cmd.x + w;
+	cmd.bounds.bottom = cmd.y + h;
+
+	if( cmd.bounds.left < 0 ) cmd.bounds.left = 0;
+	if( cmd.bounds.top < 0 ) cmd.bounds.top = 0;
+	if( cmd.bounds.right > gpGlobals->scrWidth ) cmd.bounds.right = gpGlobals->scrWidth;
+	if( cmd.bounds.bottom > gpGlobals->scrHeight ) cmd.bounds.bottom = gpGlobals->scrHeight;
+
+	if( s_curScissor >= 0 )
+	{
+		const dlscissor_t &sc = s_scissors[s_curScissor];
+
+		if( cmd.bounds.left < sc.x ) cmd.bounds.left = sc.x;
+		if( cmd.bounds.top < sc.y ) cmd.bounds.top = sc.y;
+		if( cmd.bounds.right > sc.x + sc.w ) cmd.bounds.right = sc.x + sc.w;
+		if( cmd.bounds.bottom > sc.y + sc.h ) cmd.bounds.bottom = sc.y + sc.h;
+	}
+
+	return cmd.bounds.left < cmd.bounds.right && cmd.bounds.top < cmd.bounds.bottom;
+}
+
+/*
+=================
+DrawList_TryMerge
+
+joins command to the one it continues, for pictures source
+rectangles must continue each other at the same scale
+=================
+*/
+static bool DrawList_TryMerge( dlcmd_t &dst, const dlcmd_t &src )
+{
+	bool pic = dst.type != CMD_FILL;
+
+	if( pic && ( !dst.hasRect || !src.hasRect || dst.w <= 0 || dst.h <= 0 || src.w <= 0 || src.h <= 0 ))
+		return false;
+
+	if( dst.y == src.y && dst.h == src.h && ( !pic || ( dst.rc.top == src.rc.top && dst.rc.bottom == src.rc.bottom
+		&& dst.w * ( src.rc.right - src.rc.left ) == src.w * ( dst.rc.right - dst.rc.left ))))
+	{
+		if( dst.x + dst.w == src.x && ( !pic || dst.rc.right == src.rc.left ))
+		{
+			dst.w += src.w;
+			dst.rc.right = src.rc.right;
+			return true;
+		}
+
+		if( src.x + src.w == dst.x && ( !pic || src.rc.right == dst.rc.left ))
+		{
+			dst.x = src.x;
+			dst.w += src.w;
+			dst.rc.left = src.rc.left;
+			return true;
+		}
+	}
+
+	if( dst.x == src.x && dst.w == src.w && ( !pic || ( dst.rc.left == src.rc.left && dst.rc.right == src.rc.right
+		&& dst.h * ( src.rc.bottom - src.rc.top ) == src.h * ( dst.rc.bottom - dst.rc.top ))))
+	{
+		if( dst.y + dst.h == src.y && ( !pic || dst.rc.bottom == src.rc.top ))
+		{
+			dst.h += src.h;
+			dst.rc.bottom = src.rc.bottom;
+			return true;
+		}
+
+		if( src.y + src.h == dst.y && ( !pic || src.rc.bottom == dst.rc.top ))
+		{
+			dst.y = src.y;
+			dst.h += src.h;
+			dst.rc.top = src.rc.top;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+/*
+=================
+DrawList_Merge
+
+command may be merged into any one of batch, if none that
+go after it overlap
+=================
+*/
+static bool DrawList_Merge( dlbatch_t &batch, const dlcmd_t &cmd )
+{
+	int checked = 0;
+
+	if( cmd.type == CMD_CHAR )
+		return false;
+
+	for( int i = batch.last; i >= 0 && checked < MAX_DRAWLIST_MERGE; i = s_cmds[i].prev, checked++ )
+	{
+		dlcmd_t &dst = s_cmds[i];
+
+		if( DrawList_TryMerge( dst, cmd ))
+		{
+			DrawList_Bounds( dst );
+			return true;
+		}
+
+		if( DrawList_Overlaps( dst.bounds, cmd.bounds ))
+			return false;
+	}
+
+	return false;
+}
+
+static void DrawList_AddBounds( dlbounds_t &dst, const dlbounds_t &src )
+{
+	if( src.left < dst.left ) dst.left = src.left;
+	if( src.top < dst.top ) dst.top = src.top;
+	if( src.right > dst.right ) dst.right = src.right;
+	if( src.bottom > dst.bottom ) dst.bottom = src.bottom;
+}
+
+/*
+=================
+DrawList_Add
+
+puts command into the nearest batch with same state it
+can join without changing what's visible
+=================
+*/
+static void DrawList_Add( dlcmd_t &cmd )
+{
+	int b, examined = 0;
+
+	s_frame.recorded++;
+
+	if( !DrawList_Bounds( cmd ))
+	{
+		s_frame.culled++;
+		return;
+	}
+
+	for( b = s_batches.Count() - 1; b >= 0 && examined < MAX_DRAWLIST_LOOKBACK; b--, examined++ )
+	{
+		dlbatch_t &batch = s_batches[b];
+
+		if( DrawList_SameState( batch, cmd ))
+			break;
+
+		if( DrawList_BatchOverlaps( batch, cmd ))
+		{
+			b = -1;
+			break;
+		}
+	}
+
+	if( b < 0 || examined == MAX_DRAWLIST_LOOKBACK )
+	{
+		dlbatch_t &batch = s_batches[b = s_batches.AddToTail()];
+
+		batch.type = cmd.type;
+		batch.pic = cmd.pic;
+		batch.color = cmd.color;
+		batch.scissor = s_curScissor;
+		batch.first = batch.last = -1;
+		batch.count = 0;
+		batch.bounds = cmd.bounds;
+	}
+
+	dlbatch_t &batch = s_batches[b];
+
+	DrawList_AddBounds( batch.bounds, cmd.bounds );
+
+	if( DrawList_Merge( batch, cmd ))
+	{
+		s_frame.merged++;
+		return;
+	}
+
+	int i = s_cmds.AddToTail( cmd );
+
+	s_cmds[i].prev = batch.last;
+	s_cmds[i].next = -1;
+
+	if( batch.last >= 0 )
+		s_cmds[batch.last].next = i;
+	else batch.first = i;
+
+	batch.last = i;
+	batch.count++;
+}
+
+static void DrawList_AddPic( int type, int x, int y, int width, int height, const wrect_t *prc )
+{
+	dlcmd_t cmd;
+
+	// fully transparent, draws nothing
+	if( type == CMD_PIC_TRANS && !( s_curColor >> 24 ))
+	{
+		s_frame.recorded++;
+		s_frame.culled++;
+		return;
+	}
+
+	memset( &cmd, 0, sizeof( cmd ));
+	cmd.type = type;
+	cmd.pic = s_curPic;
+	cmd.color = s_curColor;
+	cmd.x = x;
+	cmd.y = y;
+	cmd.w = width;
+	cmd.h = height;
+
+	if( prc )
+	{
+		cmd.rc = *prc;
+		cmd.hasRect = true;
+	}
+
+	DrawList_Add( cmd );
+}
+
+/*
+=================================================================
+
+SUBMISSION
+
+=================================================================
+*/
+static void DrawList_SetScissor( int scissor )
+{
+	if( scissor == s_setScissor )
+		return;
+
+	if( scissor < 0 )
+		s_next.pfnPIC_DisableScissor();
+	else
+	{
+		const dlscissor_t &sc = s_scissors[scissor];
+
+		// engine replaces scissor, no need to disable first
+		s_next.pfnPIC_EnableScissor( sc.x, sc.y, sc.w, sc.h );
+	}
+
+	s_setScissor = scissor;
+	s_frame.submitted++;
+}
+
+static void DrawList_Submit( const dlcmd_t &cmd )
+{
+	const wrect_t *prc = cmd.hasRect ? &cmd.rc : NULL;
+	int r, g, b, a;
+
+	UnpackRGBA( r, g, b, a, cmd.color );
+
+	switch( cmd.type )
+	{
+	case CMD_FILL:
+		s_next.pfnFillRGBA( cmd.x, cmd.y, cmd.w, cmd.h, r, g, b, a );
+		s_setValid = false; // may leave other color set
+		break;
+	case CMD_CHAR:
+		s_next.pfnDrawCharacter( cmd.x, cmd.y, cmd.w, cmd.h, cmd.ch, cmd.color, cmd.pic );
+		s_setValid = false;
+		break;
+	default:
+		if( !s_setValid || s_setPic != cmd.pic || s_setColor != cmd.color )
+		{
+			s_next.pfnPIC_Set( cmd.pic, r, g, b, a );
+			s_frame.submitted++;
+
+			s_setValid = true;
+			s_setPic = cmd.pic;
+			s_setColor = cmd.color;
+		}
+
+		switch( cmd.type )
+		{
+		case CMD_PIC: s_next.pfnPIC_Draw( cmd.x, cmd.y, cmd.w, cmd.h, prc ); break;
+		case CMD_PIC_HOLES: s_next.pfnPIC_DrawHoles( cmd.x, cmd.y, cmd.w, cmd.h, prc ); break;
+		case CMD_PIC_TRANS: s_next.pfnPIC_DrawTrans( cmd.x, cmd.y, cmd.w, cmd.h, prc ); break;
+		case CMD_PIC_ADDITIVE: s_next.pfnPIC_DrawAdditive( cmd.x, cmd.y, cmd.w, cmd.h, prc ); break;
+		}
+		break;
+	}
+
+	s_frame.submitted++;
+}
+
+/*
+=================
+DrawList_Flush
+
+submits recorded batches, engine state is left as menu has set it
+=================
+*/
+void DrawList_Flush( void )
+{
+	dlscissor_t scissor;
+
+	if( !s_recording )
+		return;
+
+	FOR_EACH_VEC( s_batches, b )
+	{
+		const dlbatch_t &batch = s_batches[b];
+
+		DrawList_SetScissor( batch.scissor );
+
+		for( int i = batch.first; i >= 0; i = s_cmds[i].next )
+			DrawList_Submit( s_cmds[i] );
+	}
+
+	DrawList_SetScissor( s_curScissor );
+
+	s_cmds.RemoveAll();
+	s_batches.RemoveAll();
+
+	// keep only scissor that is active now
+	if( s_curScissor >= 0 )
+	{
+		scissor = s_scissors[s_curScissor];
+		s_scissors.RemoveAll();
+		s_curScissor = s_setScissor = s_scissors.AddToTail( scissor );
+	}
+	else s_scissors.RemoveAll();
+}
+
+/*
+=================================================================
+
+ENGINE HOOKS
+
+=================================================================
+*/
+static void DL_PIC_Set( HIMAGE hPic, int r, int g, int b, int a )
+{
+	s_frame.recorded++;
+	s_curPic = hPic;
+	s_curColor = PackRGBA( r, g, b, a );
+}
+
+static void DL_PIC_Draw( int x, int y, int width, int height, const wrect_t *prc )
+{
+	DrawList_AddPic( CMD_PIC, x, y, width, height, prc );
+}
+
+static void DL_PIC_DrawHoles( int x, int y, int width, int height, const wrect_t *prc )
+{
+	DrawList_AddPic( CMD_PIC_HOLES, x, y, width, height, prc );
+}
+
+static void DL_PIC_DrawTrans( int x, int y, int width, int height, const wrect_t *prc )
+{
+	DrawList_AddPic( CMD_PIC_TRANS, x, y, width, height, prc );
+}
+
+static void DL_PIC_DrawAdditive( int x, int y, int width, int height, const wrect_t *prc )
+{
+	DrawList_AddPic( CMD_PIC_ADDITIVE, x, y, width, height, prc );
+}
+
+static void DL_PIC_EnableScissor( int x, int y, int width, int height )
+{
+	int i;
+
+	s_frame.recorded++;
+
+	FOR_EACH_VEC( s_scissors, j )
+	{
+		const dlscissor_t &sc = s_scissors[j];
+
+		if( sc.x == x && sc.y == y && sc.w == width && sc.h == height )
+		{
+			s_curScissor = j;
+			return;
+		}
+	}
+
+	i = s_scissors.AddToTail();
+	s_scissors[i].x = x;
+	s_scissors[i].y = y;
+	s_scissors[i].w = width;
+	s_scissors[i].h = height;
+	s_curScissor = i;
+}
+
+static void DL_PIC_DisableScissor( void )
+{
+	s_frame.recorded++;
+	s_curScissor = -1;
+}
+
+static void DL_FillRGBA( int x, int y, int width, int height, int r, int g, int b, int a )
+{
+	dlcmd_t cmd;
+
+	if( !a )
+	{
+		s_frame.recorded++;
+		s_frame.culled++;
+		return;
+	}
+
+	memset( &cmd, 0, sizeof( cmd ));
+	cmd.type = CMD_FILL;
+	cmd.color = PackRGBA( r, g, b, a );
+	cmd.x = x;
+	cmd.y = y;
+	cmd.w = width;
+	cmd.h = height;
+
+	DrawList_Add( cmd );
+}
+
+static void DL_DrawCharacter( int x, int y, int width, int height, int ch, int ulRGBA, HIMAGE hFont )
+{
+	dlcmd_t cmd;
+
+	memset( &cmd, 0, sizeof( cmd ));
+	cmd.type = CMD_CHAR;
+	cmd.pic = hFont;
+	cmd.color = ulRGBA;
+	cmd.x = x;
+	cmd.y = y;
+	cmd.w = width;
+	cmd.h = height;
+	cmd.ch = ch;
+
+	DrawList_Add( cmd );
+}
+
+// these can't be recorded, so draw everything before them
+static void DL_PIC_Free( const char *szPicName )
+{
+	DrawList_Flush();
+	s_setValid = false;
+	s_next.pfnPIC_Free( szPicName );
+}
+
+static void DL_DrawLogo( const char *filename, float x, float y, float width, float height )
+{
+	DrawList_Flush();
+	s_setValid = false;
+	s_next.pfnDrawLogo( filename, x, y, width, height );
+}
+
+static int DL_DrawConsoleString( int x, int y, const char *string )
+{
+	DrawList_Flush();
+	s_setValid = false;
+	return s_next.pfnDrawConsoleString( x, y, string );
+}
+
+static void DL_RenderScene( const struct ref_viewpass_s *rvp )
+{
+	DrawList_Flush();
+	s_setValid = false;
+	s_next.pfnRenderScene( rvp );
+}
+
+static void DL_ProcessImage( int texnum, float gamma, int topColor, int bottomColor )
+{
+	DrawList_Flush();
+	s_next.pfnProcessImage( texnum, gamma, topColor, bottomColor );
+}
+
+static void DrawList_SetHooks( bool enable )
+{
+	ui_enginefuncs_t &engfuncs = EngFuncs::engfuncs;
+
+	// chain to whatever is installed, draw trace records submitted calls
+	if( enable )
+		s_next = engfuncs;
+
+	engfuncs.pfnPIC_Set = enable ? DL_PIC_Set : s_next.pfnPIC_Set;
+	engfuncs.pfnPIC_Draw = enable ? DL_PIC_Draw : s_next.pfnPIC_Draw;
+	engfuncs.pfnPIC_DrawHoles = enable ? DL_PIC_DrawHoles : s_next.pfnPIC_DrawHoles;
+	engfuncs.pfnPIC_DrawTrans = enable ? DL_PIC_DrawTrans : s_next.pfnPIC_DrawTrans;
+	engfuncs.pfnPIC_DrawAdditive = enable ? DL_PIC_DrawAdditive : s_next.pfnPIC_DrawAdditive;
+	engfuncs.pfnPIC_EnableScissor = enable ? DL_PIC_EnableScissor : s_next.pfnPIC_EnableScissor;
+	engfuncs.pfnPIC_DisableScissor = enable ? DL_PIC_DisableScissor : s_next.pfnPIC_DisableScissor;
+	engfuncs.pfnFillRGBA = enable ? DL_FillRGBA : s_next.pfnFillRGBA;
+	engfuncs.pfnDrawCharacter = enable ? DL_DrawCharacter : s_next.pfnDrawCharacter;
+	engfuncs.pfnPIC_Free = enable ? DL_PIC_Free : s_next.pfnPIC_Free;
+	engfuncs.pfnDrawLogo = enable ? DL_DrawLogo : s_next.pfnDrawLogo;
+	engfuncs.pfnDrawConsoleString = enable ? DL_DrawConsoleString : s_next.pfnDrawConsoleString;
+	engfuncs.pfnRenderScene = enable ? DL_RenderScene : s_next.pfnRenderScene;
+	engfuncs.pfnProcessImage = enable ? DL_ProcessImage : s_next.pfnProcessImage;
+}
+
+/*
+=================================================================
+
+FRAME
+
+=================================================================
+*/
+void DrawList_Begin( void )
+{
+	if( s_recording || !ui_drawlist || !ui_drawlist->value )
+		return;
+
+	// profiled Draw() must include real drawing cost
+	if( Profiler_IsActive( ))
+		return;
+
+	memset( &s_frame, 0, sizeof( s_frame ));
+
+	// frame starts without scissor and unknown picture
+	s_curPic = 0;
+	s_curColor = PackRGBA( 255, 255, 255, 255 );
+	s_curScissor = s_setScissor = -1;
+	s_setValid = false;
+
+	DrawList_SetHooks( true );
+	s_recording = true;
+}
+
+void DrawList_End( void )
+{
+	if( !s_recording )
+		return;
+
+	DrawList_Flush();
+	DrawList_SetHooks( false );
+	s_recording = false;
+
+	s_total.recorded += s_frame.recorded;
+	s_total.submitted += s_frame.submitted;
+	s_total.merged += s_frame.merged;
+	s_total.culled += s_frame.culled;
+	s_frames++;
+}
+
+static void UI_DrawListStats_f( void )
+{
+	if( !s_frames )
+	{
+		Con_Printf( "draw list: no frames recorded, set ui_drawlist 1\n" );
+		return;
+	}
+
+	Con_Printf( "draw list: last frame %i calls recorded, %i submitted, %i merged, %i culled\n",
+		s_frame.recorded, s_frame.submitted, s_frame.merged, s_frame.culled );
+	Con_Printf( "draw list: %i frames, %.1f calls recorded and %.1f submitted per frame\n",
+		s_frames, (float)s_total.recorded / s_frames, (float)s_total.submitted / s_frames );
+
+	if( EngFuncs::CmdArgc() > 1 && !stricmp( EngFuncs::CmdArgv( 1 ), "reset" ))
+	{
+		memset( &s_total, 0, sizeof( s_total ));
+		s_frames = 0;
+	}
+}
+
+void DrawList_Init( void )
+{
+	ui_drawlist = EngFuncs::CvarRegister( "ui_drawlist", "0", FCVAR_ARCHIVE );
+
+	EngFuncs::Cmd_AddCommand( "ui_drawlist_stats", UI_DrawListStats_f );
+}
+
+void DrawList_Shutdown( void )
+{
+	DrawList_End();
+
+	EngFuncs::Cmd_RemoveCommand( "ui_drawlist_stats" );
+
+	s_cmds.Purge();
+	s_batches.Purge();
+	s_scissors.Purge();
+	ui_drawlist = NULL;
+}
@@ -0,0 +1,41 @@
+/*
+DrawList.h - retained 2D draw list for menu frames
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef DRAWLIST_H
+#define DRAWLIST_H
+
+/*
+ * While ui_drawlist is enabled, pictures, fills, characters and scissor
+ * changes between DrawList_Begin and DrawList_End are recorded instead
+ * of going to engine. At the end they are submitted grouped by texture,
+ * color and blend mode, as long as no overlapping draw is skipped over,
+ * so result looks the same as in painter's order. Adjacent fills and
+ * pictures continuing each other are merged into one call, redundant
+ * PIC_Set and scissor calls are dropped.
+ *
+ * Calls that can't be recorded, like model rendering or logo movie,
+ * submit everything recorded before them.
+ *
+ * Disabled by default. Frames measured by ui_profile are drawn directly,
+ * otherwise Draw() of items would only show recording cost.
+ * ui_drawlist_stats prints call counts.
+ **/
+void DrawList_Init( void );
+void DrawList_Shutdown( void );
+void DrawList_Begin( void );
+void DrawList_End( void );
+void DrawList_Flush( void );
+
+#endif // DRAWLIST_H
@@ -0,0 +1,495 @@
+/*
+DrawTrace.cpp - recorder of menu draw calls
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "extdll_menu.h"
+#include "BaseMenu.h"
+#include "Utils.h"
+#include "utlvector.h"
+#include "DrawTrace.h"
+#include "DrawTraceFormat.h"
+
+#define MAX_TRACE_FILES	1000
+
+struct traceimage_t
+{
+	HIMAGE pic;
+	char name[256];
+};
+
+static ui_enginefuncs_t		s_engfuncs;	// original engine functions
+static CUtlVector<traceimage_t>	s_images;	// names of loaded images
+static CUtlVector<HIMAGE>	s_written;	// images already described in trace
+static CUtlVector<byte>		s_trace;
+static CUtlVector<byte>		s_frame;	// appended to trace if anything is drawn
+static cvar_t			*ui_drawtrace;
+
+static bool	s_recording;
+static int	s_framesLeft;
+static int	s_frameCmds;
+static double	s_frameStart;
+static HIMAGE	s_lastPic;
+
+static int	s_frames;
+static int	s_draws;
+static int	s_switches;
+static double	s_totalCost;
+static double	s_maxCost;
+static char	s_maxCostWindow[64];
+
+/*
+=================================================================
+
+TRACE WRITING
+
+=================================================================
+*/
+static void Trace_Byte( int b )
+{
+	s_frame.AddToTail( (byte)b );
+}
+
+static void Trace_Varint( unsigned int value )
+{
+	while( value >= 0x80 )
+	{
+		Trace_Byte(( value & 0x7F ) | 0x80 );
+		value >>= 7;
+	}
+
+	Trace_Byte( value );
+}
+
+static void Trace_Int( int value )
+{
+	Trace_Varint( DrawTrace_ZigZag( value ));
+}
+
+static void Trace_Color( int r, int g, int b, int a )
+{
+	Trace_Byte( r < 0 ? 0 : r > 255 ? 255 : r );
+	Trace_Byte( g < 0 ? 0 : g > 255 ? 255 : g );
+	Trace_Byte( b < 0 ? 0 : b > 255 ? 255 : b );
+	Trace_Byte( a < 0 ? 0 : a > 255 ? 255 : a );
+}
+
+static void Trace_String( const char *s )
+{
+	int len = strlen( s );
+
+	Trace_Varint( len );
+	for( int i = 0; i < len; i++ )
+		Trace_Byte( s[i] );
+}
+
+static void Trace_CommitFrame( void )
+{
+	int i = s_trace.AddMultipleToTail( s_frame.Count( ));
+
+	memcpy( &s_trace[i], &s_frame[0], s_frame.Count( ));
+	s_frame.RemoveAll();
+}
+
+static void Trace_Rect( int x, int y, int w, int h )
+{
+	Trace_Int( x );
+	Trace_Int( y );
+	Trace_Int( w );
+	Trace_Int( h );
+}
+
+/*
+=================
+Trace_Image
+
+describes image once per trace, before it's first used
+=================
+*/
+static void Trace_Image( HIMAGE pic )
+{
+	const char *name = "";
+
+	if( !pic )
+		return;
+
+	for( int i = 0; i < s_written.Count(); i++ )
+	{
+		if( s_written[i] == pic )
+			return;
+	}
+
+	for( int i = 0; i < s_images.Count(); i++ )
+	{
+		if( s_images[i].pic == pic )
+		{
+			name = s_images[i].name;
+			break;
+		}
+	}
+
+	s_written.AddToTail( pic );
+
+	Trace_Byte( TRACE_IMAGE );
+	Trace_Varint( pic );
+	Trace_Varint( s_engfuncs.pfnPIC_Width( pic ));
+	Trace_Varint( s_engfuncs.pfnPIC_Height( pic ));
+	Trace_String( name );
+}
+
+static void Trace_UseImage( HIMAGE pic )
+{
+	if( pic == s_lastPic )
+		return;
+
+	s_lastPic = pic;
+	s_switches++;
+}
+
+/*
+=================================================================
+
+ENGINE HOOKS
+
+=================================================================
+*/
+static HIMAGE Trace_PIC_Load( const char *szPicName, const byte *ucRawImage, int ulRawImageSize, int flags )
+{
+	HIMAGE pic = s_engfuncs.pfnPIC_Load( szPicName, ucRawImage, ulRawImageSize, flags );
+	int i;
+
+	if( !pic )
+		return pic;
+
+	// engine may give handle of freed image to the new one
+	for( i = 0; i < s_images.Count(); i++ )
+	{
+		if( s_images[i].pic == pic )
+			break;
+	}
+
+	if( i == s_images.Count( ))
+		i = s_images.AddToTail();
+
+	s_images[i].pic = pic;
+	Q_strncpy( s_images[i].name, szPicName, sizeof( s_images[i].name ));
+
+	return pic;
+}
+
+static void Trace_PIC_Free( const char *szPicName )
+{
+	for( int i = 0; i < s_images.Count(); i++ )
+	{
+		if( stricmp( s_images[i].name, szPicName ))
+			continue;
+
+		for( int j = 0; j < s_written.Count(); j++ )
+		{
+			if( s_written[j] == s_images[i].pic )
+			{
+				s_written.Remove( j );
+				break;
+			}
+		}
+
+		s_images.Remove( i );
+		break;
+	}
+
+	s_engfuncs.pfnPIC_Free( szPicName );
+}
+
+static void Trace_PIC_Set( HIMAGE hPic, int r, int g, int b, int a )
+{
+	Trace_Image( hPic );
+	Trace_UseImage( hPic );
+
+	Trace_Byte( TRACE_SET );
+	Trace_Varint( hPic );
+	Trace_Color( r, g, b, a );
+	s_frameCmds++;
+
+	s_engfuncs.pfnPIC_Set( hPic, r, g, b, a );
+}
+
+static void Trace_Draw( int op, int x, int y, int width, int height, const wrect_t *prc )
+{
+	Trace_Byte( prc ? ( op | TRACE_HAS_RECT ) : op );
+	Trace_Rect( x, y, width, height );
+	if( prc )
+	{
+		Trace_Int( prc->left );
+		Trace_Int( prc->right );
+		Trace_Int( prc->top );
+		Trace_Int( prc->bottom );
+	}
+
+	s_frameCmds++;
+	s_draws++;
+}
+
+static void Trace_PIC_Draw( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Trace_Draw( TRACE_DRAW, x, y, width, height, prc );
+	s_engfuncs.pfnPIC_Draw( x, y, width, height, prc );
+}
+
+static void Trace_PIC_DrawHoles( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Trace_Draw( TRACE_DRAW_HOLES, x, y, width, height, prc );
+	s_engfuncs.pfnPIC_DrawHoles( x, y, width, height, prc );
+}
+
+static void Trace_PIC_DrawTrans( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Trace_Draw( TRACE_DRAW_TRANS, x, y, width, height, prc );
+	s_engfuncs.pfnPIC_DrawTrans( x, y, width, height, prc );
+}
+
+static void Trace_PIC_DrawAdditive( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Trace_Draw( TRACE_DRAW_ADDITIVE, x, y, width, height, prc );
+	s_engfuncs.pfnPIC_DrawAdditive( x, y, width, height, prc );
+}
+
+static void Trace_PIC_EnableScissor( int x, int y, int width, int height )
+{
+	Trace_Byte( TRACE_SCISSOR );
+	Trace_Rect( x, y, width, height );
+	s_frameCmds++;
+
+	s_engfuncs.pfnPIC_EnableScissor( x, y, width, height );
+}
+
+static void Trace_PIC_DisableScissor( void )
+{
+	Trace_Byte( TRACE_NOSCISSOR );
+	s_frameCmds++;
+
+	s_engfuncs.pfnPIC_DisableScissor();
+}
+
+static void Trace_FillRGBA( int x, int y, int width, int height, int r, int g, int b, int a )
+{
+	Trace_Byte( TRACE_FILL );
+	Trace_Rect( x, y, width, height );
+	Trace_Color( r, g, b, a );
+	s_frameCmds++;
+	s_draws++;
+
+	s_engfuncs.pfnFillRGBA( x, y, width, height, r, g, b, a );
+}
+
+static void Trace_DrawCharacter( int x, int y, int width, int height, int ch, int ulRGBA, HIMAGE hFont )
+{
+	Trace_Image( hFont );
+	Trace_UseImage( hFont );
+
+	Trace_Byte( TRACE_CHAR );
+	Trace_Rect( x, y, width, height );
+	Trace_Varint( ch );
+	Trace_Color(( ulRGBA >> 16 ) & 0xFF, ( ulRGBA >> 8 ) & 0xFF, ulRGBA & 0xFF, ( ulRGBA >> 24 ) & 0xFF );
+	Trace_Varint( hFont );
+	s_frameCmds++;
+	s_draws++;
+
+	s_engfuncs.pfnDrawCharacter( x, y, width, height, ch, ulRGBA, hFont );
+}
+
+static void DrawTrace_SetHooks( bool enable )
+{
+	ui_enginefuncs_t &engfuncs = EngFuncs::engfuncs;
+
+	engfuncs.pfnPIC_Set = enable ? Trace_PIC_Set : s_engfuncs.pfnPIC_Set;
+	engfuncs.pfnPIC_Draw = enable ? Trace_PIC_Draw : s_engfuncs.pfnPIC_Draw;
+	engfuncs.pfnPIC_DrawHoles = enable ? Trace_PIC_DrawHoles : s_engfuncs.pfnPIC_DrawHoles;
+	engfuncs.pfnPIC_DrawTrans = enable ? Trace_PIC_DrawTrans : s_engfuncs.pfnPIC_DrawTrans;
+	engfuncs.pfnPIC_DrawAdditive = enable ? Trace_PIC_DrawAdditive : s_engfuncs.pfnPIC_DrawAdditive;
+	engfuncs.pfnPIC_EnableScissor = enable ? Trace_PIC_EnableScissor : s_engfuncs.pfnPIC_EnableScissor;
+	engfuncs.pfnPIC_DisableScissor = enable ? Trace_PIC_DisableScissor : s_engfuncs.pfnPIC_DisableScissor;
+	engfuncs.pfnFillRGBA = enable ? Trace_FillRGBA : s_engfuncs.pfnFillRGBA;
+	engfuncs.pfnDrawCharacter = enable ? Trace_DrawCharacter : s_engfuncs.pfnDrawCharacter;
+}
+
+/*
+=================================================================
+
+RECORDING
+
+=================================================================
+*/
+static void DrawTrace_Start( int frames )
+{
+	s_trace.RemoveAll();
+	s_frame.RemoveAll();
+	s_written.RemoveAll();
+
+	s_framesLeft = frames;
+	s_frames = s_draws = s_switches = 0;
+	s_totalCost = s_maxCost = 0.0;
+	s_maxCostWindow[0] = 0;
+	s_lastPic = 0;
+
+	for( int i = 0; i < 4; i++ )
+		Trace_Byte( DRAWTRACE_MAGIC[i] );
+	Trace_Byte( DRAWTRACE_VERSION );
+	Trace_Varint( gpGlobals->scrWidth );
+	Trace_Varint( gpGlobals->scrHeight );
+	Trace_CommitFrame();
+
+	DrawTrace_SetHooks( true );
+	s_recording = true;
+}
+
+/*
+=================
+DrawTrace_Stop
+
+writes trace to the first free drawtraces/traceXXX.dtr
+=================
+*/
+static void DrawTrace_Stop( void )
+{
+	char filename[64];
+	int i;
+
+	DrawTrace_SetHooks( false );
+	s_recording = false;
+
+	// nothing was drawn, don't write header alone
+	if( s_frames )
+	{
+		s_frame.RemoveAll();
+		Trace_Byte( TRACE_END );
+		Trace_CommitFrame();
+
+		for( i = 0; i < MAX_TRACE_FILES; i++ )
+		{
+			snprintf( filename, sizeof( filename ), "drawtraces/trace%03i.dtr", i );
+			if( !EngFuncs::FileExists( filename, TRUE ))
+				break;
+		}
+
+		if( i == MAX_TRACE_FILES )
+			Con_Printf( "DrawTrace: too many traces, remove old ones\n" );
+		else if( EngFuncs::COM_SaveFile( filename, &s_trace[0], s_trace.Count( )))
+		{
+			Con_Printf( "DrawTrace: %s, %i frames, %i bytes\n", filename, s_frames, s_trace.Count( ));
+			Con_Printf( "DrawTrace: avg %.3f ms, max %.3f ms (%s), %.1f draws and %.1f texture switches per frame\n",
+				s_totalCost * 1000.0 / s_frames, s_maxCost * 1000.0, s_maxCostWindow,
+				(float)s_draws / s_frames, (float)s_switches / s_frames );
+		}
+		else Con_Printf( "DrawTrace: can't write %s\n", filename );
+	}
+
+	s_trace.Purge();
+	s_frame.Purge();
+	s_written.Purge();
+
+	if( ui_drawtrace->value )
+		EngFuncs::CvarSetValue( "ui_drawtrace", 0.0f );
+}
+
+void DrawTrace_BeginFrame( float flTime )
+{
+	if( !ui_drawtrace )
+		return;
+
+	if( !s_recording )
+	{
+		if( ui_drawtrace->value < 1.0f )
+			return;
+
+		DrawTrace_Start( (int)ui_drawtrace->value );
+	}
+	else if( ui_drawtrace->value < 1.0f )
+	{
+		// cancelled, keep what is recorded
+		DrawTrace_Stop();
+		return;
+	}
+
+	s_frameCmds = 0;
+	Trace_Byte( TRACE_FRAME );
+	Trace_Varint( (unsigned int)( flTime * 1000.0f ));
+
+	s_frameStart = EngFuncs::DoubleTime();
+}
+
+void DrawTrace_EndFrame( void )
+{
+	CMenuBaseWindow *window;
+	const char *name;
+	double cost;
+
+	if( !s_recording )
+		return;
+
+	cost = EngFuncs::DoubleTime() - s_frameStart;
+
+	// menu may be hidden, don't fill trace with empty frames
+	if( !s_frameCmds )
+	{
+		s_frame.RemoveAll();
+		return;
+	}
+
+	window = uiStatic.menu.Current();
+	name = window && window->szName ? window->szName : "";
+
+	Trace_Byte( TRACE_FRAME_END );
+	Trace_Varint( (unsigned int)( cost * 1000000.0 ));
+	Trace_String( name );
+
+	Trace_CommitFrame();
+
+	s_frames++;
+	s_totalCost += cost;
+	if( cost > s_maxCost )
+	{
+		s_maxCost = cost;
+		Q_strncpy( s_maxCostWindow, name, sizeof( s_maxCostWindow ));
+	}
+
+	if( --s_framesLeft <= 0 )
+		DrawTrace_Stop();
+}
+
+/*
+=================
+DrawTrace_Init
+
+image loading is hooked all the time, so trace knows names of images
+loaded before recording has started
+=================
+*/
+void DrawTrace_Init( void )
+{
+	ui_drawtrace = EngFuncs::CvarRegister( "ui_drawtrace", "0", 0 );
+
+	s_engfuncs = EngFuncs::engfuncs;
+	EngFuncs::engfuncs.pfnPIC_Load = Trace_PIC_Load;
+	EngFuncs::engfuncs.pfnPIC_Free = Trace_PIC_Free;
+}
+
+void DrawTrace_Shutdown( void )
+{
+	if( s_recording )
+		DrawTrace_Stop();
+
+	EngFuncs::engfuncs.pfnPIC_Load = s_engfuncs.pfnPIC_Load;
+	EngFuncs::engfuncs.pfnPIC_Free = s_engfuncs.pfnPIC_Free;
+	s_images.Purge();
+	ui_drawtrace = NULL;
+}
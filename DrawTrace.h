@@ -0,0 +1,30 @@
+/*
+DrawTrace.h - recorder of menu draw calls
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef DRAWTRACE_H
+#define DRAWTRACE_H
+
+/*
+ * Setting ui_drawtrace to N records next N drawn menu frames into
+ * drawtraces/traceXXX.dtr in game directory, see DrawTraceFormat.h.
+ * Recording works by replacing draw functions in engine table, so
+ * it costs nothing while disabled and works in any engine.
+ **/
+void DrawTrace_Init( void );
+void DrawTrace_Shutdown( void );
+void DrawTrace_BeginFrame( float flTime );
+void DrawTrace_EndFrame( void );
+
+#endif // DRAWTRACE_H
@@ -0,0 +1,71 @@
+/*
+DrawTraceFormat.h - binary format of recorded menu draw calls
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef DRAWTRACEFORMAT_H
+#define DRAWTRACEFORMAT_H
+
+/*
+ * Trace starts with "MDTR", version byte, screen width and height.
+ * Then goes a stream of records, each is an opcode byte followed by
+ * arguments. Unsigned numbers are LEB128 varints, coordinates are
+ * zigzag varints, colors are 4 raw bytes in RGBA order, strings are
+ * varint length followed by characters.
+ *
+ * TRACE_FRAME      time in msec
+ * TRACE_FRAME_END  menu frame cost in usec, name of active window
+ * TRACE_IMAGE      handle, width, height, name; comes before first use
+ * TRACE_SET        handle, color
+ * TRACE_DRAW*      x, y, w, h, [left, right, top, bottom if TRACE_HAS_RECT]
+ * TRACE_FILL       x, y, w, h, color
+ * TRACE_SCISSOR    x, y, w, h
+ * TRACE_NOSCISSOR
+ * TRACE_CHAR       x, y, w, h, character, color, font handle
+ **/
+#define DRAWTRACE_MAGIC		"MDTR"
+#define DRAWTRACE_VERSION	1
+
+enum drawtraceop_e
+{
+	TRACE_END = 0,
+	TRACE_FRAME,
+	TRACE_FRAME_END,
+	TRACE_IMAGE,
+	TRACE_SET,
+	TRACE_DRAW,
+	TRACE_DRAW_HOLES,
+	TRACE_DRAW_TRANS,
+	TRACE_DRAW_ADDITIVE,
+	TRACE_FILL,
+	TRACE_SCISSOR,
+	TRACE_NOSCISSOR,
+	TRACE_CHAR,
+
+	TRACE_NUMOPS
+};
+
+#define TRACE_HAS_RECT		0x80	// or'ed with TRACE_DRAW* opcodes
+#define TRACE_OPCODE_MASK	0x7F
+
+inline unsigned int DrawTrace_ZigZag( int value )
+{
+	return ( (unsigned int)value << 1 ) ^ (unsigned int)( value >> 31 );
+}
+
+inline int DrawTrace_UnZigZag( unsigned int value )
+{
+	return (int)( value >> 1 ) ^ -(int)( value & 1 );
+}
+
+#endif // DRAWTRACEFORMAT_H
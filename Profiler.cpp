@@ -0,0 +1,584 @@
+/*
+Profiler.cpp - per-widget draw and think timings
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdarg.h>
+#include "extdll_menu.h"
+#include "BaseMenu.h"
+#include "Utils.h"
+#include "ItemsHolder.h"
+#include "utlvector.h"
+#include "utlrbtree.h"
+#include "Profiler.h"
+
+#define MAX_PROFILE_DEPTH	32
+#define MAX_PROFILE_EVENTS	262144	// trace is cut after that
+#define MAX_PROFILE_FILES	1000
+#define PROFILE_HOT_ITEMS	8		// outlined on screen
+#define PROFILE_SMOOTH		0.05	// weight of new frame in rolling average
+#define PROFILE_STALE_FRAMES	2	// item pointer not seen for that long may be reused
+
+struct profitem_t
+{
+	CMenuBaseItem *item;
+	char name[96];
+
+	double frameSelf[PROF_COUNT];	// accumulated in current frame
+	double frameTotal[PROF_COUNT];
+	double avgSelf[PROF_COUNT];		// rolling average, seconds
+	double avgTotal[PROF_COUNT];
+	double maxSelf;					// worst frame, draw and think together
+	int frames;
+	int lastFrame;
+	Point pos;						// where it was drawn last time
+	Size size;
+
+	bool operator<( const profitem_t &other ) const
+	{
+		return item < other.item;
+	}
+};
+
+struct profscope_t
+{
+	double start;
+	double children;	// time spent in nested scopes
+};
+
+struct profevent_t
+{
+	int index;			// in s_items, -1 for whole frame
+	int kind;
+	double start;
+	double duration;
+};
+
+static CUtlRBTree<profitem_t, int>	s_items( 0, 0 );
+static CUtlVector<profevent_t>		s_events;
+static profscope_t			s_stack[MAX_PROFILE_DEPTH];
+static cvar_t				*ui_profile;
+
+static bool	s_active;		// latched for whole frame
+static int	s_depth;
+static int	s_frame;
+static double	s_frameStart;
+
+static int	s_traceFrames;	// frames left to capture
+static double	s_traceStart;
+
+static const char *s_kindNames[PROF_COUNT] = { "draw", "think" };
+
+/*
+=================
+Profiler_ItemName
+
+window/item, items without name are told apart by position
+=================
+*/
+static void Profiler_ItemName( CMenuBaseItem *item, char *name, int size )
+{
+	CMenuItemsHolder *holder = item->Parent();
+	const char *label = item->szName;
+	char pos[32];
+
+	if( !label || !*label )
+		label = item->szTag;
+
+	if( !label || !*label )
+	{
+		snprintf( pos, sizeof( pos ), "%i,%i", item->pos.x, item->pos.y );
+		label = pos;
+	}
+
+	while( holder && !holder->IsWindow( ))
+		holder = holder->Parent();
+
+	// windows are parented to window that opened them
+	if( holder && !( item->IsWindow( )))
+		snprintf( name, size, "%s/%s", holder->szName ? holder->szName : "?", label );
+	else
+		Q_strncpy( name, label, size );
+}
+
+/*
+=================
+Profiler_FindItem
+=================
+*/
+static int Profiler_FindItem( CMenuBaseItem *item )
+{
+	profitem_t search;
+	int i;
+
+	search.item = item;
+	i = s_items.Find( search );
+
+	if( s_items.IsValidIndex( i ))
+	{
+		profitem_t &entry = s_items[i];
+
+		// freed item address was reused by another one, start over
+		if( entry.lastFrame < s_frame - PROFILE_STALE_FRAMES )
+		{
+			entry = profitem_t();
+			entry.item = item;
+			entry.lastFrame = s_frame;
+			Profiler_ItemName( item, entry.name, sizeof( entry.name ));
+		}
+
+		return i;
+	}
+
+	search = profitem_t();
+	search.item = item;
+	search.lastFrame = s_frame;
+	Profiler_ItemName( item, search.name, sizeof( search.name ));
+
+	return s_items.Insert( search );
+}
+
+void Profiler_Begin( void )
+{
+	if( !s_active )
+		return;
+
+	if( s_depth < MAX_PROFILE_DEPTH )
+	{
+		s_stack[s_depth].start = EngFuncs::DoubleTime();
+		s_stack[s_depth].children = 0.0;
+	}
+
+	s_depth++;
+}
+
+void Profiler_End( CMenuBaseItem *item, int kind )
+{
+	double total, self;
+	int i;
+
+	if( !s_active || s_depth <= 0 )
+		return;
+
+	// too deep to measure, parent will count it as own time
+	if( --s_depth >= MAX_PROFILE_DEPTH )
+		return;
+
+	profscope_t *scope = &s_stack[s_depth];
+
+	total = EngFuncs::DoubleTime() - scope->start;
+	self = total - scope->children;
+
+	if( s_depth > 0 )
+		s_stack[s_depth - 1].children += total;
+
+	i = Profiler_FindItem( item );
+
+	profitem_t &entry = s_items[i];
+	entry.frameSelf[kind] += self;
+	entry.frameTotal[kind] += total;
+	entry.lastFrame = s_frame;
+
+	if( kind == PROF_DRAW )
+	{
+		entry.pos = item->GetRenderPosition();
+		entry.size = item->GetRenderSize();
+	}
+
+	if( s_traceFrames > 0 && s_events.Count() < MAX_PROFILE_EVENTS )
+	{
+		profevent_t &ev = s_events[s_events.AddToTail()];
+
+		ev.index = i;
+		ev.kind = kind;
+		ev.start = scope->start - s_traceStart;
+		ev.duration = total;
+	}
+}
+
+/*
+=================================================================
+
+CHROME TRACE
+
+=================================================================
+*/
+static void Trace_Printf( CUtlVector<char> &buf, const char *fmt, ... )
+{
+	char text[256];
+	va_list args;
+	int len;
+
+	va_start( args, fmt );
+	len = vsnprintf( text, sizeof( text ), fmt, args );
+	va_end( args );
+
+	if( len <= 0 )
+		return;
+
+	if( len >= (int)sizeof( text ))
+		len = sizeof( text ) - 1;
+
+	memcpy( &buf[buf.AddMultipleToTail( len )], text, len );
+}
+
+static void Trace_String( CUtlVector<char> &buf, const char *str )
+{
+	buf.AddToTail( '"' );
+
+	for( ; *str; str++ )
+	{
+		unsigned char c = *str;
+
+		if( c == '"' || c == '\\' )
+		{
+			buf.AddToTail( '\\' );
+			buf.AddToTail( c );
+		}
+		else if( c < 0x20 )
+			Trace_Printf( buf, "\\u%04x", c );
+		else buf.AddToTail( c );
+	}
+
+	buf.AddToTail( '"' );
+}
+
+/*
+=================
+Profiler_WriteTrace
+
+Trace Event Format, complete events with microsecond timestamps
+=================
+*/
+static void Profiler_WriteTrace( void )
+{
+	CUtlVector<char> buf;
+	char filename[64];
+	int i;
+
+	for( i = 0; i < MAX_PROFILE_FILES; i++ )
+	{
+		snprintf( filename, sizeof( filename ), "profile/trace%03i.json", i );
+		if( !EngFuncs::FileExists( filename, TRUE ))
+			break;
+	}
+
+	if( i == MAX_PROFILE_FILES )
+	{
+		Con_Printf( "Profiler: too many traces, remove old ones\n" );
+		s_events.Purge();
+		return;
+	}
+
+	buf.EnsureCapacity( s_events.Count() * 96 + 64 );
+	Trace_Printf( buf, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n" );
+
+	FOR_EACH_VEC( s_events, j )
+	{
+		const profevent_t &ev = s_events[j];
+
+		Trace_Printf( buf, "%s{\"name\":", j ? ",\n" : "" );
+
+		if( ev.index < 0 )
+			Trace_String( buf, "frame" );
+		else Trace_String( buf, s_items[ev.index].name );
+
+		Trace_Printf( buf, ",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+			ev.index < 0 ? "frame" : s_kindNames[ev.kind], ev.start * 1000000.0, ev.duration * 1000000.0 );
+	}
+
+	Trace_Printf( buf, "\n]}\n" );
+
+	if( EngFuncs::COM_SaveFile( filename, &buf[0], buf.Count( )))
+		Con_Printf( "Profiler: %s, %i events%s\n", filename, s_events.Count(),
+			s_events.Count() >= MAX_PROFILE_EVENTS ? " (truncated)" : "" );
+	else Con_Printf( "Profiler: can't write %s\n", filename );
+
+	s_events.Purge();
+}
+
+/*
+=================================================================
+
+OVERLAY
+
+=================================================================
+*/
+static double Profiler_Cost( const profitem_t &entry )
+{
+	return entry.avgSelf[PROF_DRAW] + entry.avgSelf[PROF_THINK];
+}
+
+static int Profiler_CompareCost( const void *a, const void *b )
+{
+	double ca = Profiler_Cost( **(const profitem_t * const *)a );
+	double cb = Profiler_Cost( **(const profitem_t * const *)b );
+
+	return ( ca < cb ) - ( ca > cb );
+}
+
+/*
+=================
+Profiler_SortedItems
+
+collects items with timings, most expensive first
+=================
+*/
+static void Profiler_SortedItems( CUtlVector<profitem_t *> &list, bool onlyVisible )
+{
+	for( int i = s_items.FirstInorder(); s_items.IsValidIndex( i ); i = s_items.NextInorder( i ))
+	{
+		profitem_t &entry = s_items[i];
+
+		if( !entry.frames )
+			continue;
+
+		if( onlyVisible && ( entry.lastFrame != s_frame || !entry.frameTotal[PROF_DRAW] ))
+			continue;
+
+		list.AddToTail( &entry );
+	}
+
+	if( list.Count() > 1 )
+		qsort( &list[0], list.Count(), sizeof( list[0] ), Profiler_CompareCost );
+}
+
+/*
+=================
+Profiler_DrawOverlay
+
+outlines hottest visible items, red is the most expensive
+=================
+*/
+static void Profiler_DrawOverlay( void )
+{
+	CUtlVector<profitem_t *> list;
+	char text[64];
+	int charH;
+
+	Profiler_SortedItems( list, true );
+
+	if( !list.Count( ))
+		return;
+
+	charH = g_FontMgr->GetFontTall( uiStatic.hSmallFont );
+
+	for( int i = 0; i < list.Count() && i < PROFILE_HOT_ITEMS; i++ )
+	{
+		const profitem_t *entry = list[i];
+		int heat = 255 * ( PROFILE_HOT_ITEMS - i ) / PROFILE_HOT_ITEMS;
+		unsigned int color = PackRGBA( 255, 255 - heat, 0, 255 );
+		Point pos = entry->pos;
+
+		UI_DrawRectangle( entry->pos, entry->size, color );
+
+		snprintf( text, sizeof( text ), "%.2f ms", Profiler_Cost( *entry ) * 1000.0 );
+
+		// above the border, inside if it's at the top of screen
+		pos.y -= charH;
+		if( pos.y < 0 )
+			pos.y = entry->pos.y;
+
+		UI_DrawString( uiStatic.hSmallFont, pos, Size( entry->size.w > 0 ? entry->size.w : 256, charH ),
+			text, color, charH, QM_TOPLEFT, ETF_SHADOW | ETF_NOSIZELIMIT );
+	}
+}
+
+/*
+=================================================================
+
+FRAME
+
+=================================================================
+*/
+bool Profiler_IsActive( void )
+{
+	return s_active;
+}
+
+void Profiler_BeginFrame( void )
+{
+	s_depth = 0;
+	s_active = s_traceFrames > 0 || ( ui_profile && ui_profile->value );
+
+	if( !s_active )
+		return;
+
+	s_frame++;
+	s_frameStart = EngFuncs::DoubleTime();
+
+	if( s_traceFrames > 0 && !s_events.Count( ))
+		s_traceStart = s_frameStart;
+}
+
+void Profiler_EndFrame( void )
+{
+	double self;
+
+	if( !s_active )
+		return;
+
+	// fold this frame into rolling averages
+	for( int i = s_items.FirstInorder(); s_items.IsValidIndex( i ); i = s_items.NextInorder( i ))
+	{
+		profitem_t &entry = s_items[i];
+
+		if( entry.lastFrame != s_frame )
+			continue;
+
+		for( int k = 0; k < PROF_COUNT; k++ )
+		{
+			if( !entry.frames )
+			{
+				entry.avgSelf[k] = entry.frameSelf[k];
+				entry.avgTotal[k] = entry.frameTotal[k];
+			}
+			else
+			{
+				entry.avgSelf[k] += ( entry.frameSelf[k] - entry.avgSelf[k] ) * PROFILE_SMOOTH;
+				entry.avgTotal[k] += ( entry.frameTotal[k] - entry.avgTotal[k] ) * PROFILE_SMOOTH;
+			}
+		}
+
+		self = entry.frameSelf[PROF_DRAW] + entry.frameSelf[PROF_THINK];
+		if( self > entry.maxSelf )
+			entry.maxSelf = self;
+
+		entry.frames++;
+	}
+
+	if( s_traceFrames > 0 )
+	{
+		if( s_events.Count() < MAX_PROFILE_EVENTS )
+		{
+			profevent_t &ev = s_events[s_events.AddToTail()];
+
+			ev.index = -1;
+			ev.kind = 0;
+			ev.start = s_frameStart - s_traceStart;
+			ev.duration = EngFuncs::DoubleTime() - s_frameStart;
+		}
+
+		if( --s_traceFrames == 0 )
+			Profiler_WriteTrace();
+	}
+
+	// per frame accumulators are cleared after overlay used them
+	s_active = false;
+
+	if( ui_profile->value == 1.0f )
+		Profiler_DrawOverlay();
+
+	for( int i = s_items.FirstInorder(); s_items.IsValidIndex( i ); i = s_items.NextInorder( i ))
+	{
+		profitem_t &entry = s_items[i];
+
+		memset( entry.frameSelf, 0, sizeof( entry.frameSelf ));
+		memset( entry.frameTotal, 0, sizeof( entry.frameTotal ));
+	}
+}
+
+/*
+=================================================================
+
+COMMANDS
+
+=================================================================
+*/
+static void UI_ProfileDump_f( void )
+{
+	CUtlVector<profitem_t *> list;
+	int count = 30;
+
+	if( EngFuncs::CmdArgc() > 1 )
+		count = Q_max( 1, atoi( EngFuncs::CmdArgv( 1 )));
+
+	Profiler_SortedItems( list, false );
+
+	if( !list.Count( ))
+	{
+		Con_Printf( "Profiler: nothing measured, set ui_profile 1 or 2\n" );
+		return;
+	}
+
+	Con_Printf( "%9s %9s %9s %9s %6s  %s\n", "draw ms", "think ms", "incl ms", "max ms", "frames", "item" );
+
+	for( int i = 0; i < list.Count() && i < count; i++ )
+	{
+		const profitem_t *entry = list[i];
+
+		Con_Printf( "%9.3f %9.3f %9.3f %9.3f %6i  %s%s\n",
+			entry->avgSelf[PROF_DRAW] * 1000.0, entry->avgSelf[PROF_THINK] * 1000.0,
+			( entry->avgTotal[PROF_DRAW] + entry->avgTotal[PROF_THINK] ) * 1000.0,
+			entry->maxSelf * 1000.0, entry->frames, entry->name,
+			entry->lastFrame != s_frame ? " (gone)" : "" );
+	}
+
+	Con_Printf( "%i of %i items\n", Q_min( count, list.Count( )), list.Count( ));
+}
+
+static void UI_ProfileReset_f( void )
+{
+	// trace events refer to items by index
+	if( s_traceFrames > 0 )
+	{
+		s_traceFrames = 0;
+		s_events.RemoveAll();
+		Con_Printf( "Profiler: trace capture cancelled\n" );
+	}
+
+	s_items.RemoveAll();
+	Con_Printf( "Profiler: timings cleared\n" );
+}
+
+static void UI_ProfileTrace_f( void )
+{
+	int frames = 100;
+
+	if( EngFuncs::CmdArgc() > 1 )
+		frames = Q_max( 1, atoi( EngFuncs::CmdArgv( 1 )));
+
+	if( s_traceFrames > 0 )
+	{
+		Con_Printf( "Profiler: trace is already being captured\n" );
+		return;
+	}
+
+	s_events.RemoveAll();
+	s_traceFrames = frames;
+	Con_Printf( "Profiler: capturing %i frames\n", frames );
+}
+
+void Profiler_Init( void )
+{
+	SetDefLessFunc( s_items );
+
+	ui_profile = EngFuncs::CvarRegister( "ui_profile", "0", 0 );
+
+	EngFuncs::Cmd_AddCommand( "ui_profile_dump", UI_ProfileDump_f );
+	EngFuncs::Cmd_AddCommand( "ui_profile_reset", UI_ProfileReset_f );
+	EngFuncs::Cmd_AddCommand( "ui_profile_trace", UI_ProfileTrace_f );
+}
+
+void Profiler_Shutdown( void )
+{
+	EngFuncs::Cmd_RemoveCommand( "ui_profile_dump" );
+	EngFuncs::Cmd_RemoveCommand( "ui_profile_reset" );
+	EngFuncs::Cmd_RemoveCommand( "ui_profile_trace" );
+
+	s_items.Purge();
+	s_events.Purge();
+	s_traceFrames = 0;
+	s_active = false;
+	ui_profile = NULL;
+}
@@ -0,0 +1,51 @@
+/*
+Profiler.h - per-widget draw and think timings
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+class CMenuBaseItem;
+
+enum
+{
+	PROF_DRAW = 0,
+	PROF_THINK,
+
+	PROF_COUNT
+};
+
+/*
+ * ui_profile 1 measures Draw() and Think() of every item and window
+ * and outlines the most expensive ones with their cost, ui_profile 2
+ * only measures. Times are self times, nested items are not counted
+ * in their holder, averaged over recent frames.
+ *
+ * ui_profile_dump [count] prints items sorted by cost
+ * ui_profile_reset clears collected timings
+ * ui_profile_trace [frames] writes profile/traceXXX.json for chrome://tracing
+ **/
+void Profiler_Init( void );
+void Profiler_Shutdown( void );
+void Profiler_BeginFrame( void );
+void Profiler_EndFrame( void );
+
+// true between BeginFrame and EndFrame of measured frame
+bool Profiler_IsActive( void );
+
+// wraps single Draw() or Think() call, does nothing while disabled
+void Profiler_Begin( void );
+void Profiler_End( CMenuBaseItem *item, int kind );
+
+#endif // PROFILER_H
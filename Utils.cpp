@@ -521,15 +521,15 @@ get position of previous printful char
 */
 int Con_UtfMoveLeft( const char *str, int pos )
 {
-	int i, k = 0;
-	// int j;
-	Con_UtfProcessChar( 0 );
-	if(pos == 1) return 0;
-	for( i = 0; i < pos-1; i++ )
-		if( Con_UtfProcessChar( (unsigned char)str[i] ) )
-			k = i+1;
-	Con_UtfProcessChar( 0 );
-	return k;
+	if( pos <= 1 )
+		return 0;
+
+	// step back over continuation bytes
+	pos--;
+	while( pos > 0 && ( str[pos] & 0xC0 ) == 0x80 )
+		pos--;
+
+	return pos;
 }
 
 /*
@@ -541,16 +541,14 @@ get next of previous printful char
 */
 int Con_UtfMoveRight( const char *str, int pos, int length )
 {
-	int i;
-	Con_UtfProcessChar( 0 );
-	for( i = pos; i <= length; i++ )
-	{
-		if( Con_UtfProcessChar( (unsigned char)str[i] ) )
-			return i+1;
-	}
-	Con_UtfProcessChar( 0 );
+	int len;
+
+	if( pos >= length )
+		return pos + 1;
+
+	Utf8_Decode( str + pos, len );
 
-	return pos + 1;
+	return pos + len;
 }
 
 
@@ -425,4 +425,77 @@ int Con_UtfProcessChar(int in );
 int Con_UtfMoveLeft( const char *str, int pos );
 int Con_UtfMoveRight( const char *str, int pos, int length );
 
+/*
+ * Stateless UTF-8 decoder, returns codepoint at str and its length in bytes.
+ * Broken sequences give 0 and length 1, so callers just skip them.
+ * Never reads past terminating zero
+ */
+inline int Utf8_Decode( const char *str, int &len )
+{
+	const unsigned char *s = (const unsigned char *)str;
+	int uc, n, i;
+
+	// ascii fast path
+	if( s[0] < 0x80 )
+	{
+		len = 1;
+		return s[0];
+	}
+
+	if( s[0] >= 0xF8 || s[0] < 0xC0 )
+	{
+		len = 1;
+		return 0;
+	}
+	else if( s[0] >= 0xF0 )
+	{
+		uc = s[0] & 0x07;
+		n = 3;
+	}
+	else if( s[0] >= 0xE0 )
+	{
+		uc = s[0] & 0x0F;
+		n = 2;
+	}
+	else
+	{
+		uc = s[0] & 0x1F;
+		n = 1;
+	}
+
+	for( i = 1; i <= n; i++ )
+	{
+		if(( s[i] & 0xC0 ) != 0x80 )
+		{
+			len = 1;
+			return 0;
+		}
+
+		uc = ( uc << 6 ) | ( s[i] & 0x3F );
+	}
+
+	len = n + 1;
+	return uc;
+}
+
+// length of ascii run at str, checks 8 bytes at once
+inline int Utf8_ASCIIRun( const char *str, int maxLen )
+{
+	unsigned int w[2];
+	int i = 0;
+
+	for( ; i + 8 <= maxLen; i += 8 )
+	{
+		memcpy( w, str + i, sizeof( w ));
+
+		if(( w[0] | w[1] ) & 0x80808080 )
+			break;
+	}
+
+	while( i < maxLen && !( str[i] & 0x80 ))
+		i++;
+
+	return i;
+}
+
 #endif//UTILS_H
@@ -17,6 +17,8 @@ GNU General Public License for more details.
 #include "WindowSystem.h"
 #include "BaseWindow.h"
 #include "con_nprint.h"
+#include "Profiler.h"
+#include "DrawList.h"
 
 void CWindowStack::VidInit( bool calledOnce )
 {
@@ -88,7 +90,9 @@ void CWindowStack::Update( )
 
 	FOR_EACH_LL_BACK( stack, i )
 	{
+		Profiler_Begin();
 		stack[i]->Think(); // any window must think
+		Profiler_End( stack[i], PROF_THINK );
 
 		if( i == active )
 			continue; // will be added last
@@ -155,6 +159,9 @@ void CWindowStack::Update( )
 		stack.Remove( removeList[j] );
 	}
 
+	// windows are recorded and submitted at once, see DrawList.h
+	DrawList_Begin();
+
 	FOR_EACH_VEC_BACK( drawList, k )
 	{
 		CMenuBaseWindow *window = drawList[k];
@@ -166,7 +173,11 @@ void CWindowStack::Update( )
 		}
 
 		if( !window->eTransitionType )
+		{
+			Profiler_Begin();
 			drawList[k]->Draw();
+			Profiler_End( drawList[k], PROF_DRAW );
+		}
 
 		if( k != drawList.Count() - 1 )
 		{
@@ -180,6 +191,8 @@ void CWindowStack::Update( )
 		}
 	}
 
+	DrawList_End();
+
 	if( ui_show_window_stack && ui_show_window_stack->value )
 	{
 		con_nprint_t con;
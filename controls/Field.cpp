@@ -37,6 +37,10 @@ CMenuField::CMenuField() : BaseClass()
 	iRealWidth = 0;
 	szBackground = 0;
 	szBuffer[0] = 0;
+	m_iWidths[0] = 0;
+	m_iKerns[0] = 0;
+	m_iCodes[0] = 0;
+	m_iFontGeneration = -1;
 }
 
 void CMenuField::Init()
@@ -56,10 +60,13 @@ void CMenuField::VidInit( void )
 {
 	BaseClass::VidInit();
 
-	iCursor = strlen( szBuffer );
-	iScroll = g_FontMgr->CutText( font, szBuffer, m_scChSize, iRealWidth, true );
-
 	iRealWidth = m_scSize.w - UI_OUTLINE_WIDTH * 2;
+
+	// font or its size may be changed
+	UpdateWidths( 0 );
+
+	iCursor = strlen( szBuffer );
+	iScroll = ScrollToEnd();
 }
 
 /*
@@ -130,6 +137,168 @@ void CMenuField::Clear( void )
 	memset( szBuffer, 0, UI_MAX_FIELD_LINE );
 	iCursor = 0;
 	iScroll = 0;
+	UpdateWidths( 0 );
+}
+
+/*
+================
+CMenuField::UpdateWidths
+
+Everything before edit position is still valid. Restart at last character
+before it, because it may be incomplete UTF-8 sequence or kerned with new one
+================
+*/
+void CMenuField::UpdateWidths( int from )
+{
+	int len = strlen( szBuffer );
+	int i, wide, prev = 0;
+
+	from = bound( 0, from, len );
+
+	for( i = from; i > 0 && !m_iCodes[i - 1]; i-- );
+
+	if( i > 0 )
+		i--;
+
+	for( int j = i - 1; j >= 0; j-- )
+	{
+		if( m_iCodes[j] )
+		{
+			prev = m_iCodes[j];
+			break;
+		}
+	}
+
+	if( i == 0 )
+	{
+		m_iWidths[0] = 0;
+		m_iFontGeneration = g_FontMgr->GetFontGeneration();
+	}
+
+	wide = m_iWidths[i];
+
+	while( i < len )
+	{
+		int charLen, ch;
+
+		// stars don't hide color codes
+		if( !bHideInput && IsColorString( szBuffer + i ))
+		{
+			m_iCodes[i] = m_iCodes[i + 1] = 0;
+			m_iKerns[i] = m_iKerns[i + 1] = 0;
+			m_iWidths[i + 1] = m_iWidths[i + 2] = wide;
+			i += 2;
+			continue;
+		}
+
+		ch = Utf8_Decode( szBuffer + i, charLen );
+
+		if( ch && bHideInput )
+			ch = '*';
+
+		m_iCodes[i] = ch;
+		m_iKerns[i] = 0;
+
+		if( ch )
+		{
+			m_iKerns[i] = g_FontMgr->GetKerningScaled( font, prev, ch, m_scChSize );
+			wide += g_FontMgr->GetCharacterWidthScaled( font, ch, m_scChSize ) + m_iKerns[i];
+			prev = ch;
+		}
+
+		// UTF-8 tail belongs to character start
+		for( int j = 1; j < charLen; j++ )
+		{
+			m_iCodes[i + j] = m_iKerns[i + j] = 0;
+			m_iWidths[i + j] = m_iWidths[i];
+		}
+
+		i += charLen;
+		m_iWidths[i] = wide;
+	}
+
+	m_iCodes[len] = m_iKerns[len] = 0;
+}
+
+/*
+================
+CMenuField::TextWidth
+
+Wide of buffer part as it's drawn, first character isn't kerned with previous one
+================
+*/
+int CMenuField::TextWidth( int start, int end ) const
+{
+	if( end <= start )
+		return 0;
+
+	return m_iWidths[end] - m_iWidths[start] - m_iKerns[start];
+}
+
+/*
+================
+CMenuField::VisibleEnd
+
+Same as CutText, but it's a binary search over prefix widths
+================
+*/
+int CMenuField::VisibleEnd( int start, int width, bool *remaining ) const
+{
+	int len = strlen( szBuffer );
+	int lo = start, hi = len;
+
+	// last position that is still narrower than width
+	while( lo < hi )
+	{
+		int mid = ( lo + hi + 1 ) / 2;
+
+		if( TextWidth( start, mid ) < width )
+			lo = mid;
+		else
+			hi = mid - 1;
+	}
+
+	// don't cut characters and color codes
+	while( lo > start && lo < len && ( szBuffer[lo] & 0xC0 ) == 0x80 )
+		lo--;
+
+	if( lo > start && lo < len && IsColorString( szBuffer + lo - 1 ))
+		lo++;
+
+	if( remaining )
+		*remaining = lo < len;
+
+	return lo;
+}
+
+/*
+================
+CMenuField::ScrollToEnd
+================
+*/
+int CMenuField::ScrollToEnd( void ) const
+{
+	int len = strlen( szBuffer );
+	int lo = 0, hi = len;
+
+	// first position from which rest of buffer fits
+	while( lo < hi )
+	{
+		int mid = ( lo + hi ) / 2;
+
+		if( TextWidth( mid, len ) <= iRealWidth )
+			hi = mid;
+		else
+			lo = mid + 1;
+	}
+
+	while( lo < len && ( szBuffer[lo] & 0xC0 ) == 0x80 )
+		lo++;
+
+	if( lo > 0 && IsColorString( szBuffer + lo - 1 ))
+		lo--;
+
+	return lo;
 }
 
 /*
@@ -164,7 +333,7 @@ bool CMenuField::KeyDown( int key )
 		{
 			bool remaining;
 
-			int maxIdx = g_FontMgr->CutText( font, szBuffer + iScroll, m_scChSize, iRealWidth, false, false, NULL, &remaining );
+			int maxIdx = VisibleEnd( iScroll, iRealWidth, &remaining );
 
 			if( iCursor < len ) iCursor = EngFuncs::UtfMoveRight( szBuffer, iCursor, len );
 			if( remaining && iCursor > maxIdx ) iScroll = EngFuncs::UtfMoveRight( szBuffer, iScroll, len );
@@ -176,7 +345,7 @@ bool CMenuField::KeyDown( int key )
 		else if( UI::Key::IsEnd( key ))
 		{
 			iCursor = len;
-			iScroll = g_FontMgr->CutText( font, szBuffer, m_scChSize, iRealWidth, true );
+			iScroll = ScrollToEnd();
 		}
 		else if( UI::Key::IsBackspace( key ))
 		{
@@ -184,6 +353,7 @@ bool CMenuField::KeyDown( int key )
 			{
 				int pos = EngFuncs::UtfMoveLeft( szBuffer, iCursor );
 				memmove( szBuffer + pos, szBuffer + iCursor, len - iCursor + 1 );
+				UpdateWidths( pos );
 				iCursor = pos;
 				if( iScroll )
 					iScroll = EngFuncs::UtfMoveLeft( szBuffer, iScroll );
@@ -195,8 +365,9 @@ bool CMenuField::KeyDown( int key )
 			{
 				int pos = EngFuncs::UtfMoveRight( szBuffer, iCursor, len );
 				memmove( szBuffer + iCursor, szBuffer + pos, len - pos + 1 );
+				UpdateWidths( iCursor );
 
-				iScroll = g_FontMgr->CutText( font, szBuffer, m_scChSize, iRealWidth, true );
+				iScroll = ScrollToEnd();
 			}
 		}
 		else if( UI::Key::IsLeftMouse( key ))
@@ -213,7 +384,8 @@ bool CMenuField::KeyDown( int key )
 				bool remaining;
 				int newScroll = iScroll;
 
-				int iWidthInChars = g_FontMgr->CutText( font, szBuffer + iScroll, m_scChSize, iRealWidth, false, false, &w, &remaining );
+				int iWidthInChars = VisibleEnd( iScroll, iRealWidth, &remaining ) - iScroll;
+				w = TextWidth( iScroll, iScroll + iWidthInChars );
 
 				if( eTextAlignment & QM_LEFT )
 				{
@@ -235,7 +407,7 @@ bool CMenuField::KeyDown( int key )
 				{
 					x = m_scPos.x + (m_scSize.w - w) / 2;
 				}
-				charpos = g_FontMgr->CutText(font, szBuffer + newScroll, m_scChSize, uiStatic.cursorX - x, false, false, &w, &remaining );
+				charpos = VisibleEnd( newScroll, uiStatic.cursorX - x, &remaining ) - newScroll;
 
 				iCursor = charpos + iScroll;
 				if( iCursor > 0 )
@@ -299,7 +471,7 @@ void CMenuField::Char( int key )
 	{
 		// ctrl-e is end
 		iCursor = len;
-		iScroll = g_FontMgr->CutText( font, szBuffer, m_scChSize, iRealWidth, true );
+		iScroll = ScrollToEnd();
 	}
 	else if( key == '^' && !( bAllowColorstrings ))
 	{
@@ -337,6 +509,7 @@ void CMenuField::Char( int key )
 		// TODO ???
 
 		szBuffer[iCursor] = key;
+		UpdateWidths( iCursor );
 		iCursor++;
 		changed = true;
 	}
@@ -346,6 +519,7 @@ void CMenuField::Char( int key )
 		if( len == iMaxLength - 1 ) return; // all full
 		memmove( szBuffer + iCursor + 1, szBuffer + iCursor, len + 1 - iCursor );
 		szBuffer[iCursor] = key;
+		UpdateWidths( iCursor );
 		iCursor++;
 		changed = true;
 	}
@@ -353,7 +527,8 @@ void CMenuField::Char( int key )
 	if( iCursor > len )
 	{
 		szBuffer[iCursor] = 0;
-		iScroll = g_FontMgr->CutText( font, szBuffer, m_scChSize, iRealWidth, true );
+		UpdateWidths( iCursor );
+		iScroll = ScrollToEnd();
 		changed = true;
 	}
 
@@ -378,6 +553,10 @@ void CMenuField::Draw( void )
 
 	textflags |= ETF_NOSIZELIMIT;
 
+	// placeholder font could be replaced by font built in background
+	if( m_iFontGeneration != g_FontMgr->GetFontGeneration( ))
+		UpdateWidths( 0 );
+
 	if( szStatusText && iFlags & QMF_NOTIFY )
 	{
 		int	x;
@@ -404,7 +583,7 @@ void CMenuField::Draw( void )
 		cursor_char[0] = 11;
 	else cursor_char[0] = '_';
 
-	drawLen = g_FontMgr->CutText( font, szBuffer + iScroll, m_scChSize, m_scSize.w, false );
+	drawLen = VisibleEnd( iScroll, m_scSize.w ) - iScroll;
 	len = strlen( szBuffer ) + 1;
 
 	// guarantee that cursor will be visible
@@ -431,19 +610,24 @@ void CMenuField::Draw( void )
 
 	if( bHideInput )
 	{
-		EngFuncs::UtfProcessChar( 0 );
-
 		const char *sz = szBuffer + prestep;
-		int i, j;
-		for( i = 0, j = 0; i < drawLen; i++ )
+		int i, j, len;
+		for( i = 0, j = 0; i < drawLen; )
 		{
-			int uch = EngFuncs::UtfProcessChar( (unsigned char)sz[i] );
-			if( uch )
+			// every ascii byte is a character
+			len = Utf8_ASCIIRun( sz + i, drawLen - i );
+			memset( text + j, '*', len );
+			i += len;
+			j += len;
+
+			if( i >= drawLen )
+				break;
+
+			if( Utf8_Decode( sz + i, len ))
 				text[j++] = '*';
+			i += len;
 		}
 		text[j] = 0;
-
-		EngFuncs::UtfProcessChar( 0 );
 	}
 	else
 	{
@@ -485,22 +669,25 @@ void CMenuField::Draw( void )
 		return; // no focus
 	}
 
+	// positions in buffer, drawn text may be replaced by stars
+	int textEnd = Q_min( prestep + drawLen, len - 1 );
+
 	if( eTextAlignment & QM_LEFT )
 	{
 		x = newPos.x;
 	}
 	else if( eTextAlignment & QM_RIGHT )
 	{
-		x = newPos.x + (m_scSize.w - g_FontMgr->GetTextWideScaled( font, text, m_scChSize ) );
+		x = newPos.x + (m_scSize.w - TextWidth( prestep, textEnd ));
 	}
 	else
 	{
-		x = newPos.x + (m_scSize.w - g_FontMgr->GetTextWideScaled( font, text, m_scChSize )) / 2;
+		x = newPos.x + (m_scSize.w - TextWidth( prestep, textEnd )) / 2;
 	}
 
 	UI_DrawString( font, newPos, m_scSize, text, colorBase, m_scChSize, eTextAlignment, textflags );
 
-	int cursorOffset = cursor? g_FontMgr->GetTextWideScaled( font, text, m_scChSize, cursor ):0;
+	int cursorOffset = cursor ? TextWidth( prestep, Q_min( prestep + cursor, len - 1 )) : 0;
 
 	// int cursorOffset = 0;
 
@@ -541,6 +728,7 @@ void CMenuField::UpdateEditable()
 	if( szValue )
 	{
 		Q_strncpy( szBuffer, szValue, iMaxLength );
+		UpdateWidths( 0 );
 	}
 }
 
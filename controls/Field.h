@@ -46,8 +46,9 @@ public:
 	void SetBuffer( const char *buffer )
 	{
 		Q_strncpy( szBuffer, buffer, UI_MAX_FIELD_LINE );
+		UpdateWidths( 0 );
 		iCursor = strlen( szBuffer );
-		iScroll = g_FontMgr->CutText( font, szBuffer, m_scChSize, iRealWidth, true );
+		iScroll = ScrollToEnd();
 		SetCvarString( szBuffer );
 	}
 
@@ -66,12 +67,26 @@ protected:
 	void _Event( int ev ) override;
 
 private:
+	/*
+	 * Widths of buffer prefixes, so scrolling and cursor placement don't measure text.
+	 * Recalculated from edit position to the end of buffer after every change
+	 */
+	void UpdateWidths( int from );
+	int  TextWidth( int start, int end ) const;
+	int  VisibleEnd( int start, int width, bool *remaining = NULL ) const; // first byte that doesn't fit
+	int  ScrollToEnd( void ) const; // scroll that shows end of buffer
+
 	char	szBuffer[UI_MAX_FIELD_LINE];
 	int		iCursor;
 	int		iScroll;
 
 	int		iRealWidth;
 
+	int		m_iWidths[UI_MAX_FIELD_LINE]; // scaled wide of everything before byte
+	int		m_iKerns[UI_MAX_FIELD_LINE];  // kerning with previous character, included in next width
+	int		m_iCodes[UI_MAX_FIELD_LINE];  // drawn character starting at byte, 0 for color codes and UTF-8 tails
+	int		m_iFontGeneration;            // g_FontMgr generation widths were measured with
+
 	bool	m_bOverrideOverstrike;
 };
 
@@ -18,6 +18,7 @@ GNU General Public License for more details.
 #include "PicButton.h"
 #include "ItemsHolder.h"
 #include "Scissor.h"
+#include "Profiler.h"
 #include <string.h>
 
 CMenuItemsHolder::CMenuItemsHolder() :
@@ -267,7 +268,9 @@ void CMenuItemsHolder::Draw( )
 		if( !item->IsVisible() )
 			continue;
 
+		Profiler_Begin();
 		item->Draw();
+		Profiler_End( item, PROF_DRAW );
 
 		if( ui_borderclip->value )
 			UI_DrawRectangle( item->m_scPos, item->m_scSize, PackRGBA( 255, 0, 0, 255 ) );
@@ -278,7 +281,9 @@ void CMenuItemsHolder::Think( void )
 {
 	FOR_EACH_VEC( m_pItems, i )
 	{
+		Profiler_Begin();
 		m_pItems[i]->Think();
+		Profiler_End( m_pItems[i], PROF_THINK );
 	}
 }
 
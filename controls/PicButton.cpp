@@ -270,14 +270,22 @@ void CMenuPicButton::Draw( )
 
             if( szName && szName[ 0 ] != '\0' )
             {
-                int i = 0;
-                while( char c = szName[ i++ ] )
+                int i = 0, prev = 0;
+                while( szName[ i ] )
                 {
                     // unicode
-                    int uch       = EngFuncs::UtfProcessChar( static_cast< unsigned char >( c ) );
-                    int charWidth = g_FontMgr->GetCharacterWidthScaled( font, uch, charHeight );
+                    int len;
+                    int uch       = Utf8_Decode( szName + i, len );
+                    int charWidth = uch ? g_FontMgr->GetCharacterWidthScaled( font, uch, charHeight ) : 0;
+
+                    if( uch )
+                    {
+                        charWidth += g_FontMgr->GetKerningScaled( font, prev, uch, charHeight );
+                        prev = uch;
+                    }
 
                     strWidth += charWidth;
+                    i += len;
                 }
             }
 
@@ -14,7 +14,14 @@ GNU General Public License for more details.
 */
 #include "BaseFontBackend.h"
 #include "FontManager.h"
+#include "GlyphKernels.h"
+#include "SkylinePacker.h"
+#include "LZ4Block.h"
+#include "TextBatch.h"
+#include "DistanceField.h"
+#include "FontFile.h"
 #include <math.h>
+#include <sys/stat.h>
 #include "Utils.h"
 #include "miniutl/utlbuffer.h"
 
@@ -22,12 +29,16 @@ CBaseFont::CBaseFont()
 	: m_iTall(), m_iWeight(), m_iFlags(),
 	m_iHeight(), m_iMaxCharWidth(), m_iAscent(),
 	m_iBlur(), m_fBrighten(),
-	m_iEllipsisWide( 0 ),
-	m_glyphs(0, 0), m_ABCCache( 0, 0 )
+	m_iEllipsisWide( 0 ), m_iWastedBytes( 0 ),
+	m_bAtlasLoaded( false ), m_pSDF( NULL ), m_iDynClock( 0 ),
+	m_glyphs(0, 0), m_iCharHashCount( 0 ),
+	m_iKernCount( 0 ), m_iFallbacks( 0 )
 {
 	m_szName[0] = 0;
+	memset( m_pFallbacks, 0, sizeof( m_pFallbacks ));
 	SetDefLessFunc( m_glyphs );
-	SetDefLessFunc( m_ABCCache );
+	memset( m_CharTable, 0, sizeof( m_CharTable ));
+	memset( m_KernLeft, 0, sizeof( m_KernLeft ));
 }
 
 
@@ -59,6 +70,11 @@ void CBaseFont::GetTextureName(char *dst, size_t len) const
 		int chars = snprintf( attribs + i, sizeof( attribs ) - 1 - i, "s%i%.2f", m_iScanlineOffset, m_fScanlineScale );
 		i += chars;
 	}
+	if( m_iFallbacks )
+	{
+		int chars = snprintf( attribs + i, sizeof( attribs ) - 1 - i, "f%i", m_iFallbacks );
+		i += chars;
+	}
 	attribs[i] = 0;
 
 	if( i == 0 )
@@ -74,198 +90,1199 @@ void CBaseFont::GetTextureName(char *dst, size_t len) const
 	}
 }
 
-#define MAX_PAGE_SIZE 256
+#define MIN_PAGE_SIZE 64
+#define MAX_PAGE_SIZE 4096
 
-void CBaseFont::UploadGlyphsForRanges(charRange_t *range, int rangeSize)
+struct rasterjobs_t
+{
+	CBaseFont *font;
+	const int *chars;
+	int *widths;
+	byte *staging;   // one maxWidth x height slot per glyph
+	Size slotSize;
+};
+
+/*
+=========================
+CBaseFont::RasterizeGlyphJob
+
+Every glyph gets its own staging slot, so jobs don't depend on each other
+and atlas is packed in range order after all of them are done
+=========================
+*/
+void CBaseFont::RasterizeGlyphJob( void *ctx, int index, int thread )
+{
+	rasterjobs_t *jobs = (rasterjobs_t *)ctx;
+	const int slotBytes = jobs->slotSize.w * jobs->slotSize.h * 4;
+	byte *slot = &jobs->staging[index * slotBytes];
+	Size drawSize;
+
+	memset( slot, 0, slotBytes );
+	jobs->font->RasterizeGlyph( jobs->chars[index], jobs->slotSize, slot, drawSize, thread );
+
+	jobs->widths[index] = bound( 0, drawSize.w, jobs->slotSize.w );
+}
+
+/*
+=========================
+CBaseFont::RasterizeGlyph
+
+Distance field glyphs have blur and outline baked in by thresholds,
+only effects that don't depend on glyph shape are applied here
+=========================
+*/
+void CBaseFont::RasterizeGlyph( int ch, Size sz, byte *rgba, Size &drawSize, int thread )
+{
+	CBaseFont *source = GetGlyphSource( ch );
+
+	// fallback face has same effects and baseline, its glyph goes to atlas as is
+	if( source != this )
+	{
+		source->GetCharRGBA( ch, Point( 0, 0 ), sz, rgba, drawSize, thread );
+		return;
+	}
+
+	if( !m_pSDF )
+	{
+		GetCharRGBA( ch, Point( 0, 0 ), sz, rgba, drawSize, thread );
+		return;
+	}
+
+	CSDFSource::resolve_t params;
+
+	params.scale = (float)m_iTall / SDF_REFERENCE_TALL;
+	params.offsetX = GetEfxOffset();
+	params.baselineY = m_iAscent;
+	params.blur = m_iBlur;
+	params.brighten = m_fBrighten;
+	params.outline = m_iOutlineSize;
+
+	m_pSDF->Resolve( ch, params, sz, rgba, drawSize );
+
+	ApplyScanline( sz, rgba );
+	ApplyStrikeout( sz, rgba );
+}
+
+/*
+=========================
+CBaseFont::RenderGlyphs
+
+Render everything to staging buffer, so we know glyph sizes before packing
+=========================
+*/
+void CBaseFont::RenderGlyphs( charRange_t *range, int rangeSize )
+{
+	const int maxWidth = GetMaxCharWidth();
+	const int height = GetHeight();
+	const int slotBytes = maxWidth * height * 4; // max possible glyph size
+
+	m_PendingChars.RemoveAll();
+
+	BuildKerningTable( range, rangeSize );
+
+	for( int iRange = 0; iRange < rangeSize; iRange++ )
+	{
+		size_t size = range[iRange].Length();
+
+		for( size_t j = 0; j < size; j++ )
+		{
+			int ch = range[iRange].Character( j );
+
+			// fill ABC and glyph source cache here, so workers only read it
+			int a, b, c;
+			GetCharABCWidths( ch, a, b, c );
+
+			m_PendingChars.AddToTail( ch );
+		}
+	}
+
+	BuildBlurKernel();
+
+	rasterjobs_t jobs;
+
+	m_PendingWidths.SetCount( m_PendingChars.Count() );
+	m_PendingStaging.SetCount( m_PendingChars.Count() * slotBytes );
+
+	jobs.font = this;
+	jobs.chars = m_PendingChars.Base();
+	jobs.widths = m_PendingWidths.Base();
+	jobs.staging = m_PendingStaging.Base();
+	jobs.slotSize = Size( maxWidth, height );
+
+	if( m_pSDF )
+	{
+		// fields are built on main thread, resolving them doesn't touch backend
+		m_pSDF->Prepare( m_PendingChars.Base(), m_PendingChars.Count() );
+
+		// but glyphs from fallback faces are still rasterized
+		if( !m_iFallbacks )
+		{
+			GlyphWorkers_Run( RasterizeGlyphJob, &jobs, m_PendingChars.Count(), GlyphWorkers_Count() );
+			return;
+		}
+	}
+
+	int threads = PrepareFaceWorkers( GlyphWorkers_Count() );
+	GlyphWorkers_Run( RasterizeGlyphJob, &jobs, m_PendingChars.Count(), threads );
+	ReleaseFaceWorkers();
+}
+
+void CBaseFont::GetPendingRects( CUtlVector<CSkylinePacker::rect_t> &rects ) const
+{
+	for( int i = 0; i < m_PendingChars.Count(); i++ )
+	{
+		CSkylinePacker::rect_t rect;
+		rect.w = m_PendingWidths[i];
+		rect.h = GetHeight() + 1; // HACKHACK: Add more space between rows, this removes ugly 1 height pixel rubbish
+		rect.x = rect.y = 0;
+		rect.id = m_PendingChars[i];
+
+		rects.AddToTail( rect );
+	}
+}
+
+/*
+=========================
+CBaseFont::Atlas8BitSupported
+
+Engine image loader may not know palettized BMPs, check it once with tiny image
+=========================
+*/
+bool CBaseFont::Atlas8BitSupported( void )
+{
+	static int supported = -1;
+
+	if( supported < 0 )
+	{
+		CBMP bmp( 4, 4, 1 );
+
+		SetAtlasPalette( &bmp, FONT_ATLAS_ALPHA );
+
+		HIMAGE hImage = EngFuncs::PIC_Load( "#fontprobe8.bmp", bmp.GetBitmap(), bmp.GetBitmapHdr()->fileSize, 0 );
+		supported = hImage != 0;
+
+		if( hImage )
+			EngFuncs::PIC_Free( "#fontprobe8.bmp" );
+		else
+			Con_Printf( "Engine can't load 8-bit images, font atlases will be RGBA\n" );
+	}
+
+	return supported != 0;
+}
+
+int CBaseFont::GetAtlasFormat( void ) const
+{
+	// probe can't tell whether engine keeps palette alpha, so it's opt-in only
+	if( !EngFuncs::GetCvarFloat( "ui_font_8bit" ))
+		return FONT_ATLAS_RGBA;
+
+	if( !Atlas8BitSupported() )
+		return FONT_ATLAS_RGBA;
+
+	// all other effects keep RGB white, dark pixels need 16 level
+	// grey and alpha, which bands antialiasing, so only if asked for
+	if( m_iOutlineSize || m_iScanlineOffset || ( m_iFlags & FONT_STRIKEOUT ))
+		return EngFuncs::GetCvarFloat( "ui_font_8bit" ) >= 2.0f ? FONT_ATLAS_LUMINANCE_ALPHA : FONT_ATLAS_RGBA;
+
+	return FONT_ATLAS_ALPHA;
+}
+
+void CBaseFont::SetAtlasPalette( CBMP *bmp, int format )
+{
+	rgbquad_t *palette = bmp->GetPaletteData();
+	int i;
+
+	if( format == FONT_ATLAS_RGBA )
+		return;
+
+	// reserved byte is alpha, like in RGBA pages
+	for( i = 0; i < 256; i++ )
+	{
+		if( format == FONT_ATLAS_ALPHA )
+		{
+			palette[i].r = palette[i].g = palette[i].b = 255;
+			palette[i].reserved = i;
+		}
+		else
+		{
+			palette[i].r = palette[i].g = palette[i].b = ( i >> 4 ) * 17;
+			palette[i].reserved = ( i & 15 ) * 17;
+		}
+	}
+}
+
+void CBaseFont::StoreAtlasRow( byte *dst, const byte *rgba, int w, int format )
+{
+	int i;
+
+	switch( format )
+	{
+	case FONT_ATLAS_ALPHA:
+		for( i = 0; i < w; i++ )
+			dst[i] = rgba[i * 4 + 3];
+		break;
+	case FONT_ATLAS_LUMINANCE_ALPHA:
+		// glyph pixels are grey, any channel is luminance
+		for( i = 0; i < w; i++ )
+			dst[i] = (( rgba[i * 4] + 8 ) / 17 ) << 4 | (( rgba[i * 4 + 3] + 8 ) / 17 );
+		break;
+	default:
+		memcpy( dst, rgba, w * 4 );
+		break;
+	}
+}
+
+/*
+=========================
+CBaseFont::PlaceGlyphs
+
+Copy rendered glyphs to packed places in atlas, rects are in GetPendingRects order.
+Returns atlas bytes used by this font
+=========================
+*/
+int CBaseFont::PlaceGlyphs( const CSkylinePacker::rect_t *rects, CBMP *bmp, int format )
 {
 	const int maxWidth = GetMaxCharWidth();
 	const int height = GetHeight();
-	const int tempSize = maxWidth * height * 4; // allocate temporary buffer for max possible glyph size
-	const Point nullPt( 0, 0 );
+	const int slotBytes = maxWidth * height * 4;
+	const int pixelSize = AtlasPixelSize( format );
+	byte *rgbdata = bmp->GetTextureData();
+	bmp_t *hdr = bmp->GetBitmapHdr();
+	int usedBytes = 0;
+
+	for( int i = 0; i < m_PendingChars.Count(); i++ )
+	{
+		const CSkylinePacker::rect_t &r = rects[i];
+
+		// texture is reversed by Y coordinates
+		for( int y = 0; y < height; y++ )
+		{
+			byte *dst = &rgbdata[((hdr->height - 1 - ( r.y + y )) * hdr->width + r.x) * pixelSize];
+			StoreAtlasRow( dst, &m_PendingStaging[i * slotBytes + y * maxWidth * 4], r.w, format );
+		}
+
+		glyph_t glyph;
+		glyph.ch = r.id;
+		glyph.rect.left   = r.x;
+		glyph.rect.right  = r.x + r.w;
+		glyph.rect.top    = r.y;
+		glyph.rect.bottom = r.y + height;
+		glyph.texture = 0; // will be acquired later
+
+		m_glyphs.Insert( glyph );
+
+		usedBytes += r.w * height * pixelSize;
+	}
+
+	m_PendingChars.Purge();
+	m_PendingWidths.Purge();
+	m_PendingStaging.Purge();
+
+	return usedBytes;
+}
+
+void CBaseFont::SetGlyphTexture( HIMAGE hImage )
+{
+	for( int i = m_glyphs.FirstInorder(); m_glyphs.IsValidIndex( i ); i = m_glyphs.NextInorder( i ))
+	{
+		if( m_glyphs[i].page < 0 )
+			m_glyphs[i].texture = hImage;
+	}
+
+	ResetGlyphInfo();
+}
+
+void CBaseFont::UploadGlyphsForRanges(charRange_t *range, int rangeSize)
+{
+	if( LoadCachedGlyphs( range, rangeSize ))
+		return;
+
+	RenderGlyphs( range, rangeSize );
+	UploadRenderedGlyphs( range, rangeSize );
+}
+
+bool CBaseFont::LoadCachedGlyphs( charRange_t *range, int rangeSize )
+{
+	char name[256];
+
+	GetTextureName( name, sizeof( name ));
+
+	if( !ReadFromCache( name, range, rangeSize ))
+		return false;
+
+	ResetGlyphInfo();
+
+	int dotWideA, dotWideB, dotWideC;
+	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
+	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+
+	return true;
+}
+
+/*
+=========================
+CBaseFont::UploadRenderedGlyphs
+
+Pack glyphs from staging buffer to own atlas, must be called on main thread
+=========================
+*/
+void CBaseFont::UploadRenderedGlyphs( charRange_t *range, int rangeSize )
+{
+	char name[256];
+
+	GetTextureName( name, sizeof( name ));
+
+	CUtlVector<CSkylinePacker::rect_t> rects;
+	GetPendingRects( rects );
+
+	int pageWidth, pageHeight;
+	if( !CSkylinePacker::Pack( rects.Base(), rects.Count(), MIN_PAGE_SIZE, MAX_PAGE_SIZE, pageWidth, pageHeight ))
+	{
+		Con_Printf( "Font %s doesn't fit in %ix%i texture\n", name, MAX_PAGE_SIZE, MAX_PAGE_SIZE );
+		return;
+	}
+
+	// allocate atlas only once, when we know how big it is
+	const int format = GetAtlasFormat();
+	CBMP bmp( pageWidth, pageHeight, AtlasPixelSize( format ));
+	bmp_t *hdr = bmp.GetBitmapHdr();
+
+	SetAtlasPalette( &bmp, format );
+	m_iWastedBytes = bmp.GetTextureDataSize() - PlaceGlyphs( rects.Base(), &bmp, format );
+
+	HIMAGE hImage = EngFuncs::PIC_Load( name, bmp.GetBitmap(), bmp.GetBitmapHdr()->fileSize, 0 );
+	m_bAtlasLoaded = hImage != 0;
+	SaveToCache( name, range, rangeSize, &bmp );
+	Con_DPrintf( "Uploaded %s to %i and saved to cache, %ix%i, %i bytes wasted\n", name, hImage, hdr->width, hdr->height, m_iWastedBytes );
+
+	SetGlyphTexture( hImage );
+
+	int dotWideA, dotWideB, dotWideC;
+	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
+	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+}
+
+/*
+=========================
+CBaseFont::RenderGlyphsForRanges
+
+Glyphs are kept in staging buffer, CFontManager will place them to shared atlas
+=========================
+*/
+void CBaseFont::RenderGlyphsForRanges( charRange_t *range, int rangeSize )
+{
+	RenderGlyphs( range, rangeSize );
+
+	int dotWideA, dotWideB, dotWideC;
+	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
+	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+}
+
+/*
+=========================
+CBaseFont::UploadGlyphsOnDemand
+
+Nothing is uploaded here, DrawCharacter will put glyphs to dynamic pages
+=========================
+*/
+void CBaseFont::UploadGlyphsOnDemand( charRange_t *range, int rangeSize )
+{
+	BuildKerningTable( range, rangeSize );
+
+	int dotWideA, dotWideB, dotWideC;
+	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
+	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+}
+
+void CBaseFont::GetDynamicPageName( int page, char *dst, size_t len ) const
+{
 	char name[256];
 
+	// keep extension, engine detects image format by it
 	GetTextureName( name, sizeof( name ));
+	snprintf( dst, len - 1, "dyn%i_%s", page, name );
+	dst[len - 1] = 0;
+}
+
+/*
+=========================
+CBaseFont::AllocDynamicRow
+
+All glyphs have same height, so pages are split into rows and glyphs
+are appended to them. Row is the eviction unit, it's cheap and doesn't fragment the page
+=========================
+*/
+bool CBaseFont::AllocDynamicRow( int w, int &page, int &row )
+{
+	const int rowsPerPage = DYNAMIC_PAGE_SIZE / ( GetHeight() + 1 );
+	int i, j;
+
+	if( rowsPerPage < 1 || w > DYNAMIC_PAGE_SIZE )
+		return false;
+
+	// first fit in existing pages, then create new one
+	for( i = 0; i < DYNAMIC_ATLAS_PAGES; i++ )
+	{
+		dynpage_t &p = m_DynPages[i];
+
+		if( !p.bmp )
+		{
+			p.format = GetAtlasFormat();
+			p.bmp = new CBMP( DYNAMIC_PAGE_SIZE, DYNAMIC_PAGE_SIZE, AtlasPixelSize( p.format ));
+			SetAtlasPalette( p.bmp, p.format );
+			p.rows.SetCount( rowsPerPage );
+
+			for( j = 0; j < rowsPerPage; j++ )
+				p.rows[j].x = p.rows[j].lastUsed = 0;
+		}
+
+		for( j = 0; j < p.rows.Count(); j++ )
+		{
+			if( p.rows[j].x + w <= DYNAMIC_PAGE_SIZE )
+			{
+				page = i;
+				row = j;
+				return true;
+			}
+		}
+	}
+
+	// all pages are full, drop least recently used row
+	page = row = 0;
+	for( i = 0; i < DYNAMIC_ATLAS_PAGES; i++ )
+	{
+		for( j = 0; j < m_DynPages[i].rows.Count(); j++ )
+		{
+			if( m_DynPages[i].rows[j].lastUsed < m_DynPages[page].rows[row].lastUsed )
+			{
+				page = i;
+				row = j;
+			}
+		}
+	}
+
+	EvictDynamicRow( page, row );
+	return true;
+}
+
+void CBaseFont::EvictDynamicRow( int page, int row )
+{
+	dynpage_t &p = m_DynPages[page];
+	bmp_t *hdr = p.bmp->GetBitmapHdr();
+	const int rowHeight = GetHeight() + 1;
+	const int pixelSize = AtlasPixelSize( p.format );
+	CUtlVector<int> evicted;
+	int i;
+
+	// queued text may still use glyphs from this row
+	TextBatch_Flush();
+
+	for( i = m_glyphs.FirstInorder(); m_glyphs.IsValidIndex( i ); i = m_glyphs.NextInorder( i ))
+	{
+		if( m_glyphs[i].page == page && m_glyphs[i].row == row )
+			evicted.AddToTail( i );
+	}
 
-	if( ReadFromCache( name, range, rangeSize ))
+	for( i = 0; i < evicted.Count(); i++ )
 	{
-		int dotWideA, dotWideB, dotWideC;
-		GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
-		m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
+		charinfo_t *info = FindCharInfo( m_glyphs[evicted[i]].ch );
+
+		if( info )
+			info->flags &= ~CHARINFO_GLYPH;
+
+		m_glyphs.RemoveAt( evicted[i] );
+	}
+
+	// texture is reversed by Y coordinates
+	for( int y = row * rowHeight; y < ( row + 1 ) * rowHeight && y < (int)hdr->height; y++ )
+		memset( &p.bmp->GetTextureData()[( hdr->height - 1 - y ) * hdr->width * pixelSize], 0, hdr->width * pixelSize );
+
+	p.rows[row].x = 0;
+	p.rows[row].lastUsed = 0;
+}
+
+/*
+=========================
+CBaseFont::UploadDynamicPage
+
+Engine can't update part of the texture, so whole page is reloaded.
+It only happens when new glyphs were added since last upload
+=========================
+*/
+void CBaseFont::UploadDynamicPage( int page )
+{
+	dynpage_t &p = m_DynPages[page];
+	char name[256];
+
+	GetDynamicPageName( page, name, sizeof( name ));
+
+	if( p.texture )
+		EngFuncs::PIC_Free( name );
+
+	p.texture = EngFuncs::PIC_Load( name, p.bmp->GetBitmap(), p.bmp->GetBitmapHdr()->fileSize, 0 );
+	p.dirty = false;
+}
+
+/*
+=========================
+CBaseFont::UploadDirtyPages
+
+Called by TextBatch before quads are submitted, so page
+is reloaded once for all glyphs rasterized meanwhile
+=========================
+*/
+void CBaseFont::UploadDirtyPages( void *ctx )
+{
+	CBaseFont *font = (CBaseFont *)ctx;
+
+	for( int i = 0; i < DYNAMIC_ATLAS_PAGES; i++ )
+	{
+		if( font->m_DynPages[i].dirty )
+			font->UploadDynamicPage( i );
+	}
+}
+
+int CBaseFont::LoadDynamicGlyph( int ch )
+{
+	const int maxWidth = GetMaxCharWidth();
+	const int height = GetHeight();
+	const int rowHeight = height + 1; // HACKHACK: same spacing as in static atlas
+	Size drawSize;
+	int page, row;
+
+	if( maxWidth <= 0 || height <= 0 )
+		return m_glyphs.InvalidIndex();
+
+	m_DynStaging.SetCount( maxWidth * height * 4 );
+	memset( m_DynStaging.Base(), 0, m_DynStaging.Count() );
+
+	if( m_pSDF )
+		m_pSDF->Prepare( &ch, 1 );
+
+	RasterizeGlyph( ch, Size( maxWidth, height ), m_DynStaging.Base(), drawSize, 0 );
+
+	const int w = bound( 0, drawSize.w, maxWidth );
+
+	if( !AllocDynamicRow( w, page, row ))
+		return m_glyphs.InvalidIndex();
+
+	dynpage_t &p = m_DynPages[page];
+	dynrow_t &r = p.rows[row];
+	bmp_t *hdr = p.bmp->GetBitmapHdr();
+	byte *rgbdata = p.bmp->GetTextureData();
+
+	const int pixelSize = AtlasPixelSize( p.format );
+
+	for( int y = 0; y < height; y++ )
+	{
+		byte *dst = &rgbdata[((hdr->height - 1 - ( row * rowHeight + y )) * hdr->width + r.x) * pixelSize];
+		StoreAtlasRow( dst, &m_DynStaging[y * maxWidth * 4], w, p.format );
+	}
+
+	glyph_t glyph( ch );
+	glyph.rect.left   = r.x;
+	glyph.rect.right  = r.x + w;
+	glyph.rect.top    = row * rowHeight;
+	glyph.rect.bottom = row * rowHeight + height;
+	glyph.page = page;
+	glyph.row = row;
+
+	r.x += w;
+	r.lastUsed = ++m_iDynClock;
+
+	p.dirty = true;
+	TextBatch_RequestUpload( UploadDirtyPages, this );
+
+	return m_glyphs.Insert( glyph );
+}
+
+CBaseFont::~CBaseFont()
+{
+	char name[256];
+
+	// queued quads and upload requests may point to this font
+	TextBatch_Flush();
+
+	// placeholder fonts have the same texture name as font replacing them
+	if( m_bAtlasLoaded )
+	{
+		GetTextureName( name, sizeof( name ) );
+		EngFuncs::PIC_Free( name );
+	}
+
+	for( int i = 0; i < m_iFallbacks; i++ )
+		delete m_pFallbacks[i];
+
+	for( int i = 0; i < DYNAMIC_ATLAS_PAGES; i++ )
+	{
+		if( m_DynPages[i].texture )
+		{
+			GetDynamicPageName( i, name, sizeof( name ));
+			EngFuncs::PIC_Free( name );
+		}
+
+		delete m_DynPages[i].bmp;
+	}
+}
+
+void CBaseFont::GetCharABCWidths( int ch, int &a, int &b, int &c )
+{
+	charinfo_t *info = GetCharInfo( ch );
+
+	if( info->flags & CHARINFO_ABC )
+	{
+		a = info->a;
+		b = info->b;
+		c = info->c;
+		return;
+	}
+
+	// not found in cache
+	CBaseFont *source = GetGlyphSource( ch );
+
+	if( source != this )
+	{
+		// fallback has same effects, widths are already adjusted
+		source->GetCharABCWidths( ch, a, b, c );
+	}
+	else
+	{
+		GetCharABCWidthsNoCache( ch, a, b, c );
+
+		a -= m_iBlur + m_iOutlineSize;
+		b += m_iBlur + m_iOutlineSize;
+
+		if( m_iOutlineSize )
+		{
+			if( a < 0 )
+				a += m_iOutlineSize;
+
+			if( c < 0 )
+				c += m_iOutlineSize;
+		}
+	}
+
+	info->a = a;
+	info->b = b;
+	info->c = c;
+	info->flags |= CHARINFO_ABC;
+}
+
+/*
+=========================
+CBaseFont::FindCharInfo
+
+Returns NULL if character was never looked up
+=========================
+*/
+CBaseFont::charinfo_t *CBaseFont::FindCharInfo( int ch )
+{
+	if( ch >= 0 && ch < CHARINFO_TABLE_SIZE )
+		return &m_CharTable[ch];
+
+	if( !m_CharHash.Count() )
+		return NULL;
+
+	const unsigned int mask = m_CharHash.Count() - 1;
+
+	// linear probing, entries are never removed, so first empty slot ends the search
+	for( unsigned int i = ( (unsigned int)ch * 2654435761U ) & mask;; i = ( i + 1 ) & mask )
+	{
+		if( m_CharHash[i].ch == ch )
+			return &m_CharHash[i];
+
+		if( !m_CharHash[i].ch )
+			return NULL;
+	}
+}
+
+/*
+=========================
+CBaseFont::GetCharInfo
+
+Same as FindCharInfo, but adds empty entry for new character.
+Pointers to hashed entries are valid only until next call
+=========================
+*/
+CBaseFont::charinfo_t *CBaseFont::GetCharInfo( int ch )
+{
+	charinfo_t *info = FindCharInfo( ch );
+
+	if( info )
+		return info;
+
+	// keep load factor below 3/4
+	if(( m_iCharHashCount + 1 ) * 4 > m_CharHash.Count() * 3 )
+		GrowCharHash();
+
+	const unsigned int mask = m_CharHash.Count() - 1;
+	unsigned int i = ( (unsigned int)ch * 2654435761U ) & mask;
+
+	while( m_CharHash[i].ch )
+		i = ( i + 1 ) & mask;
+
+	m_iCharHashCount++;
+	m_CharHash[i].ch = ch;
+	return &m_CharHash[i];
+}
+
+void CBaseFont::GrowCharHash( void )
+{
+	CUtlVector<charinfo_t> old;
+	int i;
+
+	old.AddMultipleToTail( m_CharHash.Count(), m_CharHash.Base() );
+
+	m_CharHash.SetCount( m_CharHash.Count() ? m_CharHash.Count() * 2 : 64 );
+	memset( m_CharHash.Base(), 0, m_CharHash.Count() * sizeof( charinfo_t ));
+
+	const unsigned int mask = m_CharHash.Count() - 1;
+
+	for( i = 0; i < old.Count(); i++ )
+	{
+		if( !old[i].ch )
+			continue;
+
+		unsigned int j = ( (unsigned int)old[i].ch * 2654435761U ) & mask;
+
+		while( m_CharHash[j].ch )
+			j = ( j + 1 ) & mask;
+
+		m_CharHash[j] = old[i];
+	}
+}
+
+/*
+=========================
+CBaseFont::AddFallback
+
+Face must be created by same backend, it gets same size and effects,
+baseline is moved to this font's one, so glyphs line up
+=========================
+*/
+bool CBaseFont::AddFallback( CBaseFont *face, const char *name )
+{
+	const char *path;
+
+	if( m_iFallbacks >= MAX_FONT_FALLBACKS )
+		return false;
+
+	if( !face->Create( name, m_iTall, m_iWeight, m_iBlur, m_fBrighten, m_iOutlineSize, m_iScanlineOffset, m_fScanlineScale, m_iFlags ))
+		return false;
+
+	// font lookup gives default font for unknown names, don't ask same file twice
+	path = face->GetFontFilePath();
+
+	if( path && GetFontFilePath() && !strcmp( path, GetFontFilePath() ))
+		return false;
+
+	for( int i = 0; path && i < m_iFallbacks; i++ )
+	{
+		if( m_pFallbacks[i]->GetFontFilePath() && !strcmp( path, m_pFallbacks[i]->GetFontFilePath() ))
+			return false;
+	}
+
+	face->m_iAscent = m_iAscent;
+	face->BuildBlurKernel();
+
+	m_pFallbacks[m_iFallbacks++] = face;
+
+	GlyphWorkers_DPrintf( "%s: fallback %s from %s\n", m_szName, name, path ? path : face->GetName() );
+	return true;
+}
+
+/*
+=========================
+CBaseFont::GetGlyphSource
+
+Resolved once per character, first face that has the glyph wins.
+If none has it, this font draws its own missing glyph
+=========================
+*/
+CBaseFont *CBaseFont::GetGlyphSource( int ch )
+{
+	if( !m_iFallbacks )
+		return this;
+
+	charinfo_t *info = GetCharInfo( ch );
+
+	if( !( info->flags & CHARINFO_SOURCE ))
+	{
+		info->source = 0;
+
+		if( !HasChar( ch ))
+		{
+			for( int i = 0; i < m_iFallbacks; i++ )
+			{
+				if( m_pFallbacks[i]->HasChar( ch ))
+				{
+					info->source = i + 1;
+					break;
+				}
+			}
+		}
+
+		info->flags |= CHARINFO_SOURCE;
+	}
+
+	return info->source ? m_pFallbacks[info->source - 1] : this;
+}
+
+/*
+=========================
+CBaseFont::PrepareFaceWorkers
+
+Every face used by glyph jobs needs its workers, use least of them
+=========================
+*/
+int CBaseFont::PrepareFaceWorkers( int threads )
+{
+	threads = PrepareWorkers( threads );
+
+	for( int i = 0; i < m_iFallbacks; i++ )
+		threads = Q_min( threads, m_pFallbacks[i]->PrepareWorkers( threads ));
+
+	return threads;
+}
+
+void CBaseFont::ReleaseFaceWorkers( void )
+{
+	ReleaseWorkers();
+
+	for( int i = 0; i < m_iFallbacks; i++ )
+		m_pFallbacks[i]->ReleaseWorkers();
+}
+
+struct kernglyph_t
+{
+	int glyph;
+	int ch;
+};
+
+static int KerningGlyphCompare( const void *a, const void *b )
+{
+	const kernglyph_t *ga = (const kernglyph_t *)a;
+	const kernglyph_t *gb = (const kernglyph_t *)b;
+
+	if( ga->glyph != gb->glyph )
+		return ga->glyph - gb->glyph;
+	return ga->ch - gb->ch;
+}
+
+// first character drawn with glyph, characters of same glyph follow it
+static int KerningFindGlyph( const CUtlVector<kernglyph_t> &glyphs, int glyph )
+{
+	int l = 0, r = glyphs.Count();
+
+	while( l < r )
+	{
+		int m = ( l + r ) / 2;
+
+		if( glyphs[m].glyph < glyph )
+			l = m + 1;
+		else
+			r = m;
+	}
+
+	return l < glyphs.Count() && glyphs[l].glyph == glyph ? l : -1;
+}
+
+/*
+=========================
+CBaseFont::BuildKerningTable
+
+Pairs of font file are parsed once for all sizes, here only pairs where both
+glyphs are used by characters from ranges are scaled, only non-zero ones are kept.
+Done once per atlas, so drawing and measuring text never calls backend for kerning
+=========================
+*/
+void CBaseFont::BuildKerningTable( charRange_t *range, int rangeSize )
+{
+	CUtlVector<kernglyph_t> glyphs;
+	CUtlVector<int> pairs; // left, right, kern
+	const fontkernpair_t *filePairs;
+	int fileCount, i, j;
+
+	SetKerningPairs( NULL, 0 );
+
+	if( !HasKerning() || !GetFontFilePath() )
+		return;
+
+	filePairs = g_FontMgr->GetFontFileKerning( GetFontFilePath(), fileCount );
+
+	if( !fileCount )
+		return;
+
+	for( i = 0; i < rangeSize; i++ )
+	{
+		for( size_t k = 0; k < range[i].Length(); k++ )
+		{
+			kernglyph_t g;
+
+			g.ch = range[i].Character( k );
+
+			if( g.ch <= ' ' || g.ch > 0xFFFF )
+				continue;
+
+			g.glyph = GetGlyphIndex( g.ch );
+
+			if( g.glyph )
+				glyphs.AddToTail( g );
+		}
+	}
+
+	// ranges may overlap, like cp1251 and cyrillic
+	qsort( glyphs.Base(), glyphs.Count(), sizeof( kernglyph_t ), KerningGlyphCompare );
+
+	for( i = 0, j = 0; i < glyphs.Count(); i++ )
+	{
+		if( !j || glyphs[j - 1].ch != glyphs[i].ch || glyphs[j - 1].glyph != glyphs[i].glyph )
+			glyphs[j++] = glyphs[i];
+	}
+	glyphs.SetCount( j );
+
+	for( i = 0; i < fileCount; i++ )
+	{
+		const fontkernpair_t &p = filePairs[i];
+		int left = KerningFindGlyph( glyphs, p.left );
+
+		if( left < 0 )
+			continue;
+
+		int right = KerningFindGlyph( glyphs, p.right );
+
+		if( right < 0 )
+			continue;
+
+		int kern = ScaleKerning( p.value );
+
+		if( !kern )
+			continue;
+
+		// few characters may be drawn with same glyph
+		for( int l = left; l < glyphs.Count() && glyphs[l].glyph == p.left; l++ )
+		{
+			for( int r = right; r < glyphs.Count() && glyphs[r].glyph == p.right; r++ )
+			{
+				pairs.AddToTail( glyphs[l].ch );
+				pairs.AddToTail( glyphs[r].ch );
+				pairs.AddToTail( kern );
+			}
+		}
+	}
+
+	SetKerningPairs( pairs.Base(), pairs.Count() / 3 );
+	GlyphWorkers_DPrintf( "%s: %i kerning pairs from %i in file\n", m_szName, m_iKernCount, fileCount );
+}
+
+/*
+=========================
+CBaseFont::SetKerningPairs
+
+Replace pair table, pairs are left, right, kern triples
+=========================
+*/
+void CBaseFont::SetKerningPairs( const int *pairs, int count )
+{
+	int size = 64;
+
+	m_KernHash.Purge();
+	m_iKernCount = 0;
+	memset( m_KernLeft, 0, sizeof( m_KernLeft ));
+
+	if( !count )
+		return;
+
+	// table never grows, keep load factor at most 1/2
+	while( size < count * 2 )
+		size *= 2;
+
+	m_KernHash.SetCount( size );
+	memset( m_KernHash.Base(), 0, size * sizeof( kernpair_t ));
+
+	const unsigned int mask = size - 1;
+
+	for( int i = 0; i < count; i++, pairs += 3 )
+	{
+		unsigned int key = ( (unsigned int)pairs[0] << 16 ) | pairs[1];
+		unsigned int j = ( key * 2654435761U ) & mask;
+
+		while( m_KernHash[j].key )
+			j = ( j + 1 ) & mask;
+
+		m_KernHash[j].key = key;
+		m_KernHash[j].kern = pairs[2];
 
-		return;
+		if( pairs[0] < CHARINFO_TABLE_SIZE )
+			m_KernLeft[pairs[0] >> 3] |= BIT( pairs[0] & 7 );
 	}
 
-	CBMP bmp( MAX_PAGE_SIZE, MAX_PAGE_SIZE );
-	byte *rgbdata = bmp.GetTextureData();
-	bmp_t *hdr = bmp.GetBitmapHdr();
+	m_iKernCount = count;
+}
 
-	Size tempDrawSize( maxWidth, height );
-	byte *temp = new byte[tempSize];
+int CBaseFont::FindKerning( int left, int right ) const
+{
+	if( (unsigned int)left > 0xFFFF || (unsigned int)right > 0xFFFF )
+		return 0;
 
-	// abscissa atlas optimization
-	CUtlVector<uint> lines;
-	int line = 0;
+	const unsigned int key = ( (unsigned int)left << 16 ) | right;
+	const unsigned int mask = m_KernHash.Count() - 1;
 
-	// texture is reversed by Y coordinates
-	int xstart = 0, ystart = hdr->height-1;
-	for( int iRange = 0; iRange < rangeSize; iRange++ )
+	for( unsigned int i = ( key * 2654435761U ) & mask;; i = ( i + 1 ) & mask )
 	{
-		size_t size = range[iRange].Length();
+		if( m_KernHash[i].key == key )
+			return m_KernHash[i].kern;
 
-		for( size_t i = 0; i < size; i++ )
-		{
-			int ch = range[iRange].Character( i );
+		if( !m_KernHash[i].key )
+			return 0;
+	}
+}
 
-			// clear temporary buffer
-			memset( temp, 0, tempSize );
+/*
+=========================
+CBaseFont::GetGlyphInfo
 
-			// draw it to temp buffer
-			Size drawSize;
-			GetCharRGBA( ch, nullPt, tempDrawSize, temp, drawSize );
+Glyph location is copied from m_glyphs on first use.
+Glyphs missing in atlas are rasterized here
+=========================
+*/
+const CBaseFont::charinfo_t *CBaseFont::GetGlyphInfo( int ch )
+{
+	charinfo_t *info = GetCharInfo( ch );
 
-			// see if we need to go down or create a new page
-			if( xstart + drawSize.w > (int)hdr->width )
-			{
-				// update or push
-				if( lines.IsValidIndex( line ) )
-				{
-					lines[line] = xstart;
-					line++;
-					// do we have next or don't have it yet?
-					if( lines.IsValidIndex( line ) )
-						xstart = lines[line];
-					else
-						xstart = 0;
-				}
-				else
-				{
-					lines.AddToTail(xstart);
-					line++;
-					// obviously we don't have next
-					xstart = 0;
+	if( info->flags & ( CHARINFO_GLYPH|CHARINFO_NO_GLYPH ))
+		return info;
 
-				}
-				ystart -= height + 1; // HACKHACK: Add more space between rows, this removes ugly 1 height pixel rubbish
+	glyph_t find( ch );
+	int idx = m_glyphs.Find( find );
 
-				// No free space now
-				if( ystart - height - 1 <= 0 )
-				{
-					if( hdr->height <= (int)hdr->width ) // prioritize height grow
-					{
-						int oldheight = hdr->height - ystart;
-						bmp.Increase( hdr->width, hdr->height * 2 );
-						hdr = bmp.GetBitmapHdr();
-						ystart = hdr->height - oldheight - 1;
-					}
-					else
-					{
-						bmp.Increase( hdr->width * 2, hdr->height );
-						hdr = bmp.GetBitmapHdr();
-						line = 0;
-						xstart = lines[line];
-						ystart = hdr->height - 1;
-					}
-
-					// update pointers
-					rgbdata = bmp.GetTextureData();
-				}
-			}
+	// not in atlas, rasterize it now
+	if( !m_glyphs.IsValidIndex( idx ) && ch > ' ' && GetGlyphSource( ch )->HasChar( ch ))
+		idx = LoadDynamicGlyph( ch );
 
-			// set rgbdata rect
-			wrect_t rect;
-			rect.top    = hdr->height - ystart;
-			rect.bottom = hdr->height - ystart + height;
-			rect.left   = xstart;
-			rect.right  = xstart + drawSize.w;
+	// hash could be resized by rasterizer
+	info = GetCharInfo( ch );
 
-			// copy glyph to rgbdata
+	if( !m_glyphs.IsValidIndex( idx ))
+	{
+		info->flags |= CHARINFO_NO_GLYPH;
+		return info;
+	}
 
-			for( int y = 0; y < height - 1; y++ )
-			{
-				byte *dst = &rgbdata[(ystart - y) * hdr->width * 4];
-				byte *src = &temp[y * maxWidth * 4];
-				for( int x = 0; x < drawSize.w; x++ )
-				{
-					byte *xdst = &dst[ ( xstart + x ) * 4 ];
-					byte *xsrc = &src[ x * 4 ];
+	const glyph_t &glyph = m_glyphs[idx];
 
-					// copy 4 bytes: R, G, B and A
-					memcpy( xdst, xsrc, 4 );
-				}
-			}
+	info->texture = glyph.texture;
+	info->rect = glyph.rect;
+	info->page = glyph.page;
+	info->row = glyph.row;
+	info->flags |= CHARINFO_GLYPH;
 
-			// move xstart
-			xstart += drawSize.w;
+	return info;
+}
 
-			glyph_t glyph;
-			glyph.ch = ch;
-			glyph.rect = rect;
-			glyph.texture = 0; // will be acquired later
+// call when m_glyphs was changed, ABC widths are kept
+void CBaseFont::ResetGlyphInfo( void )
+{
+	int i;
 
-			m_glyphs.Insert( glyph );
-		}
-	}
+	for( i = 0; i < CHARINFO_TABLE_SIZE; i++ )
+		m_CharTable[i].flags &= ~( CHARINFO_GLYPH|CHARINFO_NO_GLYPH );
 
-	HIMAGE hImage = EngFuncs::PIC_Load( name, bmp.GetBitmap(), bmp.GetBitmapHdr()->fileSize, 0 );
-	SaveToCache( name, range, rangeSize, &bmp );
-	Con_DPrintf( "Uploaded %s to %i and saved to cache\n", name, hImage );
+	for( i = 0; i < m_CharHash.Count(); i++ )
+		m_CharHash[i].flags &= ~( CHARINFO_GLYPH|CHARINFO_NO_GLYPH );
+}
 
-	delete[] temp;
+struct benchabc_t
+{
+	int ch;
+	int a, b, c;
 
-	for( int i = m_glyphs.FirstInorder();; i = m_glyphs.NextInorder( i ) )
+	bool operator< ( const benchabc_t &a ) const
 	{
-		m_glyphs[i].texture = hImage;
-		if( i == m_glyphs.LastInorder() )
-			break;
+		return ch < a.ch;
 	}
+};
 
-	int dotWideA, dotWideB, dotWideC;
-	GetCharABCWidths( '.', dotWideA, dotWideB, dotWideC );
-	m_iEllipsisWide = ( dotWideA + dotWideB + dotWideC ) * 3;
-}
-
+/*
+=========================
+CBaseFont::BenchmarkLookups
 
-CBaseFont::~CBaseFont()
+Does the same lookups as DrawCharacter, ABC widths and then glyph location,
+for every uploaded glyph in shuffled order, through RB-trees and through char info tables
+=========================
+*/
+void CBaseFont::BenchmarkLookups( int iterations )
 {
-	char name[256];
-	GetTextureName( name, sizeof( name ) );
-	EngFuncs::PIC_Free( name );
-}
+	CUtlRBTree<benchabc_t, int> abcTree( 0, 0 );
+	CUtlVector<int> chars;
+	unsigned int sum = 0, seed = 1;
+	double start, treeTime, tableTime;
+	int i, j;
 
-void CBaseFont::GetCharABCWidths( int ch, int &a, int &b, int &c )
-{
-	abc_t find;
-	find.ch = ch;
+	SetDefLessFunc( abcTree );
+
+	for( i = m_glyphs.FirstInorder(); m_glyphs.IsValidIndex( i ); i = m_glyphs.NextInorder( i ))
+	{
+		benchabc_t abc;
+		abc.ch = m_glyphs[i].ch;
+		GetCharABCWidths( abc.ch, abc.a, abc.b, abc.c );
 
-	unsigned short i = m_ABCCache.Find( find );
-	if( i != 65535 && m_ABCCache.IsValidIndex(i) )
+		abcTree.Insert( abc );
+		chars.AddToTail( abc.ch );
+	}
+
+	if( !chars.Count() )
 	{
-		a = m_ABCCache[i].a;
-		b = m_ABCCache[i].b;
-		c = m_ABCCache[i].c;
+		Con_Printf( "%s: no glyphs to benchmark\n", GetName() );
 		return;
 	}
 
-	// not found in cache
-	GetCharABCWidthsNoCache( ch, find.a, find.b, find.c );
+	// text is never sorted, don't let tree benefit from that
+	for( i = chars.Count() - 1; i > 0; i-- )
+	{
+		seed = seed * 1103515245 + 12345;
+		j = ( seed >> 8 ) % ( i + 1 );
 
-	find.a -= m_iBlur + m_iOutlineSize;
-	find.b += m_iBlur + m_iOutlineSize;
+		int temp = chars[i];
+		chars[i] = chars[j];
+		chars[j] = temp;
+	}
 
-	if( m_iOutlineSize )
+	// warm up tables
+	for( i = 0; i < chars.Count(); i++ )
+		GetGlyphInfo( chars[i] );
+
+	start = EngFuncs::DoubleTime();
+	for( j = 0; j < iterations; j++ )
 	{
-		if( find.a < 0 )
-			find.a += m_iOutlineSize;
+		for( i = 0; i < chars.Count(); i++ )
+		{
+			benchabc_t find;
+			find.ch = chars[i];
 
-		if( find.c < 0 )
-			find.c += m_iOutlineSize;
+			int abcIdx = abcTree.Find( find );
+			int glyphIdx = m_glyphs.Find( glyph_t( chars[i] ));
+
+			sum += abcTree[abcIdx].b + m_glyphs[glyphIdx].rect.left;
+		}
 	}
+	treeTime = EngFuncs::DoubleTime() - start;
+
+	start = EngFuncs::DoubleTime();
+	for( j = 0; j < iterations; j++ )
+	{
+		for( i = 0; i < chars.Count(); i++ )
+		{
+			int a, b, c;
+			GetCharABCWidths( chars[i], a, b, c );
 
-	a = find.a;
-	b = find.b;
-	c = find.c;
+			sum += b + GetGlyphInfo( chars[i] )->rect.left;
+		}
+	}
+	tableTime = EngFuncs::DoubleTime() - start;
 
-	m_ABCCache.Insert( find );
+	Con_Printf( "%s: %i lookups, rbtree %.3f ms, table %.3f ms (checksum %u)\n",
+		GetName(), chars.Count() * iterations, treeTime * 1000.0, tableTime * 1000.0, sum );
 }
 
 bool CBaseFont::IsEqualTo(const char *name, int tall, int weight, int blur, int flags)  const
@@ -339,108 +1356,186 @@ void CBaseFont::DebugDraw()
 
 }
 
-void CBaseFont::ApplyBlur(Size rgbaSz, byte *rgba)
+void CBaseFont::BuildBlurKernel( void )
 {
-	if( !m_iBlur )
-		return;
+	const int kernelSize = m_iBlur * 2 + 1;
 
-	const int size = rgbaSz.w * rgbaSz.h * 4;
-	byte *src = new byte[size];
-	double sigma2;
-	memcpy( src, rgba, size );
+	if( m_BlurKernel.Count() == kernelSize )
+		return;
 
-	sigma2 = 0.5 * m_iBlur;
+	double sigma2 = 0.5 * m_iBlur;
 	sigma2 *= sigma2;
-	float * distribution = new float[m_iBlur * 2 + 1];
-	for( int x = 0; x <= m_iBlur * 2; x++ )
+
+	m_BlurKernel.SetCount( kernelSize );
+	for( int x = 0; x < kernelSize; x++ )
 	{
 		int val = x - m_iBlur;
-		distribution[x] = (float)(1.0f / sqrt(2 * 3.14f * sigma2)) * pow(2.7f, -1 * (val * val) / (2 * sigma2));
+		m_BlurKernel[x] = (float)(1.0f / sqrt(2 * 3.14f * sigma2)) * pow(2.7f, -1 * (val * val) / (2 * sigma2));
 
 		// brightening factor
-		distribution[x] *= m_fBrighten;
+		m_BlurKernel[x] *= m_fBrighten;
 	}
+}
 
+/*
+=========================
+CBaseFont::ApplyBlur
 
-	for( int y = 0; y < rgbaSz.h; y++ )
-	{
-		for( int x = 0; x < rgbaSz.w; x++ )
-		{
-			GetBlurValueForPixel( distribution, src, Point(x, y), rgbaSz, rgba );
+Gaussian blur is separable, so do a horizontal pass into float scratch buffer
+and then vertical pass back into alpha channel. O(r) per pixel instead of O(r^2)
+=========================
+*/
+void CBaseFont::ApplyBlur(Size rgbaSz, byte *rgba, int thread)
+{
+	if( !m_iBlur )
+		return;
 
-			rgba += 4;
-		}
-	}
+	// already built by UploadGlyphsForRanges, if we are on worker thread
+	BuildBlurKernel();
 
-	delete[] distribution;
-	delete[] src;
-}
+	scratch_t &scratch = m_Scratch[thread];
 
-void CBaseFont::GetBlurValueForPixel(float *distribution, byte *src, Point srcPt, Size srcSz, byte *dest)
-{
-	float accum = 0.0f;
+	// scratch buffers are kept between glyphs, they only grow
+	if( scratch.blurScratch.Count() < rgbaSz.w * rgbaSz.h )
+		scratch.blurScratch.SetCount( rgbaSz.w * rgbaSz.h );
+	if( scratch.blurRow.Count() < rgbaSz.w )
+		scratch.blurRow.SetCount( rgbaSz.w );
 
-	// scan the positive x direction
-	int maxX = Q_min( srcPt.x + m_iBlur, srcSz.w );
-	int minX = Q_max( srcPt.x - m_iBlur, 0 );
-	for( int x = minX; x < maxX; x++ )
-	{
-		int maxY = Q_min( srcPt.y + m_iBlur, srcSz.h );
-		int minY = Q_max( srcPt.y - m_iBlur, 0);
-		for (int y = minY; y < maxY; y++)
-		{
-			byte *srcPos = src + ((x + (y * srcSz.w)) * 4);
+	// centered, so kernel[-m_iBlur]..kernel[m_iBlur] are valid
+	const float *kernel = m_BlurKernel.Base() + m_iBlur;
+	float *temp = scratch.blurScratch.Base();
+	float *row = scratch.blurRow.Base();
+	int y, i;
 
-			// muliply by the value matrix
-			float weight = distribution[(x - srcPt.x) + m_iBlur];
-			float weight2 = distribution[(y - srcPt.y) + m_iBlur];
-			accum += ( srcPos[3] ) * (weight * weight2);
-		}
+	// horizontal pass, only alpha matters
+	for( y = 0; y < rgbaSz.h; y++ )
+	{
+		g_GlyphKernels.ExtractAlpha( row, &rgba[y * rgbaSz.w * 4], rgbaSz.w );
+		g_GlyphKernels.BlurRow( &temp[y * rgbaSz.w], row, kernel, m_iBlur, rgbaSz.w );
 	}
 
-	// all the values are the same for fonts, just use the calculated alpha
-	dest[0] = dest[1] = dest[2] = 255;
-	dest[3] = Q_min( (int)(accum + 0.5f), 255);
+	// vertical pass, accumulate whole rows to keep memory access linear
+	for( y = 0; y < rgbaSz.h; y++ )
+	{
+		int minY = Q_max( y - m_iBlur, 0 );
+		int maxY = Q_min( y + m_iBlur, rgbaSz.h );
+
+		memset( row, 0, rgbaSz.w * sizeof( *row ));
+
+		for( i = minY; i < maxY; i++ )
+			g_GlyphKernels.AccumRow( row, &temp[i * rgbaSz.w], kernel[i - y], rgbaSz.w );
+
+		// all the values are the same for fonts, just use the calculated alpha
+		g_GlyphKernels.StoreAlpha( &rgba[y * rgbaSz.w * 4], row, rgbaSz.w );
+	}
 }
 
-void CBaseFont::ApplyOutline(Point pt, Size rgbaSz, byte *rgba)
+/*
+=========================
+CBaseFont::ApplyOutline
+
+Transparent pixels near to opaque become black.
+Distance to nearest opaque pixel is found by two-pass chamfer distance transform
+with chessboard metric, so outline is square like before, but the cost
+doesn't depend on outline size anymore
+=========================
+*/
+#define OUTLINE_DIST_MAX 0xFFFE
+
+void CBaseFont::ApplyOutline(Point pt, Size rgbaSz, byte *rgba, int thread)
 {
 	if( !m_iOutlineSize )
 		return;
 
+	const int w = rgbaSz.w, h = rgbaSz.h;
+	scratch_t &scratch = m_Scratch[thread];
 	int x, y;
 
-	for( y = pt.x; y < rgbaSz.h; y++ )
+	if( scratch.outlineMask.Count() < w )
+		scratch.outlineMask.SetCount( w );
+	if( scratch.outlineDist.Count() < w * h )
+		scratch.outlineDist.SetCount( w * h );
+
+	byte *mask = scratch.outlineMask.Base();
+	unsigned short *dist = scratch.outlineDist.Base();
+
+	// forward pass, look at left and upper neighbours
+	for( y = 0; y < h; y++ )
 	{
-		for( x = pt.y; x < rgbaSz.w; x++ )
-		{
-			byte *src = &rgba[(x + (y * rgbaSz.w)) * 4];
+		unsigned short *row = &dist[y * w];
+		const unsigned short *prev = y > 0 ? &dist[(y - 1) * w] : NULL;
 
-			if( src[3] != 0 )
+		// pixels that cast an outline
+		g_GlyphKernels.OutlineMask( mask, &rgba[y * w * 4], w );
+
+		for( x = 0; x < w; x++ )
+		{
+			if( mask[x] )
+			{
+				row[x] = 0;
 				continue;
+			}
 
-			int shadowX, shadowY;
+			int d = OUTLINE_DIST_MAX;
 
-			for( shadowX = -m_iOutlineSize; shadowX <= m_iOutlineSize; shadowX++ )
+			if( x > 0 )
+				d = Q_min( d, row[x - 1] + 1 );
+
+			if( prev )
 			{
-				for( shadowY = -m_iOutlineSize; shadowY <= m_iOutlineSize; shadowY++ )
-				{
-					if( !shadowX && !shadowY )
-						continue;
+				d = Q_min( d, prev[x] + 1 );
+				if( x > 0 )
+					d = Q_min( d, prev[x - 1] + 1 );
+				if( x < w - 1 )
+					d = Q_min( d, prev[x + 1] + 1 );
+			}
 
-					int testX = shadowX + x, testY = shadowY + y;
-					if( testX < 0 || testX >= rgbaSz.w ||
-						testY < 0 || testY >= rgbaSz.h )
-						continue;
+			row[x] = Q_min( d, OUTLINE_DIST_MAX );
+		}
+	}
 
-					byte *test = &rgba[(testX + (testY * rgbaSz.w)) * 4];
-					if( test[0] == 0 || test[1] == 0 || test[3] == 0 )
-						continue;
+	// backward pass, look at right and lower neighbours
+	for( y = h - 1; y >= 0; y-- )
+	{
+		unsigned short *row = &dist[y * w];
+		const unsigned short *next = y < h - 1 ? &dist[(y + 1) * w] : NULL;
 
-					src[0] = src[1] = src[2] = 0;
-					src[3] = -1;
-				}
+		for( x = w - 1; x >= 0; x-- )
+		{
+			int d = row[x];
+
+			if( !d )
+				continue;
+
+			if( x < w - 1 )
+				d = Q_min( d, row[x + 1] + 1 );
+
+			if( next )
+			{
+				d = Q_min( d, next[x] + 1 );
+				if( x < w - 1 )
+					d = Q_min( d, next[x + 1] + 1 );
+				if( x > 0 )
+					d = Q_min( d, next[x - 1] + 1 );
 			}
+
+			row[x] = d;
+		}
+	}
+
+	for( y = pt.y; y < h; y++ )
+	{
+		const unsigned short *row = &dist[y * w];
+
+		for( x = pt.x; x < w; x++ )
+		{
+			byte *src = &rgba[(x + (y * w)) * 4];
+
+			if( src[3] != 0 || row[x] > m_iOutlineSize )
+				continue;
+
+			src[0] = src[1] = src[2] = 0;
+			src[3] = -1;
 		}
 	}
 }
@@ -455,13 +1550,7 @@ void CBaseFont::ApplyScanline(Size rgbaSz, byte *rgba)
 		if( y % m_iScanlineOffset == 0 )
 			continue;
 
-		byte *src = &rgba[(y * rgbaSz.w) * 4];
-		for( int x = 0; x < rgbaSz.w; x++, src += 4 )
-		{
-			src[0] *= m_fScanlineScale;
-			src[1] *= m_fScanlineScale;
-			src[2] *= m_fScanlineScale;
-		}
+		g_GlyphKernels.ScaleRGB( &rgba[(y * rgbaSz.w) * 4], rgbaSz.w, m_fScanlineScale );
 	}
 }
 
@@ -472,13 +1561,7 @@ void CBaseFont::ApplyStrikeout(Size rgbaSz, byte *rgba)
 
 	const int y = rgbaSz.h * 0.5f;
 
-	byte *src = &rgba[(y*rgbaSz.w) * 4];
-
-	for( int x = 0; x < rgbaSz.w; x++, src += 4 )
-	{
-		src[0] = src[1] = src[2] = 127;
-		src[3] = 255;
-	}
+	g_GlyphKernels.FillStrikeout( &rgba[(y*rgbaSz.w) * 4], rgbaSz.w );
 }
 
 int CBaseFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int color, bool forceAdditive)
@@ -508,37 +1591,38 @@ int CBaseFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int col
 		}
 	}
 
-	CBaseFont::glyph_t find( ch );
-	int idx = m_glyphs.Find( find );
+	const charinfo_t *glyph = GetGlyphInfo( ch );
 
-	if( m_glyphs.IsValidIndex( idx ) )
+	if( glyph->flags & CHARINFO_GLYPH )
 	{
-		CBaseFont::glyph_t &glyph = m_glyphs[idx];
-
-		int r, g, b, alpha;
+		const HIMAGE *pageTexture = NULL;
 
-		UnpackRGBA(r, g, b, alpha, color );
+		// page texture is reloaded when new glyphs are added, read it on submit
+		if( glyph->page >= 0 )
+		{
+			m_DynPages[glyph->page].rows[glyph->row].lastUsed = ++m_iDynClock;
+			pageTexture = &m_DynPages[glyph->page].texture;
+		}
 
 #ifdef SCALE_FONTS	// Scale font
 		if( charH > 0 )
 		{
-			charSize.w = (glyph.rect.right - glyph.rect.left) * factor + 0.5f;
+			charSize.w = (glyph->rect.right - glyph->rect.left) * factor + 0.5f;
 			charSize.h = GetHeight() * factor + 0.5f;
 		}
 		else
 #endif
 		{
-			charSize.w = glyph.rect.right - glyph.rect.left;
+			charSize.w = glyph->rect.right - glyph->rect.left;
 			charSize.h = GetHeight();
 		}
 
 		pt.x += a;
 
-		EngFuncs::PIC_Set( glyph.texture, r, g, b, alpha );
-		if( forceAdditive )
-			EngFuncs::PIC_DrawAdditive( pt, charSize, &glyph.rect );
+		if( pageTexture )
+			TextBatch_AddQuadRef( pageTexture, pt, charSize, glyph->rect, color, forceAdditive );
 		else
-			EngFuncs::PIC_DrawTrans( pt, charSize, &glyph.rect );
+			TextBatch_AddQuad( glyph->texture, pt, charSize, glyph->rect, color, forceAdditive );
 	}
 
 #ifdef SCALE_FONTS
@@ -553,7 +1637,32 @@ int CBaseFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int col
 #define CACHED_FONT_IDENT \
 	(('T'<<24)+('F'<<16)+('I'<<8)+'U') // little-endian "UIFT"
 
-#define CACHED_FONT_VERSION 1
+#define CACHED_FONT_VERSION 4
+
+// atlas is compressed with LZ4
+#define CACHED_FONT_LZ4 BIT( 0 )
+
+/*
+ * Everything is laid out so loaded file can be used in place:
+ * header, then char records, then kerning pairs, then atlas BMP, optionally LZ4 compressed.
+ * Single checksum covers everything after header
+ **/
+struct cached_font_t
+{
+	uint32_t ident;
+	uint32_t version;
+	uint32_t headerSize;
+	uint32_t flags;
+	uint64_t key;          // font file identity, rendering parameters and charset
+	uint32_t charsCount;
+	uint32_t charsOffset;
+	uint32_t kernCount;
+	uint32_t kernOffset;
+	uint32_t atlasOffset;
+	uint32_t atlasSize;    // as stored in file
+	uint32_t atlasRawSize; // BMP file size
+	uint32_t checksum;     // CRC32 of everything after header
+};
 
 struct char_data_t
 {
@@ -562,21 +1671,119 @@ struct char_data_t
 	uint32_t left, right, top, bottom;
 };
 
-struct cached_font_t
+struct kern_data_t
 {
-	uint32_t ident;
-	uint32_t version;
-	uint32_t charsCount;
+	uint16_t left, right;
+	int32_t kern;
 };
 
+// FNV-1a
+static uint64_t FontCache_Hash( uint64_t hash, const void *data, size_t size )
+{
+	const byte *p = (const byte *)data;
+
+	for( size_t i = 0; i < size; i++ )
+	{
+		hash ^= p[i];
+		hash *= 0x100000001B3ULL;
+	}
+
+	return hash;
+}
+
+static uint32_t FontCache_CRC32( const byte *data, size_t size )
+{
+	static uint32_t table[256];
+	static bool init = false;
+	uint32_t crc = 0xFFFFFFFF;
+
+	if( !init )
+	{
+		for( uint32_t i = 0; i < 256; i++ )
+		{
+			uint32_t c = i;
+			for( int j = 0; j < 8; j++ )
+				c = ( c & 1 ) ? ( c >> 1 ) ^ 0xEDB88320 : c >> 1;
+			table[i] = c;
+		}
+		init = true;
+	}
+
+	for( size_t i = 0; i < size; i++ )
+		crc = table[( crc ^ data[i] ) & 0xFF] ^ ( crc >> 8 );
+
+	return crc ^ 0xFFFFFFFF;
+}
+
+/*
+=========================
+CBaseFont::GetCacheKey
+
+Any change of font file, rendering parameters or charset gives different key
+=========================
+*/
+uint64_t CBaseFont::GetCacheKey( charRange_t *range, size_t rangeSize ) const
+{
+	uint64_t hash = 0xCBF29CE484222325ULL;
+	const char *path = GetFontFilePath();
+	int params[] = { CACHED_FONT_VERSION, m_iTall, m_iWeight, m_iFlags, m_iBlur, m_iOutlineSize, m_iScanlineOffset, GetAtlasFormat(), m_pSDF != NULL };
+	float fparams[] = { m_fBrighten, m_fScanlineScale };
+	struct stat st;
+	size_t i;
+
+	hash = FontCache_Hash( hash, m_szName, strlen( m_szName ));
+
+	if( path )
+	{
+		hash = FontCache_Hash( hash, path, strlen( path ));
+
+		if( !stat( path, &st ))
+		{
+			int64_t identity[] = { (int64_t)st.st_size, (int64_t)st.st_mtime };
+			hash = FontCache_Hash( hash, identity, sizeof( identity ));
+		}
+	}
+
+	hash = FontCache_Hash( hash, params, sizeof( params ));
+	hash = FontCache_Hash( hash, fparams, sizeof( fparams ));
+
+	// glyphs may come from any face of the chain
+	for( i = 0; i < (size_t)m_iFallbacks; i++ )
+	{
+		const char *fallbackPath = m_pFallbacks[i]->GetFontFilePath();
+
+		hash = FontCache_Hash( hash, m_pFallbacks[i]->m_szName, strlen( m_pFallbacks[i]->m_szName ));
+
+		if( fallbackPath && !stat( fallbackPath, &st ))
+		{
+			int64_t identity[] = { (int64_t)st.st_size, (int64_t)st.st_mtime };
+			hash = FontCache_Hash( hash, fallbackPath, strlen( fallbackPath ));
+			hash = FontCache_Hash( hash, identity, sizeof( identity ));
+		}
+	}
+
+	for( i = 0; i < rangeSize; i++ )
+	{
+		for( size_t j = 0; j < range[i].Length(); j++ )
+		{
+			int ch = range[i].Character( j );
+			hash = FontCache_Hash( hash, &ch, sizeof( ch ));
+		}
+	}
+
+	return hash;
+}
+
 bool CBaseFont::ReadFromCache( const char *filename, charRange_t *range, size_t rangeSize )
 {
 	char path[512];
-	int size, i, j, charsCount = 0;
+	int size, pixelSize;
+	uint32_t i;
 	byte *data;
-	cached_font_t *hdr;
-	char_data_t *ch;
-	bmp_t *bmp;
+	const cached_font_t *hdr;
+	const char_data_t *ch;
+	const bmp_t *bmp;
+	CUtlVector<byte> atlas;
 
 	V_snprintf( path, sizeof( path ), ".fontcache/%s", filename );
 
@@ -593,58 +1800,70 @@ bool CBaseFont::ReadFromCache( const char *filename, charRange_t *range, size_t
 		return false;
 	}
 
-	for( i = 0; i < rangeSize; i++ )
-		charsCount += range[i].Length();
+	hdr = reinterpret_cast<const cached_font_t *>( data );
 
-	hdr = reinterpret_cast<cached_font_t *>( data );
-
-	if( size < sizeof( cached_font_t ) )
+	if( size < (int)sizeof( cached_font_t ) || hdr->ident != CACHED_FONT_IDENT || hdr->headerSize != sizeof( cached_font_t ))
 	{
-		Con_Printf( "Font cache file is too short\n" );
+		Con_Printf( "Wrong font cache file format\n" );
 		EngFuncs::COM_FreeFile( data );
 		return false;
 	}
 
-	if( hdr->ident != CACHED_FONT_IDENT )
+	if( hdr->version != CACHED_FONT_VERSION )
 	{
-		Con_Printf( "Wrong font cache file format\n" );
+		Con_Printf( "Wrong font cache file version. Expected %d, got %d\n", CACHED_FONT_VERSION, hdr->version );
 		EngFuncs::COM_FreeFile( data );
 		return false;
 	}
 
-	if( hdr->version != CACHED_FONT_VERSION )
+	if( hdr->key != GetCacheKey( range, rangeSize ))
 	{
-		Con_Printf( "Wrong font cache file version. Expected %d, got %d\n", CACHED_FONT_VERSION, hdr->version );
+		Con_Printf( "Font cache file is outdated\n" );
 		EngFuncs::COM_FreeFile( data );
 		return false;
 	}
 
-	if( hdr->charsCount != charsCount )
+	if( hdr->charsOffset < sizeof( cached_font_t ) || hdr->charsOffset > hdr->kernOffset
+		|| hdr->kernOffset > hdr->atlasOffset || hdr->atlasOffset > (uint32_t)size
+		|| hdr->charsCount > ( hdr->kernOffset - hdr->charsOffset ) / sizeof( char_data_t )
+		|| hdr->kernCount > ( hdr->atlasOffset - hdr->kernOffset ) / sizeof( kern_data_t )
+		|| hdr->atlasSize != size - hdr->atlasOffset || hdr->atlasRawSize < sizeof( bmp_t )
+		|| ( !( hdr->flags & CACHED_FONT_LZ4 ) && hdr->atlasSize != hdr->atlasRawSize ))
 	{
-		Con_Printf( "Font cache file has different character set. Expected %d characters in set, got %d\n", charsCount, hdr->charsCount );
+		Con_Printf( "Font cache file is too short or too long\n" );
 		EngFuncs::COM_FreeFile( data );
 		return false;
 	}
 
-	if( size < sizeof( cached_font_t ) + hdr->charsCount * sizeof( char_data_t ))
+	if( FontCache_CRC32( data + sizeof( cached_font_t ), size - sizeof( cached_font_t )) != hdr->checksum )
 	{
-		Con_Printf( "Font cache file is too short (2nd check)\n" );
+		Con_Printf( "Font cache file checksum mismatch\n" );
 		EngFuncs::COM_FreeFile( data );
 		return false;
 	}
 
-	bmp = reinterpret_cast<bmp_t *>(data + sizeof( cached_font_t ) + hdr->charsCount * sizeof( char_data_t ));
+	if( hdr->flags & CACHED_FONT_LZ4 )
+	{
+		atlas.SetCount( hdr->atlasRawSize );
+
+		if( LZ4Block_Decompress( data + hdr->atlasOffset, hdr->atlasSize, atlas.Base(), atlas.Count() ) != atlas.Count() )
+		{
+			Con_Printf( "Failed to decompress font cache atlas\n" );
+			EngFuncs::COM_FreeFile( data );
+			return false;
+		}
 
-	if( bmp->id[0] != 'B' && bmp->id[1] != 'M' )
+		bmp = reinterpret_cast<const bmp_t *>( atlas.Base() );
+	}
+	else
 	{
-		Con_Printf( "Font cache BMP file id check failed\n" );
-		EngFuncs::COM_FreeFile( data );
-		return false;
+		// stored as is, use it in place
+		bmp = reinterpret_cast<const bmp_t *>( data + hdr->atlasOffset );
 	}
 
-	if( size != sizeof( cached_font_t ) + hdr->charsCount * sizeof( char_data_t ) + bmp->fileSize )
+	if( bmp->id[0] != 'B' || bmp->id[1] != 'M' || bmp->fileSize != hdr->atlasRawSize )
 	{
-		Con_Printf( "Font cache file is too short or too long (3rd check)\n" );
+		Con_Printf( "Font cache BMP file id check failed\n" );
 		EngFuncs::COM_FreeFile( data );
 		return false;
 	}
@@ -659,43 +1878,46 @@ bool CBaseFont::ReadFromCache( const char *filename, charRange_t *range, size_t
 		return false;
 	}
 
-	ch = reinterpret_cast<char_data_t *>(data + sizeof( cached_font_t ));
-
-	for( i = 0; i < rangeSize; i++ )
-	{
-		charsCount = range[i].Length();
-
-		for( j = 0; j < charsCount; j++ )
-		{
-			if( ch->ch != range[i].Character( j ))
-			{
-				Con_Printf( "Font cache file has different character set. Expected %d, got %d", range[i].Character( j ), ch->ch );
-				EngFuncs::COM_FreeFile( data );
-				EngFuncs::PIC_Free( filename );
-				return false;
-			}
+	m_bAtlasLoaded = true;
 
-			glyph_t glyph( ch->ch );
-			abc_t abc;
+	// charset is part of the key, so records don't need to be checked one by one
+	ch = reinterpret_cast<const char_data_t *>( data + hdr->charsOffset );
+	m_iWastedBytes = bmp->bitmapDataSize;
+	pixelSize = bmp->bitsPerPixel / 8;
 
-			glyph.rect.left = ch->left;
-			glyph.rect.bottom = ch->bottom;
-			glyph.rect.right = ch->right;
-			glyph.rect.top = ch->top;
-			glyph.texture = hImage;
+	for( i = 0; i < hdr->charsCount; i++, ch++ )
+	{
+		glyph_t glyph( ch->ch );
+		charinfo_t *info = GetCharInfo( ch->ch );
+
+		glyph.rect.left = ch->left;
+		glyph.rect.bottom = ch->bottom;
+		glyph.rect.right = ch->right;
+		glyph.rect.top = ch->top;
+		glyph.texture = hImage;
+
+		m_glyphs.Insert( glyph );
+		m_iWastedBytes -= ( ch->right - ch->left ) * ( ch->bottom - ch->top ) * pixelSize;
+
+		info->a = ch->a;
+		info->b = ch->b;
+		info->c = ch->c;
+		info->flags |= CHARINFO_ABC;
+	}
 
-			m_glyphs.Insert( glyph );
+	const kern_data_t *kern = reinterpret_cast<const kern_data_t *>( data + hdr->kernOffset );
+	CUtlVector<int> pairs;
 
-			abc.ch = ch->ch;
-			abc.a = ch->a;
-			abc.b = ch->b;
-			abc.c = ch->c;
+	for( i = 0; i < hdr->kernCount; i++, kern++ )
+	{
+		pairs.AddToTail( kern->left );
+		pairs.AddToTail( kern->right );
+		pairs.AddToTail( kern->kern );
+	}
 
-			m_ABCCache.Insert( abc );
+	SetKerningPairs( pairs.Base(), hdr->kernCount );
 
-			ch++;
-		}
-	}
+	Con_DPrintf( "%s: %i bytes wasted, %i kerning pairs\n", filename, m_iWastedBytes, m_iKernCount );
 
 	EngFuncs::COM_FreeFile( data );
 	return true;
@@ -704,60 +1926,87 @@ bool CBaseFont::ReadFromCache( const char *filename, charRange_t *range, size_t
 void CBaseFont::SaveToCache( const char *filename, charRange_t *range, size_t rangeSize, CBMP *bmp )
 {
 	char path[512];
-	int i, j;
+	size_t i, j;
 	uint32_t charsCount = 0;
-	byte *data, *buf_p;
-	size_t size = 0, bmpSize = bmp->GetBitmapHdr()->fileSize;
+	const uint32_t bmpSize = bmp->GetBitmapHdr()->fileSize;
+	CUtlVector<byte> data;
+	cached_font_t hdr;
 
 	for( i = 0; i < rangeSize; i++ )
 		charsCount += range[i].Length();
 
-	size = sizeof( cached_font_t ) +
-			charsCount * sizeof( char_data_t ) +
-			bmpSize;
+	memset( &hdr, 0, sizeof( hdr ));
+	hdr.ident = CACHED_FONT_IDENT;
+	hdr.version = CACHED_FONT_VERSION;
+	hdr.headerSize = sizeof( cached_font_t );
+	hdr.key = GetCacheKey( range, rangeSize );
+	hdr.charsCount = charsCount;
+	hdr.charsOffset = sizeof( cached_font_t );
+	hdr.kernCount = m_iKernCount;
+	hdr.kernOffset = hdr.charsOffset + charsCount * sizeof( char_data_t );
+	hdr.atlasOffset = hdr.kernOffset + m_iKernCount * sizeof( kern_data_t );
+	hdr.atlasRawSize = bmpSize;
 
-	buf_p = data = new byte[size];
+	// bound is bigger than uncompressed atlas, it's stored as is if LZ4 doesn't help
+	data.SetCount( hdr.atlasOffset + LZ4Block_Bound( bmpSize ));
 
-	((cached_font_t *)buf_p)->ident = CACHED_FONT_IDENT;
-	((cached_font_t *)buf_p)->version = CACHED_FONT_VERSION;
-	((cached_font_t *)buf_p)->charsCount = charsCount;
-
-	buf_p += sizeof( cached_font_t );
+	char_data_t *ch = reinterpret_cast<char_data_t *>( data.Base() + hdr.charsOffset );
 
 	for( i = 0; i < rangeSize; i++ )
 	{
-		charsCount = range[i].Length();
-
-		for( j = 0; j < charsCount; j++ )
+		for( j = 0; j < range[i].Length(); j++, ch++ )
 		{
-			char_data_t ch;
+			int a, b, c;
 
+			ch->ch = range[i].Character( j );
+			GetCharABCWidths( ch->ch, a, b, c );
+			ch->a = a;
+			ch->b = b;
+			ch->c = c;
 
-			ch.ch = range[i].Character( j );
-			GetCharABCWidths( ch.ch, ch.a, ch.b, ch.c );
-
-			glyph_t glyph( ch.ch );
+			glyph_t glyph( ch->ch );
 			int idx = m_glyphs.Find( glyph );
 
 			glyph = m_glyphs[idx];
 
-			ch.left   = glyph.rect.left;
-			ch.right  = glyph.rect.right;
-			ch.bottom = glyph.rect.bottom;
-			ch.top    = glyph.rect.top;
-
-			memcpy( buf_p, &ch, sizeof( ch ));
-			buf_p += sizeof( ch );
+			ch->left   = glyph.rect.left;
+			ch->right  = glyph.rect.right;
+			ch->bottom = glyph.rect.bottom;
+			ch->top    = glyph.rect.top;
 		}
 	}
 
-	memcpy( buf_p, bmp->GetBitmapHdr(), bmpSize );
+	kern_data_t *kern = reinterpret_cast<kern_data_t *>( data.Base() + hdr.kernOffset );
+
+	for( i = 0; i < (size_t)m_KernHash.Count(); i++ )
+	{
+		if( !m_KernHash[i].key )
+			continue;
 
-	if( buf_p + bmpSize - data != size )
-		Host_Error( "%s: %i: buf_p + bmpSize - data != size", __FILE__, __LINE__ );
+		kern->left  = m_KernHash[i].key >> 16;
+		kern->right = m_KernHash[i].key & 0xFFFF;
+		kern->kern  = m_KernHash[i].kern;
+		kern++;
+	}
 
-	V_snprintf( path, sizeof( path ), ".fontcache/%s", filename );
-	EngFuncs::COM_SaveFile( path, data, size );
+	int compressed = LZ4Block_Compress( (const byte *)bmp->GetBitmapHdr(), bmpSize,
+		data.Base() + hdr.atlasOffset, data.Count() - hdr.atlasOffset );
 
-	delete[] data;
+	if( compressed > 0 && (uint32_t)compressed < bmpSize )
+	{
+		hdr.flags |= CACHED_FONT_LZ4;
+		hdr.atlasSize = compressed;
+	}
+	else
+	{
+		memcpy( data.Base() + hdr.atlasOffset, bmp->GetBitmapHdr(), bmpSize );
+		hdr.atlasSize = bmpSize;
+	}
+
+	data.SetCount( hdr.atlasOffset + hdr.atlasSize );
+	hdr.checksum = FontCache_CRC32( data.Base() + sizeof( cached_font_t ), data.Count() - sizeof( cached_font_t ));
+	memcpy( data.Base(), &hdr, sizeof( hdr ));
+
+	V_snprintf( path, sizeof( path ), ".fontcache/%s", filename );
+	EngFuncs::COM_SaveFile( path, data.Base(), data.Count() );
 }
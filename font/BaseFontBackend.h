@@ -19,12 +19,32 @@ GNU General Public License for more details.
 // #include "port.h" // defines XASH_MOBILE_PLATFORM
 #include "BaseMenu.h"
 #include "utlrbtree.h"
+#include "utlvector.h"
+#include "GlyphWorkers.h"
+#include "SkylinePacker.h"
 
 // #ifdef XASH_MOBILE_PLATFORM
 #if defined(__ANDROID__) || TARGET_OS_IPHONE || defined(__SAILFISH__) || defined(MAINUI_FONT_SCALE)
 #define SCALE_FONTS
 #endif
 
+// fixed set of pages for glyphs rasterized on demand
+#define DYNAMIC_ATLAS_PAGES 4
+#define DYNAMIC_PAGE_SIZE   512
+
+// direct-mapped char info covers latin, cyrillic and everything between
+#define CHARINFO_TABLE_SIZE 0x500
+
+class CSDFSource;
+
+// atlas pixel formats, 8-bit ones are palettized
+enum
+{
+	FONT_ATLAS_RGBA = 0,
+	FONT_ATLAS_ALPHA,           // white, 256 alpha levels
+	FONT_ATLAS_LUMINANCE_ALPHA  // 16 grey levels x 16 alpha levels, for dark outline and scanline pixels, ui_font_8bit 2 only
+};
+
 struct charRange_t
 {
 	int chMin;
@@ -60,11 +80,17 @@ public:
 		int outlineSize,
 		int scanlineOffset, float scanlineScale,
 		int flags ) = 0;
-	virtual void GetCharRGBA( int ch, Point pt, Size sz, byte *rgba, Size &drawSize ) = 0;
+	// thread is GlyphWorkers thread number, main thread is always 0
+	virtual void GetCharRGBA( int ch, Point pt, Size sz, byte *rgba, Size &drawSize, int thread ) = 0;
 	virtual void GetCharABCWidthsNoCache( int ch, int &a, int &b, int &c ) = 0;
 	virtual bool HasChar( int ch ) const = 0;
 	virtual void GetCharABCWidths( int ch, int &a, int &b, int &c );
 	virtual void UploadGlyphsForRanges( charRange_t *range, int rangeSize );
+	// render without uploading, CFontManager packs glyphs of all fonts to shared atlas
+	virtual void RenderGlyphsForRanges( charRange_t *range, int rangeSize );
+	// don't build atlas, every glyph is rasterized when it's drawn first time
+	// ranges are still needed for kerning table, engine isn't used, so it can run on builder thread
+	void UploadGlyphsOnDemand( charRange_t *range, int rangeSize );
 	virtual int  DrawCharacter(int ch, Point pt, int charH, const unsigned int color, bool forceAdditive = false);
 
 	inline int GetHeight() const       { return m_iHeight + GetEfxOffset(); }
@@ -84,9 +110,58 @@ public:
 
 	inline int GetEllipsisWide( ) { return m_iEllipsisWide; }
 
+	// pair adjustment in pixels, added to advance of left character
+	// only pairs of characters from atlas ranges are known
+	inline int GetKerning( int left, int right ) const
+	{
+		if( !m_iKernCount )
+			return 0;
+
+		// most characters don't start any pair
+		if( (unsigned int)left < CHARINFO_TABLE_SIZE && !( m_KernLeft[left >> 3] & BIT( left & 7 )))
+			return 0;
+
+		return FindKerning( left, right );
+	}
+
+	// atlas texture bytes not covered by any glyph
+	inline int GetWastedTextureBytes( ) const { return m_iWastedBytes; }
+
+	// pixel format this font wants for its atlas, RGBA if engine can't load 8-bit images
+	int GetAtlasFormat( void ) const;
+
+	static int  AtlasPixelSize( int format ) { return format == FONT_ATLAS_RGBA ? 4 : 1; }
+	static void SetAtlasPalette( CBMP *bmp, int format );
+	static void StoreAtlasRow( byte *dst, const byte *rgba, int w, int format );
+
+	// takes created face, it's asked for glyphs that this font doesn't have
+	// returns false if face can't be opened or it's the same font file, caller deletes it then
+	bool AddFallback( CBaseFont *face, const char *name );
+	inline int GetFallbackCount() const { return m_iFallbacks; }
+
+	// resolve glyphs from distance fields instead of rasterizing them, source isn't owned
+	inline void SetSDFSource( CSDFSource *source ) { m_pSDF = source; }
+
+	// compare char info tables with RB-tree lookups, prints results to console
+	void BenchmarkLookups( int iterations );
+
 protected:
-	void ApplyBlur( Size rgbaSz, byte *rgba );
-	void ApplyOutline(Point pt, Size rgbaSz, byte *rgba );
+	// real font file, its identity is a part of font cache key. NULL if there is no file
+	virtual const char *GetFontFilePath( void ) const { return NULL; }
+
+	// called on thread that builds the font, before parallel GetCharRGBA calls
+	// returns how many threads backend can rasterize on, 1 if it isn't reentrant
+	virtual int  PrepareWorkers( int threads ) { return 1; }
+	virtual void ReleaseWorkers( void ) { }
+
+	// kern table of font file is shared by all sizes, backend maps characters
+	// to its glyphs and scales font units like its own kerning lookup does
+	virtual bool HasKerning( void ) const { return false; }
+	virtual int  GetGlyphIndex( int ch ) const { return 0; }
+	virtual int  ScaleKerning( int units ) const { return 0; }
+
+	void ApplyBlur( Size rgbaSz, byte *rgba, int thread );
+	void ApplyOutline( Point pt, Size rgbaSz, byte *rgba, int thread );
 	void ApplyScanline( Size rgbaSz, byte *rgba );
 	void ApplyStrikeout( Size rgbaSz, byte *rgba );
 
@@ -106,20 +181,77 @@ protected:
 	// Outlines
 	int  m_iOutlineSize;
 	int m_iEllipsisWide;
+	int m_iWastedBytes;
 
 private:
+	// atlas under GetTextureName() was uploaded by this font, not just named like it
+	bool m_bAtlasLoaded;
+
 	bool ReadFromCache( const char *filename, charRange_t *range, size_t rangeSize );
 	void SaveToCache( const char *filename, charRange_t *range, size_t rangeSize, CBMP *bmp );
+	uint64_t GetCacheKey( charRange_t *range, size_t rangeSize ) const;
+
+	static bool Atlas8BitSupported( void );
+
+	void BuildBlurKernel( void );
+
+	// face that draws the character, this font or one of fallbacks
+	CBaseFont *GetGlyphSource( int ch );
+	int  PrepareFaceWorkers( int threads );
+	void ReleaseFaceWorkers( void );
+
+	static void RasterizeGlyphJob( void *ctx, int index, int thread );
+	void RasterizeGlyph( int ch, Size sz, byte *rgba, Size &drawSize, int thread );
+
+	// glyphs missing in atlas are rasterized to dynamic pages, least recently used rows are evicted
+	int  LoadDynamicGlyph( int ch );
+	bool AllocDynamicRow( int w, int &page, int &row );
+	void EvictDynamicRow( int page, int row );
+	void UploadDynamicPage( int page );
+	static void UploadDirtyPages( void *ctx );
+	void GetDynamicPageName( int page, char *dst, size_t len ) const;
+
+	// non-zero kerning pairs, filled together with atlas and stored in font cache
+	void BuildKerningTable( charRange_t *range, int rangeSize );
+	void SetKerningPairs( const int *pairs, int count );
+	int  FindKerning( int left, int right ) const;
 
-	void GetBlurValueForPixel(float *distribution, byte *src, Point srcPt, Size srcSz, byte *dest);
+	// UploadGlyphsForRanges split in parts, so rendering can be done on another thread
+	bool LoadCachedGlyphs( charRange_t *range, int rangeSize );
+	void RenderGlyphs( charRange_t *range, int rangeSize );
+	void UploadRenderedGlyphs( charRange_t *range, int rangeSize );
+	void GetPendingRects( CUtlVector<CSkylinePacker::rect_t> &rects ) const;
+	int  PlaceGlyphs( const CSkylinePacker::rect_t *rects, CBMP *bmp, int format );
+	void SetGlyphTexture( HIMAGE hImage );
+
+	// rendered glyphs waiting to be placed to atlas, one maxWidth x height slot per glyph
+	CUtlVector<int>  m_PendingChars;
+	CUtlVector<int>  m_PendingWidths;
+	CUtlVector<byte> m_PendingStaging;
+
+	// effect scratch buffers, reused between glyphs, one set per worker thread
+	struct scratch_t
+	{
+		CUtlVector<float> blurScratch;
+		CUtlVector<float> blurRow;
+		CUtlVector<byte>  outlineMask;
+		CUtlVector<unsigned short> outlineDist;
+	};
+
+	CUtlVector<float> m_BlurKernel;
+	CSDFSource *m_pSDF;
+	CBaseFont *m_pFallbacks[MAX_FONT_FALLBACKS];
+	int m_iFallbacks;
+	scratch_t m_Scratch[MAX_GLYPH_WORKERS];
 
 	struct glyph_t
 	{
-		glyph_t() : ch( 0 ), texture( 0 ), rect() { }
-		glyph_t( int ch ) : ch( ch ), texture( 0 ), rect() { }
+		glyph_t() : ch( 0 ), texture( 0 ), rect(), page( -1 ), row( -1 ) { }
+		glyph_t( int ch ) : ch( ch ), texture( 0 ), rect(), page( -1 ), row( -1 ) { }
 		int ch;
 		HIMAGE texture;
 		wrect_t rect;
+		int page, row; // dynamic page location, -1 for glyphs in static atlas
 
 		bool operator< (const glyph_t &a) const
 		{
@@ -127,19 +259,69 @@ private:
 		}
 	};
 
-	struct abc_t
+	// glyph location and ABC widths together, so drawing a character is one lookup
+	// codepoints below CHARINFO_TABLE_SIZE are direct-mapped, others go to open-addressing hash
+	enum
 	{
-		int ch;
-		int a, b, c;
+		CHARINFO_ABC      = BIT( 0 ),
+		CHARINFO_GLYPH    = BIT( 1 ),
+		CHARINFO_NO_GLYPH = BIT( 2 ), // glyph was looked up, but font can't draw it
+		CHARINFO_SOURCE   = BIT( 3 ), // face is resolved
+	};
 
-		bool operator< ( const abc_t &a ) const
-		{
-			return ch < a.ch;
-		}
+	struct charinfo_t
+	{
+		int ch; // hash key, 0 is empty slot
+		short a, b, c;
+		short flags;
+		short page, row; // copied from glyph_t
+		short source;    // 0 is this font, then fallbacks in order
+		HIMAGE texture;
+		wrect_t rect;
 	};
 
+	charinfo_t *GetCharInfo( int ch );
+	charinfo_t *FindCharInfo( int ch );
+	const charinfo_t *GetGlyphInfo( int ch );
+	void ResetGlyphInfo( void );
+	void GrowCharHash( void );
+
+	struct dynrow_t
+	{
+		int x; // free space starts here
+		int lastUsed;
+	};
+
+	struct dynpage_t
+	{
+		dynpage_t() : bmp( NULL ), texture( 0 ), format( FONT_ATLAS_RGBA ), dirty( false ) { }
+		CBMP *bmp;
+		HIMAGE texture;
+		int format;
+		bool dirty; // bitmap has glyphs that aren't uploaded yet
+		CUtlVector<dynrow_t> rows;
+	};
+
+	dynpage_t m_DynPages[DYNAMIC_ATLAS_PAGES];
+	CUtlVector<byte> m_DynStaging;
+	int m_iDynClock;
+
 	CUtlRBTree<glyph_t, int> m_glyphs;
-	CUtlRBTree<abc_t, int>   m_ABCCache;
+
+	charinfo_t m_CharTable[CHARINFO_TABLE_SIZE];
+	CUtlVector<charinfo_t> m_CharHash; // power of two size
+	int m_iCharHashCount;
+
+	// open-addressing hash, key is left << 16 | right, so only BMP pairs are kept
+	struct kernpair_t
+	{
+		unsigned int key; // 0 is empty slot
+		int kern;
+	};
+
+	CUtlVector<kernpair_t> m_KernHash; // power of two size
+	int m_iKernCount;
+	byte m_KernLeft[CHARINFO_TABLE_SIZE / 8]; // bit is set if character starts any pair
 	friend class CFontManager;
 };
 
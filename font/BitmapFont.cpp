@@ -16,6 +16,7 @@ GNU General Public License for more details.
 #include "BaseMenu.h"
 #include "BaseFontBackend.h"
 #include "BitmapFont.h"
+#include "TextBatch.h"
 
 CBitmapFont::CBitmapFont() : CBaseFont(), hImage( 0 ) { }
 CBitmapFont::~CBitmapFont() { }
@@ -60,7 +61,7 @@ bool CBitmapFont::Create(const char *name, int tall, int weight, int blur, float
 	return true;
 }
 
-void CBitmapFont::GetCharRGBA(int ch, Point pt, Size sz, byte *rgba, Size &drawSize)
+void CBitmapFont::GetCharRGBA(int ch, Point pt, Size sz, byte *rgba, Size &drawSize, int thread)
 {
 	// stub!
 	Con_DPrintf( "CBitmapFont::GetCharRGBA\n" );
@@ -98,6 +99,12 @@ void CBitmapFont::UploadGlyphsForRanges(charRange_t *range, int rangeSize)
 	Con_DPrintf( "CBitmapFont::UploadGlyphsForRanges\n" );
 }
 
+void CBitmapFont::RenderGlyphsForRanges(charRange_t *range, int rangeSize)
+{
+	// stub!
+	Con_DPrintf( "CBitmapFont::RenderGlyphsForRanges\n" );
+}
+
 int CBitmapFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int color, bool forceAdditive)
 {
 	// let's say we have twice lower width from height
@@ -119,8 +126,6 @@ int CBitmapFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int c
 
 	if( hImage )
 	{
-		EngFuncs::PIC_Set( hImage, Red( color ), Green( color ), Blue( color ), Alpha( color ));
-
 		float	row, col, size;
 		col = (ch & 15) * 0.0625f + (0.5f / 256.0f);
 		row = (ch >> 4) * 0.0625f + (0.5f / 256.0f);
@@ -137,10 +142,7 @@ int CBitmapFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int c
 		rc.bottom = rc.top + h * size;
 		rc.right  = rc.left + w * size;
 
-		if( forceAdditive )
-			EngFuncs::PIC_DrawAdditive( pt.x, pt.y, charH/2, charH, &rc );
-		else
-			EngFuncs::PIC_DrawTrans( pt.x, pt.y, charH/2, charH, &rc );
+		TextBatch_AddQuad( hImage, pt, Size( charH/2, charH ), rc, color, forceAdditive );
 
 		return charH/2-1;
 
@@ -148,6 +150,9 @@ int CBitmapFont::DrawCharacter(int ch, Point pt, int charH, const unsigned int c
 	else
 	{
 		char str[2] = {(char)ch, 0};
+
+		// console font is drawn by engine, keep it in order with batched quads
+		TextBatch_Flush();
 		EngFuncs::engfuncs.pfnDrawSetTextColor( Red( color ), Green( color ), Blue( color ), Alpha( color ) );
 
 		return EngFuncs::engfuncs.pfnDrawConsoleString( pt.x, pt.y, str ) - pt.x;
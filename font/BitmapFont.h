@@ -30,11 +30,12 @@ public:
 						 int outlineSize,
 						 int scanlineOffset, float scanlineScale,
 						 int flags ) override;
-	void GetCharRGBA( int ch, Point pt, Size sz, byte *rgba, Size &drawSize ) override;
+	void GetCharRGBA( int ch, Point pt, Size sz, byte *rgba, Size &drawSize, int thread ) override;
 	void GetCharABCWidthsNoCache( int ch, int &a, int &b, int &c ) override;
 	void GetCharABCWidths( int ch, int &a, int &b, int &c ) override;
 	bool HasChar( int ch ) const override;
 	void UploadGlyphsForRanges( charRange_t *range, int rangeSize ) override;
+	void RenderGlyphsForRanges( charRange_t *range, int rangeSize ) override;
 	int DrawCharacter(int ch, Point pt, int charH, const unsigned int color, bool forceAdditive = false) override;
 private:
 	HIMAGE hImage;
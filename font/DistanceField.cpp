@@ -0,0 +1,291 @@
+/*
+DistanceField.cpp - signed distance field glyph source
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include <math.h>
+#include "BaseMenu.h"
+#include "BaseFontBackend.h"
+#include "DistanceField.h"
+
+#define SDF_INF 1e20f
+
+CSDFSource::CSDFSource( CBaseFont *reference ) : m_pReference( reference ), m_Fields( 0, 0 )
+{
+	SetDefLessFunc( m_Fields );
+}
+
+CSDFSource::~CSDFSource()
+{
+	delete m_pReference;
+}
+
+bool CSDFSource::IsSourceFor( const char *name, int weight, int flags ) const
+{
+	return m_pReference->IsEqualTo( name, SDF_REFERENCE_TALL, weight, 0, flags );
+}
+
+void CSDFSource::Prepare( const int *chars, int count )
+{
+	for( int i = 0; i < count; i++ )
+	{
+		field_t field;
+		field.ch = chars[i];
+
+		if( !m_Fields.IsValidIndex( m_Fields.Find( field )))
+			BuildField( chars[i] );
+	}
+}
+
+/*
+=========================
+EDT_1D
+
+Squared euclidean distance transform of sampled function,
+Felzenszwalb and Huttenlocher, linear in n
+=========================
+*/
+static void EDT_1D( const float *f, float *d, int *v, float *z, int n )
+{
+	int k = 0, q;
+
+	v[0] = 0;
+	z[0] = -SDF_INF;
+	z[1] = SDF_INF;
+
+	for( q = 1; q < n; q++ )
+	{
+		float s = (( f[q] + q * q ) - ( f[v[k]] + v[k] * v[k] )) / ( 2 * q - 2 * v[k] );
+
+		while( s <= z[k] )
+		{
+			k--;
+			s = (( f[q] + q * q ) - ( f[v[k]] + v[k] * v[k] )) / ( 2 * q - 2 * v[k] );
+		}
+
+		k++;
+		v[k] = q;
+		z[k] = s;
+		z[k + 1] = SDF_INF;
+	}
+
+	for( k = 0, q = 0; q < n; q++ )
+	{
+		while( z[k + 1] < q )
+			k++;
+
+		d[q] = ( q - v[k] ) * ( q - v[k] ) + f[v[k]];
+	}
+}
+
+static void EDT_2D( float *grid, int w, int h, float *column, float *dist, int *v, float *z )
+{
+	int x, y;
+
+	for( x = 0; x < w; x++ )
+	{
+		for( y = 0; y < h; y++ )
+			column[y] = grid[y * w + x];
+
+		EDT_1D( column, dist, v, z, h );
+
+		for( y = 0; y < h; y++ )
+			grid[y * w + x] = dist[y];
+	}
+
+	for( y = 0; y < h; y++ )
+	{
+		EDT_1D( &grid[y * w], dist, v, z, w );
+
+		for( x = 0; x < w; x++ )
+			grid[y * w + x] = sqrt( dist[x] );
+	}
+}
+
+/*
+=========================
+CSDFSource::BuildField
+
+Rasterize glyph at reference size, then take distances to nearest inside and outside pixels.
+Antialiased edge pixels already know their distance from coverage
+=========================
+*/
+void CSDFSource::BuildField( int ch )
+{
+	const int slotW = m_pReference->GetMaxCharWidth();
+	const int slotH = m_pReference->GetHeight();
+	Size drawSize;
+	field_t field;
+	int x, y;
+
+	if( slotW <= 0 || slotH <= 0 )
+		return;
+
+	m_Slot.SetCount( slotW * slotH * 4 );
+	memset( m_Slot.Base(), 0, m_Slot.Count() );
+
+	m_pReference->GetCharRGBA( ch, Point( 0, 0 ), Size( slotW, slotH ), m_Slot.Base(), drawSize, 0 );
+
+	const int glyphW = bound( 0, drawSize.w, slotW );
+	const int w = glyphW + SDF_SPREAD * 2;
+	const int h = slotH + SDF_SPREAD * 2;
+	const int n = Q_max( w, h );
+
+	m_Inside.SetCount( w * h );
+	m_Outside.SetCount( w * h );
+	m_Column.SetCount( n );
+	m_Dist.SetCount( n );
+	m_Z.SetCount( n + 1 );
+	m_V.SetCount( n );
+
+	for( y = 0; y < h; y++ )
+	{
+		for( x = 0; x < w; x++ )
+		{
+			int sx = x - SDF_SPREAD, sy = y - SDF_SPREAD;
+			int alpha = 0;
+
+			if( sx >= 0 && sx < glyphW && sy >= 0 && sy < slotH )
+				alpha = m_Slot[( sy * slotW + sx ) * 4 + 3];
+
+			// zero where feature is, distance is searched to it
+			m_Inside[y * w + x] = alpha >= 128 ? 0.0f : SDF_INF;
+			m_Outside[y * w + x] = alpha >= 128 ? SDF_INF : 0.0f;
+		}
+	}
+
+	EDT_2D( m_Inside.Base(), w, h, m_Column.Base(), m_Dist.Base(), m_V.Base(), m_Z.Base() );
+	EDT_2D( m_Outside.Base(), w, h, m_Column.Base(), m_Dist.Base(), m_V.Base(), m_Z.Base() );
+
+	field.ch = ch;
+	field.w = w;
+	field.h = h;
+	field.offset = m_Data.Count();
+
+	m_Data.AddMultipleToTail( w * h );
+
+	for( y = 0; y < h; y++ )
+	{
+		for( x = 0; x < w; x++ )
+		{
+			int sx = x - SDF_SPREAD, sy = y - SDF_SPREAD;
+			float d;
+
+			// positive inside, pixel centers are half pixel away from edge
+			if( m_Inside[y * w + x] == 0.0f )
+				d = m_Outside[y * w + x] - 0.5f;
+			else
+				d = 0.5f - m_Inside[y * w + x];
+
+			if( sx >= 0 && sx < glyphW && sy >= 0 && sy < slotH )
+			{
+				int alpha = m_Slot[( sy * slotW + sx ) * 4 + 3];
+
+				if( alpha > 0 && alpha < 255 )
+					d = alpha / 255.0f - 0.5f;
+			}
+
+			m_Data[field.offset + y * w + x] = bound( 0, (int)( 128.0f + d * ( 127.0f / SDF_SPREAD ) + 0.5f ), 255 );
+		}
+	}
+
+	m_Fields.Insert( field );
+}
+
+/*
+=========================
+CSDFSource::Sample
+
+Bilinear distance in reference pixels, everything outside of field is far away
+=========================
+*/
+float CSDFSource::Sample( const field_t &field, float x, float y ) const
+{
+	const byte *data = &m_Data[field.offset];
+	int x0 = (int)floor( x ), y0 = (int)floor( y );
+	float fx = x - x0, fy = y - y0;
+	float v[4];
+
+	for( int i = 0; i < 4; i++ )
+	{
+		int sx = x0 + ( i & 1 ), sy = y0 + ( i >> 1 );
+
+		if( sx < 0 || sx >= field.w || sy < 0 || sy >= field.h )
+			v[i] = 0.0f;
+		else
+			v[i] = data[sy * field.w + sx];
+	}
+
+	float top = v[0] + ( v[1] - v[0] ) * fx;
+	float bottom = v[2] + ( v[3] - v[2] ) * fx;
+
+	return ( top + ( bottom - top ) * fy - 128.0f ) * ( SDF_SPREAD / 127.0f );
+}
+
+void CSDFSource::Resolve( int ch, const resolve_t &params, Size sz, byte *rgba, Size &drawSize ) const
+{
+	field_t key;
+	int x, y;
+
+	key.ch = ch;
+	int idx = m_Fields.Find( key );
+
+	drawSize.w = drawSize.h = 0;
+
+	if( !m_Fields.IsValidIndex( idx ) || params.scale <= 0.0f )
+		return;
+
+	const field_t &field = m_Fields[idx];
+	const float invScale = 1.0f / params.scale;
+	const float sigma = 0.5f * params.blur;
+	const float brighten = params.brighten * params.brighten; // blur kernel is brightened on both passes
+	const int glyphW = field.w - SDF_SPREAD * 2;
+
+	for( y = 0; y < sz.h; y++ )
+	{
+		// field pixel centers are at integer coordinates
+		float fy = ( y + 0.5f - params.baselineY ) * invScale + m_pReference->GetAscent() + SDF_SPREAD - 0.5f;
+		byte *dst = &rgba[y * sz.w * 4];
+
+		for( x = 0; x < sz.w; x++, dst += 4 )
+		{
+			float fx = ( x + 0.5f - params.offsetX ) * invScale + SDF_SPREAD - 0.5f;
+			float d = Sample( field, fx, fy ) * params.scale;
+			float alpha, lum = 1.0f;
+
+			if( params.blur )
+			{
+				// coverage of gaussian blurred edge, logistic approximation of normal CDF
+				alpha = Q_min( brighten / ( 1.0f + exp( -1.702f * d / sigma )), 1.0f );
+			}
+			else
+			{
+				float coverage = bound( 0.0f, d + 0.5f, 1.0f );
+
+				alpha = coverage;
+
+				// dark band around the glyph
+				if( params.outline )
+				{
+					alpha = bound( 0.0f, d + params.outline + 0.5f, 1.0f );
+					lum = alpha > 0.0f ? coverage / alpha : 0.0f;
+				}
+			}
+
+			dst[0] = dst[1] = dst[2] = (byte)( lum * 255.0f + 0.5f );
+			dst[3] = (byte)( alpha * 255.0f + 0.5f );
+		}
+	}
+
+	drawSize.w = Q_min( (int)ceil( glyphW * params.scale ) + params.offsetX * 2, sz.w );
+	drawSize.h = sz.h;
+}
@@ -0,0 +1,85 @@
+/*
+DistanceField.h - signed distance field glyph source
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef DISTANCEFIELD_H
+#define DISTANCEFIELD_H
+
+#include "utlrbtree.h"
+#include "utlvector.h"
+
+// fields are built once at this size and resolved to any other
+#define SDF_REFERENCE_TALL 48
+
+// max stored distance in reference pixels, enough for heavy blur at half size
+#define SDF_SPREAD 16
+
+class CBaseFont;
+
+/*
+ * Distance fields of one typeface, shared by all sizes and effects of it.
+ * Glow and outline are thresholds on distance, so they cost nothing extra
+ **/
+class CSDFSource
+{
+public:
+	// takes ownership of reference font, it must be created with SDF_REFERENCE_TALL and no effects
+	CSDFSource( CBaseFont *reference );
+	~CSDFSource();
+
+	bool IsSourceFor( const char *name, int weight, int flags ) const;
+
+	// build fields for chars that don't have them yet, main thread only
+	void Prepare( const int *chars, int count );
+
+	struct resolve_t
+	{
+		float scale;     // target tall / reference tall
+		int   offsetX;   // glyph start in slot
+		int   baselineY; // target ascent
+		int   blur;
+		float brighten;
+		int   outline;
+	};
+
+	// write glyph to RGBA slot like CBaseFont::GetCharRGBA, can be called from worker threads
+	void Resolve( int ch, const resolve_t &params, Size sz, byte *rgba, Size &drawSize ) const;
+
+private:
+	struct field_t
+	{
+		int ch;
+		int w, h;   // with SDF_SPREAD padding on every side
+		int offset; // in m_Data
+
+		bool operator< ( const field_t &a ) const
+		{
+			return ch < a.ch;
+		}
+	};
+
+	void BuildField( int ch );
+	float Sample( const field_t &field, float x, float y ) const;
+
+	CBaseFont *m_pReference;
+	CUtlRBTree<field_t, int> m_Fields;
+	CUtlVector<byte> m_Data;
+
+	// scratch, only used by Prepare
+	CUtlVector<byte>  m_Slot;
+	CUtlVector<float> m_Inside, m_Outside, m_Column, m_Dist, m_Z;
+	CUtlVector<int>   m_V;
+};
+
+#endif // DISTANCEFIELD_H
@@ -0,0 +1,356 @@
+/*
+FontFile.cpp - font file data shared between fonts
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "FontFile.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static bool FontFile_Map( fontfile_t *file )
+{
+#if defined(_WIN32)
+	HANDLE hFile = CreateFileA( file->path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL );
+
+	if( hFile == INVALID_HANDLE_VALUE )
+		return false;
+
+	LARGE_INTEGER size;
+	HANDLE hMapping = NULL;
+
+	if( GetFileSizeEx( hFile, &size ) && size.QuadPart > 0 )
+		hMapping = CreateFileMappingA( hFile, NULL, PAGE_READONLY, 0, 0, NULL );
+
+	// mapping keeps file open by itself
+	CloseHandle( hFile );
+
+	if( !hMapping )
+		return false;
+
+	void *view = MapViewOfFile( hMapping, FILE_MAP_READ, 0, 0, 0 );
+
+	if( !view )
+	{
+		CloseHandle( hMapping );
+		return false;
+	}
+
+	file->data = (const unsigned char *)view;
+	file->size = (size_t)size.QuadPart;
+	file->mapHandle = hMapping;
+	file->mapped = true;
+	return true;
+#else
+	struct stat st;
+	int fd = open( file->path, O_RDONLY );
+
+	if( fd < 0 )
+		return false;
+
+	if( fstat( fd, &st ) || st.st_size <= 0 )
+	{
+		close( fd );
+		return false;
+	}
+
+	void *view = mmap( NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+	close( fd );
+
+	if( view == MAP_FAILED )
+		return false;
+
+	file->data = (const unsigned char *)view;
+	file->size = st.st_size;
+	file->mapped = true;
+	return true;
+#endif
+}
+
+bool FontFile_Load( fontfile_t *file )
+{
+	file->data = NULL;
+	file->size = 0;
+	file->mapped = false;
+	file->mapHandle = NULL;
+	file->kernPairs = NULL;
+	file->kernCount = 0;
+	file->kernParsed = false;
+
+	if( FontFile_Map( file ))
+		return true;
+
+	// EngFuncs::COM_LoadFile does not allow open files from /
+	FILE *fd = fopen( file->path, "rb" );
+	if( !fd )
+		return false;
+
+	fseek( fd, 0, SEEK_END );
+	size_t len = ftell( fd );
+	fseek( fd, 0, SEEK_SET );
+
+	unsigned char *data = new unsigned char[len + 1];
+	size_t red = fread( data, 1, len, fd );
+	fclose( fd );
+
+	if( red != len )
+	{
+		delete [] data;
+		return false;
+	}
+
+	file->data = data;
+	file->size = len;
+	return true;
+}
+
+void FontFile_Free( fontfile_t *file )
+{
+	if( !file->data )
+		return;
+
+	if( !file->mapped )
+	{
+		delete [] file->data;
+	}
+	else
+	{
+#if defined(_WIN32)
+		UnmapViewOfFile( file->data );
+		CloseHandle( (HANDLE)file->mapHandle );
+#else
+		munmap( (void *)file->data, file->size );
+#endif
+	}
+
+	file->data = NULL;
+	file->size = 0;
+	file->mapped = false;
+	file->mapHandle = NULL;
+
+	delete [] file->kernPairs;
+	file->kernPairs = NULL;
+	file->kernCount = 0;
+	file->kernParsed = false;
+}
+
+static inline unsigned int FontFile_U16( const unsigned char *p )
+{
+	return ( p[0] << 8 ) | p[1];
+}
+
+static inline unsigned int FontFile_U32( const unsigned char *p )
+{
+	return ( (unsigned int)p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+static int FontFile_CompareKernPairs( const void *a, const void *b )
+{
+	const fontkernpair_t *pa = (const fontkernpair_t *)a;
+	const fontkernpair_t *pb = (const fontkernpair_t *)b;
+
+	if( pa->left != pb->left )
+		return pa->left - pb->left;
+	return pa->right - pb->right;
+}
+
+/*
+=========================
+FontFile_FindTable
+
+Fonts are created with face index 0, so collections use their first face
+=========================
+*/
+static const unsigned char *FontFile_FindTable( const fontfile_t *file, const char *tag, size_t &length )
+{
+	const unsigned char *data = file->data;
+	size_t offset = 0;
+
+	if( file->size < 12 )
+		return NULL;
+
+	if( !memcmp( data, "ttcf", 4 ))
+	{
+		if( file->size < 16 )
+			return NULL;
+
+		offset = FontFile_U32( data + 12 );
+
+		if( offset + 12 > file->size )
+			return NULL;
+	}
+
+	const unsigned int numTables = FontFile_U16( data + offset + 4 );
+	const unsigned char *rec = data + offset + 12;
+
+	if( offset + 12 + numTables * 16 > file->size )
+		return NULL;
+
+	for( unsigned int i = 0; i < numTables; i++, rec += 16 )
+	{
+		if( memcmp( rec, tag, 4 ))
+			continue;
+
+		size_t tableOffset = FontFile_U32( rec + 8 );
+		length = FontFile_U32( rec + 12 );
+
+		if( tableOffset > file->size || length > file->size - tableOffset )
+			return NULL;
+
+		return data + tableOffset;
+	}
+
+	return NULL;
+}
+
+/*
+=========================
+FontFile_KernSubtable
+
+Returns next subtable or NULL if table is broken. pairs is NULL if subtable
+doesn't adjust advance: only format 0 horizontal non-minimum ones are used
+=========================
+*/
+static const unsigned char *FontFile_KernSubtable( const unsigned char *sub, const unsigned char *end, bool last,
+	const unsigned char *&pairs, int &numPairs, bool &override )
+{
+	pairs = NULL;
+	numPairs = 0;
+
+	if( sub + 14 > end )
+		return NULL;
+
+	const unsigned int length = FontFile_U16( sub + 2 );
+	const unsigned int coverage = FontFile_U16( sub + 4 );
+	const unsigned char *next = sub + length;
+
+	if( length <= 14 )
+		return NULL;
+
+	// length is 16-bit, so it overflows in big tables, they are always the only one
+	if( last || next > end )
+		next = end;
+
+	if(( coverage >> 8 ) != 0 || ( coverage & 3 ) != 1 )
+		return next;
+
+	pairs = sub + 14;
+	numPairs = FontFile_U16( sub + 6 );
+	override = ( coverage & 8 ) != 0;
+
+	if( numPairs * 6 > next - pairs )
+		numPairs = ( next - pairs ) / 6;
+
+	return next;
+}
+
+/*
+=========================
+FontFile_ParseKerning
+
+Only version 0 table, like in FreeType. Pairs from all subtables
+are summed, unless later subtable overrides them
+=========================
+*/
+void FontFile_ParseKerning( fontfile_t *file )
+{
+	const unsigned char *kern, *end, *sub, *pairs;
+	size_t length;
+	int numPairs, count, outCount, i, j;
+	unsigned int numSubtables, n;
+	bool override;
+
+	if( file->kernParsed )
+		return;
+
+	file->kernParsed = true;
+
+	kern = FontFile_FindTable( file, "kern", length );
+
+	if( !kern || length < 4 || FontFile_U16( kern ) != 0 )
+		return;
+
+	end = kern + length;
+	numSubtables = FontFile_U16( kern + 2 );
+
+	// count first, so pairs are allocated once
+	count = 0;
+	for( n = 0, sub = kern + 4; n < numSubtables && sub; n++ )
+	{
+		sub = FontFile_KernSubtable( sub, end, n == numSubtables - 1, pairs, numPairs, override );
+		count += numPairs;
+	}
+
+	if( !count )
+		return;
+
+	fontkernpair_t *out = new fontkernpair_t[count];
+
+	outCount = 0;
+	for( n = 0, sub = kern + 4; n < numSubtables && sub; n++ )
+	{
+		const int first = outCount;
+
+		sub = FontFile_KernSubtable( sub, end, n == numSubtables - 1, pairs, numPairs, override );
+
+		for( i = 0; i < numPairs; i++, pairs += 6 )
+		{
+			fontkernpair_t &p = out[outCount++];
+
+			p.left = FontFile_U16( pairs );
+			p.right = FontFile_U16( pairs + 2 );
+			p.value = (short)FontFile_U16( pairs + 4 );
+		}
+
+		if( !override || !first || outCount == first )
+			continue;
+
+		// earlier values of pairs from this subtable are replaced
+		qsort( out + first, outCount - first, sizeof( *out ), FontFile_CompareKernPairs );
+
+		for( i = 0; i < first; i++ )
+		{
+			if( bsearch( &out[i], out + first, outCount - first, sizeof( *out ), FontFile_CompareKernPairs ))
+				out[i].value = 0;
+		}
+	}
+
+	// sum same pairs from different subtables, drop zeroes
+	qsort( out, outCount, sizeof( *out ), FontFile_CompareKernPairs );
+
+	for( i = 0, j = -1; i < outCount; i++ )
+	{
+		if( j >= 0 && !FontFile_CompareKernPairs( &out[j], &out[i] ))
+			out[j].value += out[i].value;
+		else
+			out[++j] = out[i];
+	}
+
+	for( i = 0, count = 0; i <= j; i++ )
+	{
+		if( out[i].value )
+			out[count++] = out[i];
+	}
+
+	file->kernPairs = out;
+	file->kernCount = count;
+}
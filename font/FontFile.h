@@ -0,0 +1,53 @@
+/*
+FontFile.h - font file data shared between fonts
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef FONTFILE_H
+#define FONTFILE_H
+
+#include <stddef.h>
+
+#define MAX_FONT_FILE_PATH 4096
+
+// glyph indices and adjustment in font units, sorted by left then right
+struct fontkernpair_t
+{
+	unsigned short left, right;
+	int value;
+};
+
+struct fontfile_t
+{
+	char path[MAX_FONT_FILE_PATH];
+	const unsigned char *data;
+	size_t size;
+	int refCount;
+
+	bool mapped;     // data is memory mapped, otherwise allocated
+	void *mapHandle; // win32 file mapping object
+
+	// pairs of first face, shared by all sizes, parsed on first use
+	fontkernpair_t *kernPairs;
+	int kernCount;
+	bool kernParsed;
+};
+
+// memory map whole file, read it to memory if mapping isn't possible
+bool FontFile_Load( fontfile_t *file );
+void FontFile_Free( fontfile_t *file );
+
+// read horizontal pairs of 'kern' table, the one FreeType and stb_truetype use
+void FontFile_ParseKerning( fontfile_t *file );
+
+#endif // FONTFILE_H
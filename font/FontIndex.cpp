@@ -0,0 +1,662 @@
+/*
+FontIndex.cpp - system font index, family and style to file path
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include <ctype.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+#include "BaseMenu.h"
+#include "Utils.h"
+#include "FontIndex.h"
+#include "utlvector.h"
+
+#if !defined(_WIN32)
+#include <dirent.h>
+#define FONTINDEX_SCAN 1
+#endif
+
+#define FONTINDEX_MAX_DEPTH 8
+
+struct fontindexentry_t
+{
+	int family; // offsets in s_Strings
+	int path;
+	int weight; // OS/2 weight class, 400 is regular, 700 is bold
+	bool italic;
+};
+
+struct fontindexdir_t
+{
+	int path;
+	int64_t mtime;
+};
+
+static CUtlVector<char> s_Strings;
+static CUtlVector<fontindexentry_t> s_Entries;
+static CUtlVector<fontindexdir_t> s_Dirs;
+static bool s_bInitialized = false;
+
+// used when requested family isn't installed, like fontconfig's default sans
+static const char *s_DefaultFamilies[] =
+{
+	"DejaVu Sans",
+	"Liberation Sans",
+	"Noto Sans",
+	"FreeSans",
+	"Droid Sans",
+};
+
+static int FontIndex_AddString( const char *str )
+{
+	int offset = s_Strings.Count();
+	int len = strlen( str ) + 1;
+
+	s_Strings.AddMultipleToTail( len );
+	memcpy( &s_Strings[offset], str, len );
+
+	return offset;
+}
+
+static inline const char *FontIndex_String( int offset )
+{
+	return &s_Strings[offset];
+}
+
+static void FontIndex_Clear( void )
+{
+	s_Strings.RemoveAll();
+	s_Entries.RemoveAll();
+	s_Dirs.RemoveAll();
+}
+
+/*
+=========================
+FontIndex_FamilyEqual
+
+Case and spaces are ignored, so RobotoCondensed matches Roboto Condensed
+=========================
+*/
+static bool FontIndex_FamilyEqual( const char *a, const char *b )
+{
+	while( true )
+	{
+		while( *a == ' ' || *a == '-' ) a++;
+		while( *b == ' ' || *b == '-' ) b++;
+
+		if( tolower( (byte)*a ) != tolower( (byte)*b ))
+			return false;
+
+		if( !*a )
+			return true;
+
+		a++;
+		b++;
+	}
+}
+
+#if defined(FONTINDEX_SCAN)
+
+static inline uint16_t FontIndex_U16( const byte *p )
+{
+	return ( p[0] << 8 ) | p[1];
+}
+
+static inline uint32_t FontIndex_U32( const byte *p )
+{
+	return ( (uint32_t)p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3];
+}
+
+static bool FontIndex_ReadAt( FILE *fp, long offset, void *buf, size_t size )
+{
+	if( fseek( fp, offset, SEEK_SET ))
+		return false;
+
+	return fread( buf, 1, size, fp ) == size;
+}
+
+/*
+=========================
+FontIndex_ReadFamily
+
+Typographic family is preferred, it doesn't have style words like "Light" in it
+=========================
+*/
+static bool FontIndex_ReadFamily( FILE *fp, uint32_t offset, uint32_t length, char *family, int familyChars )
+{
+	CUtlVector<byte> table;
+	int best = -1, bestScore = 0;
+	int i;
+
+	if( length < 6 || length > 1024 * 1024 )
+		return false;
+
+	table.SetCount( length );
+
+	if( !FontIndex_ReadAt( fp, offset, table.Base(), length ))
+		return false;
+
+	const byte *data = table.Base();
+	const int count = FontIndex_U16( data + 2 );
+	const int strings = FontIndex_U16( data + 4 );
+
+	for( i = 0; i < count && 6 + ( i + 1 ) * 12 <= (int)length; i++ )
+	{
+		const byte *rec = data + 6 + i * 12;
+		int platform = FontIndex_U16( rec );
+		int language = FontIndex_U16( rec + 4 );
+		int nameID = FontIndex_U16( rec + 6 );
+		int score = 0;
+
+		if( nameID == 16 ) score += 4;
+		else if( nameID == 1 ) score += 2;
+		else continue;
+
+		if( platform == 3 ) score += language == 0x409 ? 2 : 1;
+		else if( platform != 1 ) continue;
+
+		if( score > bestScore )
+		{
+			best = i;
+			bestScore = score;
+		}
+	}
+
+	if( best < 0 )
+		return false;
+
+	const byte *rec = data + 6 + best * 12;
+	const int platform = FontIndex_U16( rec );
+	const int len = FontIndex_U16( rec + 8 );
+	const int start = strings + FontIndex_U16( rec + 10 );
+	int out = 0;
+
+	if( start + len > (int)length )
+		return false;
+
+	if( platform == 3 )
+	{
+		// UTF-16BE, family names are BMP only
+		for( i = 0; i + 1 < len && out < familyChars - 4; i += 2 )
+		{
+			int ch = FontIndex_U16( data + start + i );
+
+			if( ch < 0x80 )
+			{
+				family[out++] = ch;
+			}
+			else if( ch < 0x800 )
+			{
+				family[out++] = 0xC0 | ( ch >> 6 );
+				family[out++] = 0x80 | ( ch & 0x3F );
+			}
+			else
+			{
+				family[out++] = 0xE0 | ( ch >> 12 );
+				family[out++] = 0x80 | (( ch >> 6 ) & 0x3F );
+				family[out++] = 0x80 | ( ch & 0x3F );
+			}
+		}
+	}
+	else
+	{
+		for( i = 0; i < len && out < familyChars - 1; i++ )
+			family[out++] = data[start + i];
+	}
+
+	family[out] = 0;
+	return out > 0;
+}
+
+/*
+=========================
+FontIndex_ReadFont
+
+Only table directory, name and OS/2 tables are read, not whole file.
+Fonts are created with face index 0, so only first face of collection is indexed
+=========================
+*/
+static bool FontIndex_ReadFont( const char *path, char *family, int familyChars, int &weight, bool &italic )
+{
+	FILE *fp = fopen( path, "rb" );
+	byte header[12], record[16], os2[64], head[54];
+	uint32_t base = 0, nameOffset = 0, nameLength = 0;
+	uint32_t os2Offset = 0, os2Length = 0, headOffset = 0;
+	bool ok = false;
+
+	if( !fp )
+		return false;
+
+	weight = 400;
+	italic = false;
+
+	if( !FontIndex_ReadAt( fp, 0, header, sizeof( header )))
+		goto done;
+
+	if( !memcmp( header, "ttcf", 4 ))
+	{
+		byte first[4];
+
+		if( !FontIndex_ReadAt( fp, 12, first, sizeof( first )))
+			goto done;
+
+		base = FontIndex_U32( first );
+
+		if( !FontIndex_ReadAt( fp, base, header, sizeof( header )))
+			goto done;
+	}
+
+	if( FontIndex_U32( header ) != 0x00010000 && memcmp( header, "OTTO", 4 ) && memcmp( header, "true", 4 ))
+		goto done;
+
+	for( int i = 0; i < FontIndex_U16( header + 4 ); i++ )
+	{
+		if( !FontIndex_ReadAt( fp, base + 12 + i * 16, record, sizeof( record )))
+			goto done;
+
+		if( !memcmp( record, "name", 4 ))
+		{
+			nameOffset = FontIndex_U32( record + 8 );
+			nameLength = FontIndex_U32( record + 12 );
+		}
+		else if( !memcmp( record, "OS/2", 4 ))
+		{
+			os2Offset = FontIndex_U32( record + 8 );
+			os2Length = FontIndex_U32( record + 12 );
+		}
+		else if( !memcmp( record, "head", 4 ))
+		{
+			headOffset = FontIndex_U32( record + 8 );
+		}
+	}
+
+	if( !nameOffset || !FontIndex_ReadFamily( fp, nameOffset, nameLength, family, familyChars ))
+		goto done;
+
+	if( os2Offset && os2Length >= 64 && FontIndex_ReadAt( fp, os2Offset, os2, sizeof( os2 )))
+	{
+		weight = FontIndex_U16( os2 + 4 );
+		italic = ( FontIndex_U16( os2 + 62 ) & ( BIT( 0 ) | BIT( 9 ))) != 0;
+	}
+	else if( headOffset && FontIndex_ReadAt( fp, headOffset, head, sizeof( head )))
+	{
+		int macStyle = FontIndex_U16( head + 44 );
+
+		weight = ( macStyle & BIT( 0 )) ? 700 : 400;
+		italic = ( macStyle & BIT( 1 )) != 0;
+	}
+
+	ok = true;
+
+done:
+	fclose( fp );
+	return ok;
+}
+
+static bool FontIndex_IsFontFile( const char *name )
+{
+	const char *ext = strrchr( name, '.' );
+
+	if( !ext )
+		return false;
+
+	return !stricmp( ext, ".ttf" ) || !stricmp( ext, ".otf" ) || !stricmp( ext, ".ttc" );
+}
+
+static void FontIndex_ScanDir( const char *path, int depth )
+{
+	struct stat st;
+	struct dirent *ent;
+	DIR *dir;
+
+	if( depth > FONTINDEX_MAX_DEPTH || stat( path, &st ) || !S_ISDIR( st.st_mode ))
+		return;
+
+	if( !( dir = opendir( path )))
+		return;
+
+	fontindexdir_t d;
+	d.path = FontIndex_AddString( path );
+	d.mtime = st.st_mtime;
+	s_Dirs.AddToTail( d );
+
+	while(( ent = readdir( dir )))
+	{
+		char full[4096];
+
+		if( ent->d_name[0] == '.' )
+			continue;
+
+		V_snprintf( full, sizeof( full ), "%s/%s", path, ent->d_name );
+
+		if( stat( full, &st ))
+			continue;
+
+		if( S_ISDIR( st.st_mode ))
+		{
+			FontIndex_ScanDir( full, depth + 1 );
+			continue;
+		}
+
+		if( !FontIndex_IsFontFile( ent->d_name ))
+			continue;
+
+		char family[128];
+		fontindexentry_t e;
+
+		if( !FontIndex_ReadFont( full, family, sizeof( family ), e.weight, e.italic ))
+			continue;
+
+		e.family = FontIndex_AddString( family );
+		e.path = FontIndex_AddString( full );
+		s_Entries.AddToTail( e );
+	}
+
+	closedir( dir );
+}
+
+static void FontIndex_AddRoot( CUtlVector<char> &roots, const char *path )
+{
+	int offset = roots.Count();
+	int len = strlen( path ) + 1;
+
+	roots.AddMultipleToTail( len );
+	memcpy( &roots[offset], path, len );
+}
+
+/*
+=========================
+FontIndex_GetRoots
+
+Same directories fontconfig looks into by default, as zero separated list
+=========================
+*/
+static void FontIndex_GetRoots( CUtlVector<char> &roots )
+{
+	const char *home = getenv( "HOME" );
+	const char *dataHome = getenv( "XDG_DATA_HOME" );
+	char path[4096];
+
+	FontIndex_AddRoot( roots, "/usr/share/fonts" );
+	FontIndex_AddRoot( roots, "/usr/local/share/fonts" );
+
+	if( home && home[0] )
+	{
+		V_snprintf( path, sizeof( path ), "%s/.fonts", home );
+		FontIndex_AddRoot( roots, path );
+
+		if( !dataHome || !dataHome[0] )
+		{
+			V_snprintf( path, sizeof( path ), "%s/.local/share/fonts", home );
+			FontIndex_AddRoot( roots, path );
+		}
+	}
+
+	if( dataHome && dataHome[0] )
+	{
+		V_snprintf( path, sizeof( path ), "%s/fonts", dataHome );
+		FontIndex_AddRoot( roots, path );
+	}
+}
+
+static int64_t FontIndex_DirTime( const char *path )
+{
+	struct stat st;
+
+	if( stat( path, &st ) || !S_ISDIR( st.st_mode ))
+		return 0;
+
+	return st.st_mtime;
+}
+
+/*
+=========================
+FontIndex_IsValid
+
+Adding or removing font changes mtime of its directory.
+Missing roots are kept with zero time, so creating them is noticed too
+=========================
+*/
+static bool FontIndex_IsValid( void )
+{
+	CUtlVector<char> roots;
+	int i;
+
+	for( i = 0; i < s_Dirs.Count(); i++ )
+	{
+		if( FontIndex_DirTime( FontIndex_String( s_Dirs[i].path )) != s_Dirs[i].mtime )
+			return false;
+	}
+
+	FontIndex_GetRoots( roots );
+
+	for( const char *root = roots.Base(); root < roots.Base() + roots.Count(); root += strlen( root ) + 1 )
+	{
+		for( i = 0; i < s_Dirs.Count(); i++ )
+		{
+			if( !strcmp( FontIndex_String( s_Dirs[i].path ), root ))
+				break;
+		}
+
+		if( i == s_Dirs.Count() )
+			return false;
+	}
+
+	return true;
+}
+
+static void FontIndex_Scan( void )
+{
+	CUtlVector<char> roots;
+
+	FontIndex_Clear();
+	FontIndex_GetRoots( roots );
+
+	for( const char *root = roots.Base(); root < roots.Base() + roots.Count(); root += strlen( root ) + 1 )
+	{
+		if( FontIndex_DirTime( root ))
+		{
+			FontIndex_ScanDir( root, 0 );
+		}
+		else
+		{
+			fontindexdir_t d;
+			d.path = FontIndex_AddString( root );
+			d.mtime = 0;
+			s_Dirs.AddToTail( d );
+		}
+	}
+}
+
+static void FontIndex_Save( void )
+{
+	CUtlVector<char> text;
+	char line[8192];
+	int i, len;
+
+	len = V_snprintf( line, sizeof( line ), "fontindex\t%i\n", FONT_INDEX_VERSION );
+	memcpy( &text[text.AddMultipleToTail( len )], line, len );
+
+	for( i = 0; i < s_Dirs.Count(); i++ )
+	{
+		len = V_snprintf( line, sizeof( line ), "dir\t%lld\t%s\n", (long long)s_Dirs[i].mtime, FontIndex_String( s_Dirs[i].path ));
+		memcpy( &text[text.AddMultipleToTail( len )], line, len );
+	}
+
+	for( i = 0; i < s_Entries.Count(); i++ )
+	{
+		const fontindexentry_t &e = s_Entries[i];
+
+		len = V_snprintf( line, sizeof( line ), "font\t%i\t%i\t%s\t%s\n", e.weight, e.italic ? 1 : 0, FontIndex_String( e.family ), FontIndex_String( e.path ));
+		memcpy( &text[text.AddMultipleToTail( len )], line, len );
+	}
+
+	EngFuncs::COM_SaveFile( FONT_INDEX_FILE, text.Base(), text.Count() );
+}
+
+#endif // FONTINDEX_SCAN
+
+/*
+=========================
+FontIndex_Load
+
+Text file, one record per line, fields are separated by tabs
+=========================
+*/
+static bool FontIndex_Load( void )
+{
+	CUtlVector<char> text;
+	int size;
+	byte *data;
+
+	if( !EngFuncs::FileExists( FONT_INDEX_FILE ))
+		return false;
+
+	if( !( data = EngFuncs::COM_LoadFile( FONT_INDEX_FILE, &size )))
+		return false;
+
+	text.SetCount( size + 1 );
+	memcpy( text.Base(), data, size );
+	text[size] = 0;
+	EngFuncs::COM_FreeFile( data );
+
+	FontIndex_Clear();
+
+	char *line = text.Base();
+	bool header = false;
+
+	while( *line )
+	{
+		char *next = strchr( line, '\n' );
+		char *field[5];
+		int fields = 0;
+
+		if( next )
+			*next++ = 0;
+		else
+			next = line + strlen( line );
+
+		for( char *p = line; fields < 5; )
+		{
+			field[fields++] = p;
+
+			if( !( p = strchr( p, '\t' )))
+				break;
+
+			*p++ = 0;
+		}
+
+		if( !header )
+		{
+			if( fields != 2 || strcmp( field[0], "fontindex" ) || atoi( field[1] ) != FONT_INDEX_VERSION )
+				return false;
+
+			header = true;
+		}
+		else if( fields == 3 && !strcmp( field[0], "dir" ))
+		{
+			fontindexdir_t d;
+			d.mtime = strtoll( field[1], NULL, 10 );
+			d.path = FontIndex_AddString( field[2] );
+			s_Dirs.AddToTail( d );
+		}
+		else if( fields == 5 && !strcmp( field[0], "font" ))
+		{
+			fontindexentry_t e;
+			e.weight = atoi( field[1] );
+			e.italic = atoi( field[2] ) != 0;
+			e.family = FontIndex_AddString( field[3] );
+			e.path = FontIndex_AddString( field[4] );
+			s_Entries.AddToTail( e );
+		}
+
+		line = next;
+	}
+
+	return header;
+}
+
+void FontIndex_Init( void )
+{
+	if( s_bInitialized )
+		return;
+
+	s_bInitialized = true;
+
+#if defined(FONTINDEX_SCAN)
+	if( FontIndex_Load() && FontIndex_IsValid() )
+	{
+		Con_DPrintf( "FontIndex_Init: %i fonts from %s\n", s_Entries.Count(), FONT_INDEX_FILE );
+		return;
+	}
+
+	double start = EngFuncs::DoubleTime();
+
+	FontIndex_Scan();
+	FontIndex_Save();
+
+	Con_DPrintf( "FontIndex_Init: indexed %i fonts in %i directories, took %f seconds\n",
+		s_Entries.Count(), s_Dirs.Count(), EngFuncs::DoubleTime() - start );
+#endif
+}
+
+static int FontIndex_FindFamily( const char *family, int weight, bool italic )
+{
+	int best = -1, bestScore = 0;
+
+	for( int i = 0; i < s_Entries.Count(); i++ )
+	{
+		const fontindexentry_t &e = s_Entries[i];
+
+		if( family && !FontIndex_FamilyEqual( FontIndex_String( e.family ), family ))
+			continue;
+
+		// slant matters more than weight, like in fontconfig
+		int score = abs( e.weight - weight ) + ( e.italic != italic ? 1000 : 0 );
+
+		if( best < 0 || score < bestScore )
+		{
+			best = i;
+			bestScore = score;
+		}
+	}
+
+	return best;
+}
+
+bool FontIndex_HasFamily( const char *family )
+{
+	return FontIndex_FindFamily( family, 400, false ) >= 0;
+}
+
+bool FontIndex_Find( const char *family, int weight, bool italic, char *path, int pathChars )
+{
+	// menu uses windows-like weights, where everything above 500 is bold
+	const int target = weight > 500 ? 700 : 400;
+	int i, best = -1;
+
+	if( family && family[0] )
+		best = FontIndex_FindFamily( family, target, italic );
+
+	for( i = 0; best < 0 && i < (int)V_ARRAYSIZE( s_DefaultFamilies ); i++ )
+		best = FontIndex_FindFamily( s_DefaultFamilies[i], target, italic );
+
+	if( best < 0 )
+		best = FontIndex_FindFamily( NULL, target, italic );
+
+	if( best < 0 )
+		return false;
+
+	Q_strncpy( path, FontIndex_String( s_Entries[best].path ), pathChars );
+	return true;
+}
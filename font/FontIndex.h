@@ -0,0 +1,38 @@
+/*
+FontIndex.h - system font index, family and style to file path
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef FONTINDEX_H
+#define FONTINDEX_H
+
+// bump when index format or scanning rules change
+#define FONT_INDEX_VERSION 1
+#define FONT_INDEX_FILE    ".fontcache/fontindex.txt"
+
+/*
+ * Load index from disk, rescan font directories if any of them was changed.
+ * Uses engine file functions, so it's called on main thread before fonts are created
+ **/
+void FontIndex_Init( void );
+
+/*
+ * Find font file closest to requested style, default sans family if there is no such family.
+ * Index isn't changed after FontIndex_Init, so it can be called from any thread
+ **/
+bool FontIndex_Find( const char *family, int weight, bool italic, char *path, int pathChars );
+
+// family is installed, FontIndex_Find won't substitute it
+bool FontIndex_HasFamily( const char *family );
+
+#endif // FONTINDEX_H
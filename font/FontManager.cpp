@@ -18,6 +18,13 @@ GNU General Public License for more details.
 #include "Utils.h"
 
 #include "BaseFontBackend.h"
+#include "GlyphKernels.h"
+#include "GlyphWorkers.h"
+#include "TextBatch.h"
+#include "TextLayout.h"
+#include "DistanceField.h"
+#include "FontFile.h"
+#include "FontIndex.h"
 
 #if defined(MAINUI_USE_FREETYPE)
 #include "FreeTypeFont.h"
@@ -39,19 +46,130 @@ GNU General Public License for more details.
 #define DEFAULT_WEIGHT   500
 #endif
 
+// faces with scripts missing in menu font, only families this platform has
+#if defined __ANDROID__
+static const char *s_DefaultFallbacks[] = { "DroidSans", "DroidSansFallback" };
+#define DEFAULT_FALLBACKS V_ARRAYSIZE( s_DefaultFallbacks )
+#elif defined _WIN32
+static const char *s_DefaultFallbacks[] = { "Segoe UI", "Microsoft YaHei" };
+#define DEFAULT_FALLBACKS V_ARRAYSIZE( s_DefaultFallbacks )
+#elif defined __linux__
+// first face of NotoSansCJK collections, it has all CJK scripts
+static const char *s_DefaultFallbacks[] = { "Noto Sans CJK JP", "WenQuanYi Micro Hei" };
+#define DEFAULT_FALLBACKS V_ARRAYSIZE( s_DefaultFallbacks )
+#else
+// font lookup knows only few font files, there is nothing to fall back to
+static const char *s_DefaultFallbacks[] = { NULL };
+#define DEFAULT_FALLBACKS 0
+#endif
+
 CFontManager *g_FontMgr;
 
-CFontManager::CFontManager()
+#define MIN_SHARED_PAGE_SIZE 64
+#define MAX_SHARED_PAGE_SIZE 4096
+
+// upload only latin needed for english and cyrillic needed for russian
+// other glyphs are rasterized on demand
+static charRange_t s_AtlasRanges[] =
+{
+{ 33, 126, NULL, 0 },			// ascii printable range
+{ 0, 0, table_cp1251, V_ARRAYSIZE( table_cp1251 ) }, // cp1251
+{ 0x0400, 0x045F, NULL, 0 },		// cyrillic range
+};
+
+enum
+{
+	FONTJOB_CREATE = 0, // background: open font file
+	FONTJOB_CREATED,    // main: try font cache
+	FONTJOB_RENDER,     // background: rasterize glyphs
+	FONTJOB_RENDERED,   // main: upload atlas
+	FONTJOB_FAILED      // main: keep bitmap font
+};
+
+struct fontjob_t
+{
+	CBaseFont *font;
+	HFont handle;
+	int state;
+	double startTime;
+
+	char name[32];
+	int tall, weight, flags;
+	int blur, outlineSize, scanlineOffset;
+	float brighten, scanlineScale;
+
+	char fallbacks[MAX_FONT_FALLBACKS][32];
+	int numFallbacks;
+
+	bool dynamic; // ui_font_dynamic when queued, glyphs are rasterized on demand
+};
+
+static void AddFallbackFaces( CBaseFont *font, const char *const *names, int count );
+
+static void UI_FontBench_f( void )
+{
+	int iterations = 1000;
+
+	if( EngFuncs::CmdArgc() > 1 )
+		iterations = Q_max( 1, atoi( EngFuncs::CmdArgv( 1 )));
+
+	g_FontMgr->BenchmarkLookups( iterations );
+}
+
+static void UI_GlyphKernelsTest_f( void )
+{
+	int iterations = 10000;
+
+	if( EngFuncs::CmdArgc() > 1 )
+		iterations = Q_max( 1, atoi( EngFuncs::CmdArgv( 1 )));
+
+	GlyphKernels_SelfTest( iterations );
+}
+
+static void UI_TextCacheStats_f( void )
+{
+	int hits, misses, entries;
+
+	TextLayout_GetStats( hits, misses, entries );
+
+	Con_Printf( "text layout cache: %i hits, %i misses, %i/%i entries\n",
+		hits, misses, entries, TEXT_LAYOUT_SETS * TEXT_LAYOUT_WAYS );
+}
+
+CFontManager::CFontManager() : m_bBuildingSharedAtlas( false ), m_iSharedPages( 0 ), m_iFontGeneration( 0 )
 {
 #ifdef MAINUI_USE_FREETYPE
 	FT_Init_FreeType( &CFreeTypeFont::m_Library );
 #endif
 	m_Fonts.EnsureCapacity( 4 );
+
+	GlyphKernels_Init();
+	GlyphWorkers_Init();
+
+	EngFuncs::Cmd_AddCommand( "ui_fontbench", UI_FontBench_f );
+	EngFuncs::Cmd_AddCommand( "ui_glyphkernels_test", UI_GlyphKernelsTest_f );
+	EngFuncs::Cmd_AddCommand( "ui_textcache_stats", UI_TextCacheStats_f );
 }
 
 CFontManager::~CFontManager()
 {
+	EngFuncs::Cmd_RemoveCommand( "ui_fontbench" );
+	EngFuncs::Cmd_RemoveCommand( "ui_glyphkernels_test" );
+	EngFuncs::Cmd_RemoveCommand( "ui_textcache_stats" );
 	DeleteAllFonts();
+
+	for( int i = 0; i < m_SDFSources.Count(); i++ )
+		delete m_SDFSources[i];
+	m_SDFSources.RemoveAll();
+
+	// everything is released by fonts, but don't leak mappings if some font is leaked
+	for( int i = 0; i < m_FontFiles.Count(); i++ )
+	{
+		FontFile_Free( m_FontFiles[i] );
+		delete m_FontFiles[i];
+	}
+	m_FontFiles.RemoveAll();
+
 #ifdef MAINUI_USE_FREETYPE
 	FT_Done_FreeType( CFreeTypeFont::m_Library );
 	CFreeTypeFont::m_Library = NULL;
@@ -64,6 +182,13 @@ void CFontManager::VidInit( void )
 
 	float scale = uiStatic.scaleY;
 
+	// widths and console font may change with video mode
+	TextLayout_Invalidate();
+	m_iFontGeneration++;
+
+	// font files are looked up in it, maybe from builder thread
+	FontIndex_Init();
+
 	if( !prevScale
 #ifndef SCALE_FONTS // complete disables font re-rendering
 	|| fabs( scale - prevScale ) > 0.1f
@@ -71,19 +196,28 @@ void CFontManager::VidInit( void )
 	)
 	{
 		DeleteAllFonts();
+
+		// fonts are only rendered here, atlas is built when all of them are created
+		m_bBuildingSharedAtlas = EngFuncs::GetCvarFloat( "ui_font_shared_atlas" ) && !EngFuncs::GetCvarFloat( "ui_font_dynamic" );
+
 		uiStatic.hDefaultFont = CFontBuilder( DEFAULT_MENUFONT, UI_MED_CHAR_HEIGHT * scale, DEFAULT_WEIGHT )
 			.SetHandleNum( QM_DEFAULTFONT )
+			.SetFallbacks( s_DefaultFallbacks, DEFAULT_FALLBACKS )
 			.Create();
 		uiStatic.hSmallFont   = CFontBuilder( DEFAULT_MENUFONT, UI_SMALL_CHAR_HEIGHT * scale, DEFAULT_WEIGHT )
 			.SetHandleNum( QM_SMALLFONT )
+			.SetFallbacks( s_DefaultFallbacks, DEFAULT_FALLBACKS )
 			.Create();
 		uiStatic.hBigFont     = CFontBuilder( DEFAULT_MENUFONT, UI_BIG_CHAR_HEIGHT * scale, DEFAULT_WEIGHT )
 			.SetHandleNum( QM_BIGFONT )
+			.SetFallbacks( s_DefaultFallbacks, DEFAULT_FALLBACKS )
 			.Create();
 		uiStatic.hBoldFont = CFontBuilder( DEFAULT_MENUFONT, UI_MED_CHAR_HEIGHT * scale, 1000 )
 			.SetHandleNum( QM_BOLDFONT )
+			.SetFallbacks( s_DefaultFallbacks, DEFAULT_FALLBACKS )
 			.Create();
 
+		// every fallback is one more face to open, so only base fonts have them
 		if( !uiStatic.lowmemory )
 		{
 			uiStatic.hLightBlur = CFontBuilder( DEFAULT_MENUFONT, UI_MED_CHAR_HEIGHT * scale, 1000 )
@@ -98,17 +232,137 @@ void CFontManager::VidInit( void )
 		uiStatic.hConsoleFont = CFontBuilder( DEFAULT_CONFONT, UI_CONSOLE_CHAR_HEIGHT * scale, 500 )
 			.SetOutlineSize()
 			.Create();
+
+		if( m_bBuildingSharedAtlas )
+		{
+			BuildSharedAtlas();
+			m_bBuildingSharedAtlas = false;
+		}
+
 		prevScale = scale;
 	}
 }
 
 void CFontManager::DeleteAllFonts()
 {
+	CancelFontBuilds();
+
 	for( int i = 0; i < m_Fonts.Count(); i++ )
 	{
 		delete m_Fonts[i];
 	}
 	m_Fonts.RemoveAll();
+
+	FreeSharedAtlas();
+	TextLayout_Invalidate();
+	m_iFontGeneration++;
+}
+
+/*
+=========================
+CFontManager::BuildSharedAtlas
+
+Fonts are put to pages in creation order, font is never split between pages,
+so all glyphs of a string come from one texture
+=========================
+*/
+void CFontManager::BuildSharedAtlas( void )
+{
+	CUtlVector<CSkylinePacker::rect_t> rects;
+	int first = 0, i;
+	int pageWidth, pageHeight;
+
+	for( i = 0; i < m_Fonts.Count(); i++ )
+	{
+		if( !m_Fonts[i] )
+			continue;
+
+		int count = rects.Count();
+		m_Fonts[i]->GetPendingRects( rects );
+
+		if( rects.Count() == count )
+			continue;
+
+		if( CSkylinePacker::Pack( rects.Base(), rects.Count(), MIN_SHARED_PAGE_SIZE, MAX_SHARED_PAGE_SIZE, pageWidth, pageHeight ))
+			continue;
+
+		// doesn't fit, flush everything before this font to its own page
+		if( count )
+			UploadSharedPage( first, i - 1 );
+
+		first = i;
+		rects.RemoveAll();
+		m_Fonts[i]->GetPendingRects( rects );
+	}
+
+	if( rects.Count() )
+		UploadSharedPage( first, m_Fonts.Count() - 1 );
+}
+
+void CFontManager::UploadSharedPage( int firstFont, int lastFont )
+{
+	CUtlVector<CSkylinePacker::rect_t> rects;
+	CUtlVector<int> offsets;
+	int pageWidth, pageHeight, usedBytes = 0;
+	char name[64];
+	int i;
+
+	for( i = firstFont; i <= lastFont; i++ )
+	{
+		offsets.AddToTail( rects.Count() );
+
+		if( m_Fonts[i] )
+			m_Fonts[i]->GetPendingRects( rects );
+	}
+
+	if( !CSkylinePacker::Pack( rects.Base(), rects.Count(), MIN_SHARED_PAGE_SIZE, MAX_SHARED_PAGE_SIZE, pageWidth, pageHeight ))
+	{
+		Con_Printf( "Font %s doesn't fit in %ix%i texture\n", m_Fonts[firstFont]->GetName(), MAX_SHARED_PAGE_SIZE, MAX_SHARED_PAGE_SIZE );
+		return;
+	}
+
+	// luminance-alpha palette covers alpha-only fonts too
+	int format = FONT_ATLAS_RGBA;
+
+	for( i = firstFont; i <= lastFont; i++ )
+	{
+		if( m_Fonts[i] )
+			format = Q_max( format, m_Fonts[i]->GetAtlasFormat() );
+	}
+
+	CBMP bmp( pageWidth, pageHeight, CBaseFont::AtlasPixelSize( format ));
+	CBaseFont::SetAtlasPalette( &bmp, format );
+
+	for( i = firstFont; i <= lastFont; i++ )
+	{
+		if( m_Fonts[i] )
+			usedBytes += m_Fonts[i]->PlaceGlyphs( &rects[offsets[i - firstFont]], &bmp, format );
+	}
+
+	V_snprintf( name, sizeof( name ), "#fontatlas%i.bmp", m_iSharedPages++ );
+	HIMAGE hImage = EngFuncs::PIC_Load( name, bmp.GetBitmap(), bmp.GetBitmapHdr()->fileSize, 0 );
+
+	for( i = firstFont; i <= lastFont; i++ )
+	{
+		if( m_Fonts[i] )
+			m_Fonts[i]->SetGlyphTexture( hImage );
+	}
+
+	Con_DPrintf( "Uploaded shared font atlas %s to %i, %ix%i, %i bytes wasted\n",
+		name, hImage, pageWidth, pageHeight, bmp.GetTextureDataSize() - usedBytes );
+}
+
+void CFontManager::FreeSharedAtlas( void )
+{
+	char name[64];
+
+	for( int i = 0; i < m_iSharedPages; i++ )
+	{
+		V_snprintf( name, sizeof( name ), "#fontatlas%i.bmp", i );
+		EngFuncs::PIC_Free( name );
+	}
+
+	m_iSharedPages = 0;
 }
 
 void CFontManager::DeleteFont(HFont hFont)
@@ -116,9 +370,15 @@ void CFontManager::DeleteFont(HFont hFont)
 	CBaseFont *font = GetIFontFromHandle(hFont);
 	if( font )
 	{
+		CancelFontBuilds( hFont );
+
 		m_Fonts[hFont-1] = NULL;
 
 		delete font;
+
+		// handle may be reused by next created font
+		TextLayout_InvalidateFont( hFont );
+		m_iFontGeneration++;
 	}
 }
 
@@ -162,6 +422,40 @@ int CFontManager::GetCharacterWidthScaled(HFont font, int ch, int height)
 	;
 }
 
+int CFontManager::GetKerningScaled( HFont font, int left, int right, int height )
+{
+	CBaseFont *pFont = GetIFontFromHandle( font );
+
+	if( !pFont || !left )
+		return 0;
+
+	return pFont->GetKerning( left, right )
+#ifdef SCALE_FONTS
+		* ((float)height / (float)pFont->GetTall())
+#endif
+	;
+}
+
+/*
+=========================
+PeekCharacter
+
+Next codepoint after colorcodes, 0 at the end of line
+=========================
+*/
+static int PeekCharacter( const char *ch )
+{
+	int len;
+
+	while( IsColorString( ch ))
+		ch += 2;
+
+	if( *ch == '\n' )
+		return 0;
+
+	return Utf8_Decode( ch, len );
+}
+
 HFont CFontManager::GetFontByName(const char *name)
 {
 	for( int i = 0; i < m_Fonts.Count(); i++ )
@@ -211,9 +505,7 @@ void CFontManager::GetTextSize(HFont fontHandle, const char *text, int *wide, in
 	int _wide = 0, _tall;
 	const char *ch = text;
 	_tall = fontTall;
-	int i = 0;
-
-	EngFuncs::UtfProcessChar( 0 );
+	int i = 0, prev = 0;
 
 	while( *ch && ( size < 0 || i < size ) )
 	{
@@ -224,29 +516,35 @@ void CFontManager::GetTextSize(HFont fontHandle, const char *text, int *wide, in
 			continue;
 		}
 
-		int uch;
+		int uch, len;
+
+		uch = Utf8_Decode( ch, len );
+
+		// character is cut by size
+		if( size >= 0 && i + len > size )
+			break;
 
-		uch = EngFuncs::UtfProcessChar( (unsigned char)*ch );
 		if( uch )
 		{
 			if( uch == '\n' && *( ch + 1 ) != '\0' )
 			{
 				_tall += fontTall;
 				x = 0;
+				prev = 0;
 			}
 			else
 			{
 				int a, b, c;
 				font->GetCharABCWidths( uch, a, b, c );
-				x += a + b + c;
+				x += a + b + c + font->GetKerning( prev, uch );
 				if( x > _wide )
 					_wide = x;
+				prev = uch;
 			}
 		}
-		i++;
-		ch++;
+		i += len;
+		ch += len;
 	}
-	EngFuncs::UtfProcessChar( 0 );
 
 	if( tall ) *tall = _tall;
 	if( wide ) *wide = _wide;
@@ -269,9 +567,8 @@ int CFontManager::CutText(HFont fontHandle, const char *text, int height, int vi
 	visibleSize  = (float)visibleSize / (float)height * (float)font->GetTall();
 #endif
 
-	EngFuncs::UtfProcessChar( 0 );
-
 	int whiteSpacePos = 0;
+	int prev = 0;
 
 	// calculate full text wide
 	while( *ch )
@@ -283,7 +580,7 @@ int CFontManager::CutText(HFont fontHandle, const char *text, int height, int vi
 			continue;
 		}
 
-		int uch = EngFuncs::UtfProcessChar( (unsigned char)*ch );
+		int len, uch = Utf8_Decode( ch, len );
 		int x = 0;
 		if( uch )
 		{
@@ -295,7 +592,8 @@ int CFontManager::CutText(HFont fontHandle, const char *text, int height, int vi
 
 			int a, b, c;
 			font->GetCharABCWidths( uch, a, b, c );
-			x = a + b + c;
+			x = a + b + c + font->GetKerning( prev, uch );
+			prev = uch;
 
 			if( uch == ' ' )
 			{
@@ -306,12 +604,10 @@ int CFontManager::CutText(HFont fontHandle, const char *text, int height, int vi
 		if( !reverse && _wide + x >= visibleSize )
 			break;
 
-		ch++;
+		ch += len;
 		_wide += x;
 	}
 
-	EngFuncs::UtfProcessChar( 0 );
-
 	if( !reverse )
 	{
 		if( *ch && remaining ) *remaining = true;
@@ -342,24 +638,26 @@ int CFontManager::CutText(HFont fontHandle, const char *text, int height, int vi
 			continue;
 		}
 
-		int uch = EngFuncs::UtfProcessChar( (unsigned char)*ch );
+		int len, uch = Utf8_Decode( ch, len );
 		if( uch )
 		{
 			// we don't need check for newlines here, it's only done for oneline Field widget
-			int a, b, c;
+			int a, b, c, next = PeekCharacter( ch + len );
 			font->GetCharABCWidths( uch, a, b, c );
 			_wide -= a + b + c;
 
+			// next character loses its pair with this one
+			if( next )
+				_wide -= font->GetKerning( uch, next );
+
 			if( uch == ' ' )
 			{
 				whiteSpacePos = ch - text;
 			}
 		}
-		ch++;
+		ch += len;
 	}
 
-	EngFuncs::UtfProcessChar( 0 );
-
 	if( remaining ) *remaining = true;
 	if( wide ) *wide = _wide;
 	if( stopAtWhitespace && whiteSpacePos ) return whiteSpacePos;
@@ -401,27 +699,143 @@ int CFontManager::GetTextHeight(HFont fontHandle, const char *text, int size )
 
 int CFontManager::GetTextHeightExt( HFont fontHandle, const char *text, int height, int w, int size )
 {
+	CUtlVector<textbreak_t> lines;
 	CBaseFont *font = GetIFontFromHandle( fontHandle );
+	int i;
+
 	if( !font || !text || !text[0] || !w )
 	{
 		return 0;
 	}
 
-	const char *text2 = text;
-	int y = 0;
+	BreakLines( fontHandle, text, height, w, true, true, lines );
 
-	while( *text2 && ( size < 0 || text2 - text < size ) )
+	for( i = 0; i < lines.Count(); i++ )
 	{
-		int pos = CutText( fontHandle, text2, height, w, false, true );
-		if( pos == 0 )
+		if( size >= 0 && lines[i].start >= size )
 			break;
-
-		y += height;
-		text2 += pos;
 	}
 
-	return y;
+	return i * height;
+}
+
+/*
+=========================
+CFontManager::BreakLines
+
+Every character is visited once, except ones after last whitespace
+when line is wrapped, they are visited again as start of next line.
+Doesn't touch global decoder state, so it's reentrant
+=========================
+*/
+void CFontManager::BreakLines( HFont font, const char *text, int charH, int w, bool multiline, bool sizeLimit, CUtlVector<textbreak_t> &lines )
+{
+	int ellipsisWide = GetEllipsisWide( font );
+	bool giveup = false;
+	int i = 0;
+
+	lines.RemoveAll();
+
+	while( text[i] && !giveup )
+	{
+		textbreak_t line;
+		int j = i, end = -1;
+		int pixelWide = 0;
+		int save_pixelWide = 0;
+		int save_j = 0;
+		int prev = 0;
+		bool empty = true;
+
+		line.start = i;
+		line.ellipsis = false;
+
+		while( text[j] )
+		{
+			if( text[j] == '\n' )
+			{
+				end = j++;
+				break;
+			}
+
+			int len, uch = Utf8_Decode( text + j, len );
+
+			if( IsColorString( text + j )) // don't calc wides for colorstrings
+			{
+				j += 2;
+			}
+			else if( !uch ) // don't calc wides for invalid codepoints
+			{
+				j += len;
+			}
+			else
+			{
+				int charWide;
+
+				// does we have free space for new line?
+				if( multiline )
+				{
+					if( uch == ' ' && pixelWide < w ) // remember last whitespace
+					{
+						save_pixelWide = pixelWide;
+						save_j = j;
+					}
+				}
+				else
+				{
+					// remember last position, when we still fit
+					if( pixelWide + ellipsisWide < w && j > 0 )
+					{
+						save_pixelWide = pixelWide;
+						save_j = j;
+					}
+				}
+
+				charWide = GetCharacterWidthScaled( font, uch, charH ) + GetKerningScaled( font, prev, uch, charH );
+
+				// glyph wider than whole line is put anyway, or we never move forward
+				if( sizeLimit && pixelWide + charWide > w && !( multiline && empty ))
+				{
+					end = j;
+
+					if( multiline )
+					{
+						// try to word wrap
+						if( save_j != 0 && save_pixelWide != 0 )
+						{
+							pixelWide = save_pixelWide;
+							end = save_j;
+							j = save_j + 1; // skip whitespace
+						}
+					}
+					else
+					{
+						if( save_j != 0 && save_pixelWide != 0 )
+						{
+							pixelWide = save_pixelWide;
+							end = save_j;
+							line.ellipsis = end > i;
+						}
+
+						// we don't have free space anymore, so just stop
+						giveup = true;
+					}
+
+					break;
+				}
+
+				pixelWide += charWide;
+				prev = uch;
+				empty = false;
+				j += len;
+			}
+		}
+
+		line.end = end < 0 ? j : end;
+		line.pixelWide = pixelWide;
+		lines.AddToTail( line );
 
+		i = j;
+	}
 }
 
 int CFontManager::GetTextWideScaled(HFont font, const char *text, const int height, int size)
@@ -441,22 +855,232 @@ int CFontManager::GetTextWideScaled(HFont font, const char *text, const int heig
 
 void CFontManager::UploadTextureForFont(CBaseFont *font)
 {
-	// upload only latin needed for english and cyrillic needed for russian
-	// maybe it would be extended someday...
+	// rasterize only glyphs that are actually drawn
+	if( EngFuncs::GetCvarFloat( "ui_font_dynamic" ))
+	{
+		font->UploadGlyphsOnDemand( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges ));
+		return;
+	}
+
+	if( m_bBuildingSharedAtlas )
+		font->RenderGlyphsForRanges( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges ));
+	else
+		font->UploadGlyphsForRanges( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges ));
+}
+
+HFont CFontManager::AddFont( CBaseFont *font, HFont forceHandle )
+{
+	if( forceHandle != -1 && m_Fonts.Count() != forceHandle )
+	{
+		if( m_Fonts.IsValidIndex( forceHandle ) )
+		{
+			m_Fonts.FastRemove( forceHandle );
+			return m_Fonts.InsertBefore( forceHandle, font );
+		}
+	}
+
+	return m_Fonts.AddToTail( font ) + 1;
+}
+
+/*
+=========================
+FontBuildTask
+
+Runs on GlyphWorkers task thread, engine functions can't be used here
+=========================
+*/
+static void FontBuildTask( void *ctx )
+{
+	fontjob_t *job = (fontjob_t *)ctx;
+
+	switch( job->state )
+	{
+	case FONTJOB_CREATE:
+		if( job->font->Create( job->name, job->tall, job->weight, job->blur, job->brighten, job->outlineSize, job->scanlineOffset, job->scanlineScale, job->flags ))
+		{
+			const char *fallbacks[MAX_FONT_FALLBACKS];
+
+			for( int i = 0; i < job->numFallbacks; i++ )
+				fallbacks[i] = job->fallbacks[i];
+
+			AddFallbackFaces( job->font, fallbacks, job->numFallbacks );
+
+			// no atlas, but kerning table is still built for atlas ranges
+			if( job->dynamic )
+				job->font->UploadGlyphsOnDemand( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges ));
+
+			job->state = FONTJOB_CREATED;
+		}
+		else
+			job->state = FONTJOB_FAILED;
+		break;
+	case FONTJOB_RENDER:
+		job->font->RenderGlyphsForRanges( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges ));
+		job->state = FONTJOB_RENDERED;
+		break;
+	}
+}
+
+HFont CFontManager::QueueFontBuild( CBaseFont *font, const CFontBuilder &params )
+{
+	fontjob_t *job = new fontjob_t;
+	CBaseFont *bitmap = new CBitmapFont();
+
+	// keep requested name, so same font request gets this handle
+	bitmap->Create( params.m_szName, params.m_iTall, params.m_iWeight, params.m_iBlur, params.m_fBrighten, params.m_iOutlineSize, params.m_iScanlineOffset, params.m_fScanlineScale, params.m_iFlags );
+
+	job->font = font;
+	job->handle = AddFont( bitmap, params.m_hForceHandle );
+	job->state = FONTJOB_CREATE;
+	job->startTime = EngFuncs::DoubleTime();
+	job->dynamic = EngFuncs::GetCvarFloat( "ui_font_dynamic" ) != 0.0f;
+
+	Q_strncpy( job->name, params.m_szName, sizeof( job->name ));
+	job->tall = params.m_iTall;
+	job->weight = params.m_iWeight;
+	job->flags = params.m_iFlags;
+	job->blur = params.m_iBlur;
+	job->brighten = params.m_fBrighten;
+	job->outlineSize = params.m_iOutlineSize;
+	job->scanlineOffset = params.m_iScanlineOffset;
+	job->scanlineScale = params.m_fScanlineScale;
+
+	job->numFallbacks = params.m_iFallbacks;
+	for( int i = 0; i < params.m_iFallbacks; i++ )
+		Q_strncpy( job->fallbacks[i], params.m_szFallbacks[i], sizeof( job->fallbacks[i] ));
+
+	m_FontJobs.AddToTail( job );
+	StartFontBuild();
+
+	return job->handle;
+}
+
+/*
+=========================
+CFontManager::StartFontBuild
+
+Only one font is built at a time, so backend library is never used by two builders
+=========================
+*/
+void CFontManager::StartFontBuild( void )
+{
+	if( GlyphWorkers_TaskRunning() )
+		return;
+
+	for( int i = 0; i < m_FontJobs.Count(); i++ )
+	{
+		fontjob_t *job = m_FontJobs[i];
+
+		if( job->state != FONTJOB_CREATE && job->state != FONTJOB_RENDER )
+			continue;
+
+		// no threads, still split startup work between frames
+		if( !GlyphWorkers_StartTask( FontBuildTask, job ))
+			FontBuildTask( job );
+		return;
+	}
+}
+
+/*
+=========================
+CFontManager::FinishFontBuild
+
+Main thread part of the job, returns true when job is done
+=========================
+*/
+bool CFontManager::FinishFontBuild( fontjob_t *job )
+{
+	switch( job->state )
+	{
+	case FONTJOB_FAILED:
+		Con_DPrintf( "Unable to create font %s, keeping bitmap font\n", job->name );
+		delete job->font;
+		return true;
+	case FONTJOB_CREATED:
+		// already prepared by FontBuildTask
+		if( job->dynamic )
+			break;
+
+		if( job->font->LoadCachedGlyphs( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges )))
+			break;
+
+		job->state = FONTJOB_RENDER;
+		return false;
+	case FONTJOB_RENDERED:
+		job->font->UploadRenderedGlyphs( s_AtlasRanges, V_ARRAYSIZE( s_AtlasRanges ));
+		break;
+	default:
+		return false;
+	}
+
+	delete m_Fonts[job->handle - 1];
+	m_Fonts[job->handle - 1] = job->font;
+
+	// widths are different now
+	TextLayout_InvalidateFont( job->handle );
+	m_iFontGeneration++;
+
+	Con_DPrintf( "Rendering %s(%i, %i) took %f seconds in background\n",
+		job->name, job->tall, job->weight, EngFuncs::DoubleTime() - job->startTime );
+
+	return true;
+}
+
+bool CFontManager::UpdateFontBuilds( void )
+{
+	if( !m_FontJobs.Count() )
+		return false;
+
+	GlyphWorkers_FlushLog();
+
+	if( GlyphWorkers_TaskRunning() )
+		return false;
+
+	// one main thread step per frame, atlas upload isn't free
+	for( int i = 0; i < m_FontJobs.Count(); i++ )
+	{
+		fontjob_t *job = m_FontJobs[i];
+
+		if( job->state != FONTJOB_CREATED && job->state != FONTJOB_RENDERED && job->state != FONTJOB_FAILED )
+			continue;
+
+		if( FinishFontBuild( job ))
+		{
+			delete job;
+			m_FontJobs.Remove( i );
+
+			if( !m_FontJobs.Count() )
+				return true;
+		}
+		break;
+	}
+
+	StartFontBuild();
+	return false;
+}
+
+void CFontManager::CancelFontBuilds( HFont handle )
+{
+	GlyphWorkers_WaitTask();
+	GlyphWorkers_FlushLog();
 
-	charRange_t range[] =
+	for( int i = m_FontJobs.Count() - 1; i >= 0; i-- )
 	{
-	{ 33, 126, NULL, 0 },			// ascii printable range
-	{ 0, 0, table_cp1251, V_ARRAYSIZE( table_cp1251 ) }, // cp1251
-	{ 0x0400, 0x045F, NULL, 0 },		// cyrillic range
-	};
+		fontjob_t *job = m_FontJobs[i];
+
+		if( handle != -1 && job->handle != handle )
+			continue;
 
-	font->UploadGlyphsForRanges( range, V_ARRAYSIZE( range ) );
+		delete job->font;
+		delete job;
+		m_FontJobs.Remove( i );
+	}
 }
 
-int CFontManager::DrawCharacter(HFont fontHandle, int ch, Point pt, int charH, const unsigned int color, bool forceAdditive )
+int CFontManager::DrawCharacter(HFont fontHandle, int ch, Point pt, int charH, const unsigned int color, bool forceAdditive, bool underlay )
 {
 	CBaseFont *font = GetIFontFromHandle( fontHandle );
+	int width;
 
 	if( !font )
 		return 0;
@@ -465,7 +1089,24 @@ int CFontManager::DrawCharacter(HFont fontHandle, int ch, Point pt, int charH, c
     forceAdditive = false;
 #endif
 
-	return font->DrawCharacter( ch, pt, charH, color, forceAdditive );
+	if( !underlay )
+		return font->DrawCharacter( ch, pt, charH, color, forceAdditive );
+
+	TextBatch_SetUnderlay( true );
+	width = font->DrawCharacter( ch, pt, charH, color, forceAdditive );
+	TextBatch_SetUnderlay( false );
+
+	return width;
+}
+
+void CFontManager::BeginTextBatch( void )
+{
+	TextBatch_Begin();
+}
+
+void CFontManager::EndTextBatch( void )
+{
+	TextBatch_End();
 }
 
 void CFontManager::DebugDraw(HFont fontHandle)
@@ -475,6 +1116,164 @@ void CFontManager::DebugDraw(HFont fontHandle)
 	font->DebugDraw();
 }
 
+void CFontManager::BenchmarkLookups( int iterations )
+{
+	for( int i = 0; i < m_Fonts.Count(); i++ )
+	{
+		if( m_Fonts[i] )
+			m_Fonts[i]->BenchmarkLookups( iterations );
+	}
+}
+
+
+const byte *CFontManager::AcquireFontFile( const char *path, size_t &size )
+{
+	fontfile_t *file;
+
+	for( int i = 0; i < m_FontFiles.Count(); i++ )
+	{
+		file = m_FontFiles[i];
+
+		if( !strcmp( file->path, path ))
+		{
+			file->refCount++;
+			size = file->size;
+			return file->data;
+		}
+	}
+
+	file = new fontfile_t;
+	Q_strncpy( file->path, path, sizeof( file->path ));
+
+	if( !FontFile_Load( file ))
+	{
+		delete file;
+		size = 0;
+		return NULL;
+	}
+
+	file->refCount = 1;
+	m_FontFiles.AddToTail( file );
+
+	size = file->size;
+	return file->data;
+}
+
+const fontkernpair_t *CFontManager::GetFontFileKerning( const char *path, int &count )
+{
+	for( int i = 0; i < m_FontFiles.Count(); i++ )
+	{
+		fontfile_t *file = m_FontFiles[i];
+
+		if( strcmp( file->path, path ))
+			continue;
+
+		FontFile_ParseKerning( file );
+
+		count = file->kernCount;
+		return file->kernPairs;
+	}
+
+	count = 0;
+	return NULL;
+}
+
+void CFontManager::ReleaseFontFile( const byte *data )
+{
+	for( int i = 0; i < m_FontFiles.Count(); i++ )
+	{
+		fontfile_t *file = m_FontFiles[i];
+
+		if( file->data != data )
+			continue;
+
+		if( --file->refCount <= 0 )
+		{
+			FontFile_Free( file );
+			delete file;
+			m_FontFiles.FastRemove( i );
+		}
+		return;
+	}
+}
+
+/*
+=========================
+AllocScalableFont
+
+Backend that can render any size, NULL if only bitmap font is available
+=========================
+*/
+static CBaseFont *AllocScalableFont( void )
+{
+#if defined(MAINUI_USE_FREETYPE)
+	return new CFreeTypeFont();
+#elif defined(MAINUI_USE_STB)
+	return new CStbFont();
+#elif defined(_WIN32) && defined(MAINUI_USE_CUSTOM_FONT_RENDER)
+	return new CWinAPIFont();
+#else
+	return NULL;
+#endif
+}
+
+/*
+=========================
+AddFallbackFaces
+
+Names that can't be opened are skipped, so chain may be shorter than requested
+=========================
+*/
+static void AddFallbackFaces( CBaseFont *font, const char *const *names, int count )
+{
+	for( int i = 0; i < count; i++ )
+	{
+		CBaseFont *face = AllocScalableFont();
+
+		if( !face )
+			return;
+
+#if defined(MAINUI_USE_STB) && defined(__linux__) && !defined(__ANDROID__)
+		// index gives default sans for missing family, don't open it for nothing
+		if( !FontIndex_HasFamily( names[i] ))
+		{
+			delete face;
+			continue;
+		}
+#endif
+
+		if( !font->AddFallback( face, names[i] ))
+			delete face;
+	}
+}
+
+CSDFSource *CFontManager::GetSDFSource( const char *name, int weight, int flags )
+{
+	// effects are resolved from field, only glyph shape matters
+	flags &= FONT_ITALIC;
+
+	for( int i = 0; i < m_SDFSources.Count(); i++ )
+	{
+		if( m_SDFSources[i]->IsSourceFor( name, weight, flags ))
+			return m_SDFSources[i];
+	}
+
+	CBaseFont *reference = AllocScalableFont();
+
+	if( !reference )
+		return NULL;
+
+	if( !reference->Create( name, SDF_REFERENCE_TALL, weight, 0, 0.0f, 0, 0, 0.0f, flags ))
+	{
+		delete reference;
+		return NULL;
+	}
+
+	CSDFSource *source = new CSDFSource( reference );
+	m_SDFSources.AddToTail( source );
+
+	return source;
+}
 
 HFont CFontBuilder::Create()
 {
@@ -492,20 +1291,33 @@ HFont CFontBuilder::Create()
 		}
 	}
 
-#if defined(MAINUI_USE_FREETYPE)
-	font = new CFreeTypeFont();
-#elif defined(MAINUI_USE_STB)
-	font = new CStbFont();
-#elif defined(_WIN32) && defined(MAINUI_USE_CUSTOM_FONT_RENDER)
-	font = new CWinAPIFont();
-#else
-	font = new CBitmapFont();
-#endif
+	// shared atlas needs all fonts at once, distance fields are built on main thread
+	if( EngFuncs::GetCvarFloat( "ui_font_async" ) && !g_FontMgr->m_bBuildingSharedAtlas && !EngFuncs::GetCvarFloat( "ui_font_sdf" ))
+	{
+		font = AllocScalableFont();
+
+		if( font )
+			return g_FontMgr->QueueFontBuild( font, *this );
+	}
+
+	// backend can't open fonts while another one is built in background
+	GlyphWorkers_WaitTask();
+
+	bool scalable = true;
+
+	font = AllocScalableFont();
+
+	if( !font )
+	{
+		font = new CBitmapFont();
+		scalable = false;
+	}
 
 	double starttime = EngFuncs::DoubleTime();
 
 	if( !font->Create( m_szName, m_iTall, m_iWeight, m_iBlur, m_fBrighten, m_iOutlineSize, m_iScanlineOffset, m_fScanlineScale, m_iFlags ) )
 	{
+		scalable = false;
 		delete font;
 
 		// fallback to bitmap font
@@ -519,20 +1331,18 @@ HFont CFontBuilder::Create()
 		}
 	}
 
+	if( scalable )
+		AddFallbackFaces( font, m_szFallbacks, m_iFallbacks );
+
+	// every size and effect of typeface is resolved from one set of fields
+	if( scalable && EngFuncs::GetCvarFloat( "ui_font_sdf" ))
+		font->SetSDFSource( g_FontMgr->GetSDFSource( m_szName, m_iWeight, m_iFlags ));
+
 	g_FontMgr->UploadTextureForFont( font );
 
 	double endtime = EngFuncs::DoubleTime();
 
 	Con_DPrintf( "Rendering %s(%i, %i) took %f seconds\n", font->GetName(), m_iTall, m_iWeight, endtime - starttime );
 
-	if( m_hForceHandle != -1 && g_FontMgr->m_Fonts.Count() != m_hForceHandle )
-	{
-		if( g_FontMgr->m_Fonts.IsValidIndex( m_hForceHandle ) )
-		{
-			g_FontMgr->m_Fonts.FastRemove( m_hForceHandle );
-			return g_FontMgr->m_Fonts.InsertBefore( m_hForceHandle, font );
-		}
-	}
-
-	return g_FontMgr->m_Fonts.AddToTail(font) + 1;
+	return g_FontMgr->AddFont( font, m_hForceHandle );
 }
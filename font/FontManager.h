@@ -21,6 +21,19 @@ GNU General Public License for more details.
 #include "FontRenderer.h"
 
 class CBaseFont;
+class CSDFSource;
+struct fontjob_t;
+struct fontfile_t;
+struct fontkernpair_t;
+
+// line found by CFontManager::BreakLines
+struct textbreak_t
+{
+	int start;     // offset of first byte in text
+	int end;       // offset after last byte, newlines and wrapped whitespace are not included
+	int pixelWide;
+	bool ellipsis; // line was cut, "..." must be appended
+};
 
 /*
  * Font manager is used for creating and operating with fonts
@@ -33,6 +46,10 @@ public:
 
 	void VidInit();
 
+	// swap fonts built in background in, call it between frames
+	// returns true when the last one is ready, so menus can update their layout
+	bool UpdateFontBuilds( void );
+
 	void DeleteAllFonts();
 	void DeleteFont( HFont hFont );
 
@@ -43,6 +60,8 @@ public:
 	bool  GetFontUnderlined( HFont font );
 
 	int   GetCharacterWidthScaled(HFont font, int ch, int charH );
+	// pair adjustment to add before right character, 0 if left is 0
+	int   GetKerningScaled( HFont font, int left, int right, int charH );
 
 	void  GetTextSize( HFont font, const char *text, int *wide, int *tall = NULL, int size = -1 );
 
@@ -50,6 +69,15 @@ public:
 	int   GetTextHeight( HFont font, const char *text, int size = -1 );
 	int   GetTextHeightExt( HFont font, const char *text, int height, int visibleWidth, int size = -1 );
 
+	/*
+	 * Splits text to lines in one pass, word wrapping them to visibleWidth
+	 *
+	 * If multiline is not set, there is no space for next line, so line that doesn't fit
+	 * is cut with ellipsis and breaking stops. Explicit newlines always start new line
+	 * If sizeLimit is not set, lines are broken only by newlines
+	 */
+	void  BreakLines( HFont font, const char *text, int charH, int visibleWidth, bool multiline, bool sizeLimit, CUtlVector<textbreak_t> &lines );
+
 	/*
 	 * Determine how text should be cut, to fit in "visibleWidth"
 	 * NOTE: this function DOES NOT work with multi-line strings
@@ -61,19 +89,58 @@ public:
 
 	int GetTextWideScaled( HFont font, const char *text, const int height, int size = -1 );
 
-	int DrawCharacter( HFont font, int ch, Point pt, int charH, const unsigned int color, bool forceAdditive = false );
+	// underlay characters are drawn below others in current text batch, used for shadows
+	int DrawCharacter( HFont font, int ch, Point pt, int charH, const unsigned int color, bool forceAdditive = false, bool underlay = false );
+
+	// collect glyphs and draw them grouped by texture, color and blend mode
+	void BeginTextBatch( void );
+	void EndTextBatch( void );
 
 	void DebugDraw( HFont font );
+
+	/*
+	 * Font file is loaded once and shared by all sizes and effects made from it.
+	 * Fonts are never created on two threads at once, so registry isn't locked
+	 */
+	const byte *AcquireFontFile( const char *path, size_t &size );
+	void ReleaseFontFile( const byte *data );
+	// kerning pairs of acquired file in font units, parsed once for all sizes
+	const fontkernpair_t *GetFontFileKerning( const char *path, int &count );
+	void BenchmarkLookups( int iterations );
 	CBaseFont *GetIFontFromHandle( HFont font );
 
 	int GetEllipsisWide( HFont font ); // cached wide of "..."
+
+	// changes when any font behind handle is replaced or deleted, so cached widths are stale
+	inline int GetFontGeneration( void ) const { return m_iFontGeneration; }
 private:
 	int  GetCharacterWidth( HFont font, int ch );
 	int  GetTextWide( HFont font, const char *text, int size = -1 );
 
 	void UploadTextureForFont(CBaseFont *font );
+	HFont AddFont( CBaseFont *font, HFont forceHandle );
+
+	// bitmap font is used by handle until real font is built by GlyphWorkers task
+	HFont QueueFontBuild( CBaseFont *font, const CFontBuilder &params );
+	void  StartFontBuild( void );
+	bool  FinishFontBuild( fontjob_t *job );
+	void  CancelFontBuilds( HFont handle = -1 ); // -1 cancels everything
+
+	// pack glyphs of all fonts created in VidInit to shared atlas pages
+	void BuildSharedAtlas( void );
+	void UploadSharedPage( int firstFont, int lastFont );
+	void FreeSharedAtlas( void );
+
+	// distance fields of typeface, created on first use and kept until shutdown
+	CSDFSource *GetSDFSource( const char *name, int weight, int flags );
 
 	CUtlVector<CBaseFont*> m_Fonts;
+	CUtlVector<CSDFSource*> m_SDFSources;
+	CUtlVector<fontjob_t*> m_FontJobs;
+	CUtlVector<fontfile_t*> m_FontFiles;
+	bool m_bBuildingSharedAtlas;
+	int  m_iSharedPages;
+	int  m_iFontGeneration;
 
 	friend class CFontBuilder;
 };
@@ -11,6 +11,10 @@ enum EFontFlags
 	FONT_UNDERLINE = 1 << 1,
 	FONT_STRIKEOUT = 1 << 2
 };
+
+// faces asked in order for glyphs that font doesn't have
+#define MAX_FONT_FALLBACKS 4
+
 #ifndef MAINUI_SMALL_SCREEN
 #define UI_CONSOLE_CHAR_WIDTH	9
 #define UI_CONSOLE_CHAR_HEIGHT  18
@@ -68,6 +72,7 @@ public:
 		m_iFlags = FONT_NONE;
 		m_iBlur = m_iScanlineOffset = m_iOutlineSize = 0;
 		m_hForceHandle = -1;
+		m_iFallbacks = 0;
 
 		m_fScanlineScale = 0.7f;
 		m_fBrighten = 1.0f;
@@ -99,6 +104,15 @@ public:
 		return *this;
 	}
 
+	// ordered list of font names, glyphs from them are put to same atlas
+	CFontBuilder &SetFallbacks( const char *const *names, int count )
+	{
+		m_iFallbacks = count < MAX_FONT_FALLBACKS ? count : MAX_FONT_FALLBACKS;
+		for( int i = 0; i < m_iFallbacks; i++ )
+			m_szFallbacks[i] = names[i];
+		return *this;
+	}
+
 	HFont Create();
 
 private:
@@ -118,6 +132,9 @@ private:
 	int m_iScanlineOffset;
 	float m_fScanlineScale;
 	HFont m_hForceHandle;
+
+	const char *m_szFallbacks[MAX_FONT_FALLBACKS];
+	int m_iFallbacks;
 	friend class CFontManager;
 };
 
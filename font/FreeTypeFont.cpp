@@ -19,6 +19,7 @@ GNU General Public License for more details.
 #include "FontManager.h"
 #include "FreeTypeFont.h"
 #include "Utils.h"
+#include "GlyphKernels.h"
 
 FT_Library CFreeTypeFont::m_Library;
 
@@ -27,13 +28,19 @@ FT_Library CFreeTypeFont::m_Library;
 
 
 CFreeTypeFont::CFreeTypeFont() : CBaseFont(),
-	face(), m_szRealFontFile()
+	face(), m_pFontData( NULL ), m_iFontDataSize( 0 ),
+	m_WorkerFaces(), m_szRealFontFile()
 {
 
 }
 
 CFreeTypeFont::~CFreeTypeFont()
 {
+	if( face )
+		FT_Done_Face( face );
+
+	if( m_pFontData )
+		g_FontMgr->ReleaseFontFile( m_pFontData );
 }
 
 /**
@@ -118,7 +125,7 @@ bool CFreeTypeFont::FindFontDataFile( const char *name, int tall, int weight, in
 	}
 	else bRet = false;
 
-	Con_DPrintf( "fontconfig: %s -> %s\n", name, dataFile );
+	GlyphWorkers_DPrintf( "fontconfig: %s -> %s\n", name, dataFile );
 
 	FcPatternDestroy( pattern );
 	return bRet;
@@ -142,13 +149,23 @@ bool CFreeTypeFont::Create(const char *name, int tall, int weight, int blur, flo
 
 	if( !FindFontDataFile( name, tall, weight, flags, m_szRealFontFile, sizeof( m_szRealFontFile ) ) )
 	{
-		Con_DPrintf( "Unable to find font named %s\n", name );
+		GlyphWorkers_DPrintf( "Unable to find font named %s\n", name );
 		m_szName[0] = 0;
 		return false;
 	}
 
-	if( FT_New_Face( m_Library, m_szRealFontFile, 0, &face ))
+	m_pFontData = g_FontMgr->AcquireFontFile( m_szRealFontFile, m_iFontDataSize );
+
+	if( !m_pFontData )
+	{
+		GlyphWorkers_DPrintf( "Unable to open font %s!\n", m_szRealFontFile );
+		return false;
+	}
+
+	// face has active size and glyph slot, so it's own for every font and thread
+	if( FT_New_Memory_Face( m_Library, m_pFontData, m_iFontDataSize, 0, &face ))
 	{
+		face = NULL;
 		return false;
 	}
 
@@ -160,8 +177,48 @@ bool CFreeTypeFont::Create(const char *name, int tall, int weight, int blur, flo
 	return true;
 }
 
-void CFreeTypeFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize )
+/*
+=========================
+CFreeTypeFont::PrepareWorkers
+
+FT_Face isn't thread safe, so open own face for every worker.
+FT_New_Face and FT_Done_Face touch library, so they are called only by thread
+that builds the font, CFontManager never builds two fonts at once
+=========================
+*/
+int CFreeTypeFont::PrepareWorkers( int threads )
+{
+	int i;
+
+	for( i = 1; i < threads; i++ )
+	{
+		if( FT_New_Memory_Face( m_Library, m_pFontData, m_iFontDataSize, 0, &m_WorkerFaces[i] ))
+		{
+			m_WorkerFaces[i] = NULL;
+			break;
+		}
+
+		FT_Set_Pixel_Sizes( m_WorkerFaces[i], 0, m_iTall );
+	}
+
+	return i;
+}
+
+void CFreeTypeFont::ReleaseWorkers( void )
 {
+	for( int i = 1; i < MAX_GLYPH_WORKERS; i++ )
+	{
+		if( !m_WorkerFaces[i] )
+			continue;
+
+		FT_Done_Face( m_WorkerFaces[i] );
+		m_WorkerFaces[i] = NULL;
+	}
+}
+
+void CFreeTypeFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize, int thread )
+{
+	FT_Face face = thread ? m_WorkerFaces[thread] : this->face;
 	FT_UInt idx = FT_Get_Char_Index( face, ch );
 	FT_Error error;
 	FT_GlyphSlot slot;
@@ -172,7 +229,7 @@ void CFreeTypeFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba,
 
 	if( ( error = FT_Load_Glyph( face, idx, FT_LOAD_RENDER | FT_LOAD_TARGET_NORMAL ) ) )
 	{
-		Con_DPrintf( "Error in FT_Load_Glyph: %x\n", error );
+		GlyphWorkers_DPrintf( "Error in FT_Load_Glyph: %x\n", error );
 		return;
 	}
 
@@ -209,26 +266,16 @@ void CFreeTypeFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba,
 	for (int j = ystart; j < yend; j++, dst += 4 * sz.w, buf += slot->bitmap.width )
 	{
 		uint32_t *xdst = (uint32_t*)(dst + 4 * ( m_iBlur + m_iOutlineSize ));
-		for (int i = xstart; i < xend; i++, xdst++)
-		{
-			if( buf[i] > 0 )
-			{
-				// paint white and alpha
-				*xdst = PackRGBA( 0xFF, 0xFF, 0xFF, buf[i] );
-			}
-			else
-			{
-				// paint black and null alpha
-				*xdst = 0;
-			}
-		}
+
+		// paint white and alpha, or black and null alpha
+		g_GlyphKernels.ExpandAlpha( xdst, buf + xstart, xend - xstart );
 	}
 
 	drawSize.w = xend - xstart + m_iBlur * 2 + m_iOutlineSize * 2;
 	drawSize.h = yend - ystart + m_iBlur * 2 + m_iOutlineSize * 2;
 
-	ApplyBlur( sz, rgba );
-	ApplyOutline( Point( xstart, ystart ), sz, rgba );
+	ApplyBlur( sz, rgba, thread );
+	ApplyOutline( Point( xstart, ystart ), sz, rgba, thread );
 	ApplyScanline( sz, rgba );
 	ApplyStrikeout( sz, rgba );
 }
@@ -256,4 +303,32 @@ bool CFreeTypeFont::HasChar(int ch) const
 	return FT_Get_Char_Index( face, ch ) != 0;
 }
 
+bool CFreeTypeFont::HasKerning( void ) const
+{
+	return FT_HAS_KERNING( face ) != 0;
+}
+
+int CFreeTypeFont::GetGlyphIndex( int ch ) const
+{
+	return FT_Get_Char_Index( face, ch );
+}
+
+/*
+=========================
+CFreeTypeFont::ScaleKerning
+
+Same as FT_Get_Kerning with FT_KERNING_DEFAULT
+=========================
+*/
+int CFreeTypeFont::ScaleKerning( int units ) const
+{
+	FT_Pos x = FT_MulFix( units, face->size->metrics.x_scale );
+
+	// FreeType scales kerning down on small sizes, so it isn't too big
+	if( face->size->metrics.x_ppem < 25 )
+		x = FT_MulDiv( x, face->size->metrics.x_ppem, 25 );
+
+	return PIXEL(( x + 32 ) & -64 );
+}
+
 #endif // WIN32 && MAINUI_USE_FREETYPE
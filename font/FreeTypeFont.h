@@ -42,11 +42,21 @@ public:
 		int outlineSize,
 		int scanlineOffset, float scanlineScale,
 		int flags) override;
-	void GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize) override;
+	void GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize, int thread) override;
 	void GetCharABCWidthsNoCache( int ch, int &a, int &b, int &c ) override;
 	bool HasChar( int ch ) const override;
+protected:
+	const char *GetFontFilePath( void ) const override { return m_szRealFontFile; }
+	int  PrepareWorkers( int threads ) override;
+	void ReleaseWorkers( void ) override;
+	bool HasKerning( void ) const override;
+	int  GetGlyphIndex( int ch ) const override;
+	int  ScaleKerning( int units ) const override;
 private:
 	FT_Face face;
+	const byte *m_pFontData; // shared by CFontManager, every face is created from it
+	size_t m_iFontDataSize;
+	FT_Face m_WorkerFaces[MAX_GLYPH_WORKERS]; // face can't be shared between threads, 0 is unused
 	static FT_Library m_Library;
 	char m_szRealFontFile[4096];
 	bool FindFontDataFile(const char *name, int tall, int weight, int flags, char *dataFile, int dataFileChars);
@@ -0,0 +1,373 @@
+/*
+GlyphKernels.cpp - vectorized glyph post-processing kernels
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include "BaseMenu.h"
+#include "GlyphKernels.h"
+
+// SSE2 kernels live in GlyphKernelsSSE2.cpp, which is built with SSE2
+// enabled even when the rest of library targets plain i386
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_AMD64)
+#define GLYPHKERNELS_SSE2 1
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif !defined(__x86_64__)
+#include <cpuid.h>
+#endif
+#endif
+
+// NEON kernels live in GlyphKernelsNEON.cpp, which is built with NEON
+// enabled even when the rest of library targets plain armv7
+#if defined(__arm__) || defined(__aarch64__) || defined(_M_ARM) || defined(_M_ARM64)
+#define GLYPHKERNELS_NEON 1
+#if !defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
+#define STRIKEOUT_PIXEL 0xFF7F7F7F // R, G, B = 127, A = 255 in memory order
+
+/*
+=========================
+Scalar kernels
+
+Reference implementation, SIMD versions must match them
+=========================
+*/
+static void ExpandAlpha_Scalar( uint32_t *dst, const byte *src, int count )
+{
+	for( int i = 0; i < count; i++ )
+	{
+		if( src[i] > 0 )
+		{
+			// paint white and alpha
+			dst[i] = PackRGBA( 0xFF, 0xFF, 0xFF, src[i] );
+		}
+		else
+		{
+			// paint black and null alpha
+			dst[i] = 0;
+		}
+	}
+}
+
+static void ExtractAlpha_Scalar( float *dst, const byte *rgba, int count )
+{
+	for( int i = 0; i < count; i++ )
+		dst[i] = rgba[i * 4 + 3];
+}
+
+static void BlurRow_Scalar( float *dst, const float *src, const float *kernel, int radius, int count )
+{
+	for( int x = 0; x < count; x++ )
+		dst[x] = GlyphKernels_BlurTap( src, kernel, radius, x, count );
+}
+
+static void AccumRow_Scalar( float *dst, const float *src, float weight, int count )
+{
+	for( int i = 0; i < count; i++ )
+		dst[i] += src[i] * weight;
+}
+
+static void StoreAlpha_Scalar( byte *rgba, const float *src, int count )
+{
+	for( int i = 0; i < count; i++, rgba += 4 )
+	{
+		rgba[0] = rgba[1] = rgba[2] = 255;
+		rgba[3] = Q_min( (int)(src[i] + 0.5f), 255 );
+	}
+}
+
+static void ScaleRGB_Scalar( byte *rgba, int count, float scale )
+{
+	for( int i = 0; i < count; i++, rgba += 4 )
+	{
+		rgba[0] *= scale;
+		rgba[1] *= scale;
+		rgba[2] *= scale;
+	}
+}
+
+static void FillStrikeout_Scalar( byte *rgba, int count )
+{
+	for( int i = 0; i < count; i++, rgba += 4 )
+	{
+		rgba[0] = rgba[1] = rgba[2] = 127;
+		rgba[3] = 255;
+	}
+}
+
+static void OutlineMask_Scalar( byte *dst, const byte *rgba, int count )
+{
+	for( int i = 0; i < count; i++, rgba += 4 )
+		dst[i] = ( rgba[0] && rgba[1] && rgba[3] ) ? 255 : 0;
+}
+
+const glyphkernels_t g_GlyphKernelsScalar =
+{
+	"scalar",
+	ExpandAlpha_Scalar,
+	ExtractAlpha_Scalar,
+	BlurRow_Scalar,
+	AccumRow_Scalar,
+	StoreAlpha_Scalar,
+	ScaleRGB_Scalar,
+	FillStrikeout_Scalar,
+	OutlineMask_Scalar
+};
+
+glyphkernels_t g_GlyphKernels = g_GlyphKernelsScalar;
+
+#if GLYPHKERNELS_SSE2
+static bool CPU_HasSSE2( void )
+{
+#if defined(__x86_64__) || defined(_M_X64) || defined(_M_AMD64)
+	return true; // always present on amd64
+#elif defined(_MSC_VER)
+	int regs[4];
+	__cpuid( regs, 1 );
+	return ( regs[3] & ( 1 << 26 )) != 0;
+#else
+	unsigned int eax, ebx, ecx, edx;
+	if( !__get_cpuid( 1, &eax, &ebx, &ecx, &edx ))
+		return false;
+	return ( edx & ( 1 << 26 )) != 0;
+#endif
+}
+#endif // GLYPHKERNELS_SSE2
+
+#if GLYPHKERNELS_NEON
+static bool CPU_HasNEON( void )
+{
+#if defined(__aarch64__) || defined(_M_ARM64)
+	return true; // mandatory on armv8
+#elif defined(__linux__)
+	return ( getauxval( AT_HWCAP ) & HWCAP_NEON ) != 0;
+#else
+	return true; // no way to ask, kernels exist only if toolchain can target NEON
+#endif
+}
+#endif // GLYPHKERNELS_NEON
+
+/*
+=========================
+GlyphKernels_Init
+=========================
+*/
+void GlyphKernels_Init( bool allowSimd )
+{
+	g_GlyphKernels = g_GlyphKernelsScalar;
+
+	if( allowSimd )
+	{
+#if GLYPHKERNELS_SSE2
+		if( GlyphKernels_SSE2() && CPU_HasSSE2( ))
+			g_GlyphKernels = *GlyphKernels_SSE2();
+#endif
+
+#if GLYPHKERNELS_NEON
+		if( GlyphKernels_NEON() && CPU_HasNEON( ))
+			g_GlyphKernels = *GlyphKernels_NEON();
+#endif
+	}
+
+	Con_DPrintf( "Using %s glyph kernels\n", g_GlyphKernels.name );
+}
+
+/*
+=================================================================
+
+SELF TEST
+
+=================================================================
+*/
+#define TEST_PIXELS	300	// longer than any vector loop, odd tails included
+#define TEST_MAX_RADIUS	8
+
+static unsigned int s_testSeed;
+
+static int Test_Rand( int range )
+{
+	s_testSeed = s_testSeed * 1103515245 + 12345;
+	return ( s_testSeed >> 8 ) % range;
+}
+
+static float Test_RandFloat( float range )
+{
+	return Test_Rand( 65536 ) * range / 65536.0f;
+}
+
+// glyph coverage is mostly empty or full with antialiased edges
+static byte Test_Coverage( void )
+{
+	int r = Test_Rand( 10 );
+
+	if( r < 4 ) return 0;
+	if( r < 6 ) return 255;
+	return Test_Rand( 256 );
+}
+
+// compilers may fuse scalar multiply-add, so allow rounding difference
+static bool Test_FloatsMatch( const float *a, const float *b, int count )
+{
+	for( int i = 0; i < count; i++ )
+	{
+		float diff = fabs( a[i] - b[i] );
+
+		if( diff > 1e-3f && diff > fabs( a[i] ) * 1e-5f )
+			return false;
+	}
+
+	return true;
+}
+
+static void Test_Report( const glyphkernels_t *k, const char *kernel, int count, int &failures )
+{
+	if( failures++ < 8 )
+		Con_Printf( "%s %s: mismatch with scalar, %i pixels\n", k->name, kernel, count );
+}
+
+/*
+=========================
+GlyphKernels_TestTable
+
+runs every kernel and scalar reference on same random rows, rows
+start at random offset, so unaligned loads are exercised too
+=========================
+*/
+static int GlyphKernels_TestTable( const glyphkernels_t *k, int iterations )
+{
+	const glyphkernels_t *ref = &g_GlyphKernelsScalar;
+	byte src[TEST_PIXELS * 4 + 4], dst8[2][TEST_PIXELS * 4 + 4];
+	uint32_t dst32[2][TEST_PIXELS + 1];
+	float fsrc[TEST_PIXELS + 1], fdst[2][TEST_PIXELS + 1];
+	float kernelTaps[TEST_MAX_RADIUS * 2 + 1];
+	int failures = 0;
+
+	for( int it = 0; it < iterations; it++ )
+	{
+		int count = Test_Rand( TEST_PIXELS ) + 1;
+		int ofs = Test_Rand( 4 );
+		byte *rgba = src + ofs;
+		int i;
+
+		for( i = 0; i < count * 4; i++ )
+			rgba[i] = Test_Coverage();
+
+		// coverage to RGBA
+		k->ExpandAlpha( dst32[0] + ( ofs & 1 ), rgba, count );
+		ref->ExpandAlpha( dst32[1] + ( ofs & 1 ), rgba, count );
+		if( memcmp( dst32[0] + ( ofs & 1 ), dst32[1] + ( ofs & 1 ), count * sizeof( uint32_t )))
+			Test_Report( k, "ExpandAlpha", count, failures );
+
+		k->ExtractAlpha( fdst[0], rgba, count );
+		ref->ExtractAlpha( fdst[1], rgba, count );
+		if( memcmp( fdst[0], fdst[1], count * sizeof( float )))
+			Test_Report( k, "ExtractAlpha", count, failures );
+
+		// blur, kernel pointer is centered like in ApplyBlur
+		int radius = Test_Rand( TEST_MAX_RADIUS ) + 1;
+		for( i = 0; i < radius * 2 + 1; i++ )
+			kernelTaps[i] = Test_RandFloat( 1.0f );
+		for( i = 0; i < count; i++ )
+			fsrc[i] = Test_Coverage();
+
+		k->BlurRow( fdst[0], fsrc, kernelTaps + radius, radius, count );
+		ref->BlurRow( fdst[1], fsrc, kernelTaps + radius, radius, count );
+		if( !Test_FloatsMatch( fdst[0], fdst[1], count ))
+			Test_Report( k, "BlurRow", count, failures );
+
+		float weight = Test_RandFloat( 1.0f );
+		memcpy( fdst[0], fsrc, count * sizeof( float ));
+		memcpy( fdst[1], fsrc, count * sizeof( float ));
+		k->AccumRow( fdst[0], fsrc, weight, count );
+		ref->AccumRow( fdst[1], fsrc, weight, count );
+		if( !Test_FloatsMatch( fdst[0], fdst[1], count ))
+			Test_Report( k, "AccumRow", count, failures );
+
+		// blurred alpha may overshoot 255
+		for( i = 0; i < count; i++ )
+			fsrc[i] = Test_RandFloat( 300.0f );
+
+		k->StoreAlpha( dst8[0] + ofs, fsrc, count );
+		ref->StoreAlpha( dst8[1] + ofs, fsrc, count );
+		if( memcmp( dst8[0] + ofs, dst8[1] + ofs, count * 4 ))
+			Test_Report( k, "StoreAlpha", count, failures );
+
+		float scale = Test_RandFloat( 1.0f );
+		memcpy( dst8[0] + ofs, rgba, count * 4 );
+		memcpy( dst8[1] + ofs, rgba, count * 4 );
+		k->ScaleRGB( dst8[0] + ofs, count, scale );
+		ref->ScaleRGB( dst8[1] + ofs, count, scale );
+		if( memcmp( dst8[0] + ofs, dst8[1] + ofs, count * 4 ))
+			Test_Report( k, "ScaleRGB", count, failures );
+
+		k->FillStrikeout( dst8[0] + ofs, count );
+		ref->FillStrikeout( dst8[1] + ofs, count );
+		if( memcmp( dst8[0] + ofs, dst8[1] + ofs, count * 4 ))
+			Test_Report( k, "FillStrikeout", count, failures );
+
+		k->OutlineMask( dst8[0], rgba, count );
+		ref->OutlineMask( dst8[1], rgba, count );
+		if( memcmp( dst8[0], dst8[1], count ))
+			Test_Report( k, "OutlineMask", count, failures );
+	}
+
+	return failures;
+}
+
+/*
+=========================
+GlyphKernels_SelfTest
+
+compares every SIMD kernel set this CPU can run with scalar one
+=========================
+*/
+int GlyphKernels_SelfTest( int iterations )
+{
+	const glyphkernels_t *tables[2];
+	int numTables = 0, failures = 0;
+
+#if GLYPHKERNELS_SSE2
+	if( GlyphKernels_SSE2() && CPU_HasSSE2( ))
+		tables[numTables++] = GlyphKernels_SSE2();
+#endif
+
+#if GLYPHKERNELS_NEON
+	if( GlyphKernels_NEON() && CPU_HasNEON( ))
+		tables[numTables++] = GlyphKernels_NEON();
+#endif
+
+	if( !numTables )
+	{
+		Con_Printf( "glyph kernels: no SIMD kernels on this CPU, nothing to test\n" );
+		return 0;
+	}
+
+	for( int i = 0; i < numTables; i++ )
+	{
+		int result;
+
+		s_testSeed = 1;
+		result = GlyphKernels_TestTable( tables[i], iterations );
+
+		Con_Printf( "glyph kernels: %s %s, %i iterations\n", tables[i]->name,
+			result ? "FAILED" : "match scalar", iterations );
+		failures += result;
+	}
+
+	return failures;
+}
@@ -0,0 +1,82 @@
+/*
+GlyphKernels.h - vectorized glyph post-processing kernels
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef GLYPHKERNELS_H
+#define GLYPHKERNELS_H
+
+#include <stdint.h>
+
+/*
+ * Inner loops of font atlas building.
+ * Every kernel have scalar version, which is used as reference and as fallback
+ * when CPU doesn't support SSE2 or NEON. Selected once by GlyphKernels_Init
+ **/
+struct glyphkernels_t
+{
+	const char *name;
+
+	// coverage -> white RGBA pixel, zero coverage gives fully transparent black
+	void (*ExpandAlpha)( uint32_t *dst, const byte *src, int count );
+
+	// copy alpha channel to float buffer
+	void (*ExtractAlpha)( float *dst, const byte *rgba, int count );
+
+	// horizontal convolution, kernel is centered and have radius * 2 + 1 taps,
+	// taps outside of [0;count) are skipped, last tap is unused, like in original blur
+	void (*BlurRow)( float *dst, const float *src, const float *kernel, int radius, int count );
+
+	// dst += src * weight
+	void (*AccumRow)( float *dst, const float *src, float weight, int count );
+
+	// white RGB, min( src + 0.5, 255 ) alpha
+	void (*StoreAlpha)( byte *rgba, const float *src, int count );
+
+	// multiply RGB channels, keep alpha
+	void (*ScaleRGB)( byte *rgba, int count, float scale );
+
+	// fill with grey opaque pixels
+	void (*FillStrikeout)( byte *rgba, int count );
+
+	// nonzero if R, G and A are all nonzero, the outline source mask
+	void (*OutlineMask)( byte *dst, const byte *rgba, int count );
+};
+
+extern glyphkernels_t g_GlyphKernels;
+extern const glyphkernels_t g_GlyphKernelsScalar;
+
+// GlyphKernelsSSE2.cpp and GlyphKernelsNEON.cpp, NULL if toolchain couldn't build them
+const glyphkernels_t *GlyphKernels_SSE2( void );
+const glyphkernels_t *GlyphKernels_NEON( void );
+
+// single BlurRow pixel with clipped taps, SIMD versions use it on borders
+inline float GlyphKernels_BlurTap( const float *src, const float *kernel, int radius, int x, int count )
+{
+	int minX = x - radius > 0 ? x - radius : 0;
+	int maxX = x + radius < count ? x + radius : count;
+	float accum = 0.0f;
+
+	for( int i = minX; i < maxX; i++ )
+		accum += src[i] * kernel[i - x];
+
+	return accum;
+}
+
+// detect CPU features and select best kernels
+void GlyphKernels_Init( bool allowSimd = true );
+
+// check SIMD kernels against scalar ones on random rows, returns failure count
+int GlyphKernels_SelfTest( int iterations );
+
+#endif // GLYPHKERNELS_H
@@ -0,0 +1,181 @@
+/*
+GlyphKernelsNEON.cpp - NEON glyph post-processing kernels
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include "BaseMenu.h"
+#include "GlyphKernels.h"
+
+// armv7 builds pass -mfpu=neon to this file only, CPU is checked at runtime
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+
+#define STRIKEOUT_PIXEL 0xFF7F7F7F // R, G, B = 127, A = 255 in memory order
+
+/*
+=========================
+NEON kernels
+
+Tails shorter than vector go to scalar versions
+=========================
+*/
+static void ExpandAlpha_NEON( uint32_t *dst, const byte *src, int count )
+{
+	int i = 0;
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		uint8x16x4_t px;
+
+		px.val[3] = vld1q_u8( src + i );
+		px.val[0] = px.val[1] = px.val[2] = vtstq_u8( px.val[3], px.val[3] );
+
+		vst4q_u8( (uint8_t *)( dst + i ), px );
+	}
+
+	g_GlyphKernelsScalar.ExpandAlpha( dst + i, src + i, count - i );
+}
+
+static void ExtractAlpha_NEON( float *dst, const byte *rgba, int count )
+{
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		uint32x4_t px = vld1q_u32( (const uint32_t *)( rgba + i * 4 ));
+		vst1q_f32( dst + i, vcvtq_f32_u32( vshrq_n_u32( px, 24 )));
+	}
+
+	g_GlyphKernelsScalar.ExtractAlpha( dst + i, rgba + i * 4, count - i );
+}
+
+static void BlurRow_NEON( float *dst, const float *src, const float *kernel, int radius, int count )
+{
+	int x = 0;
+
+	for( ; x < radius && x < count; x++ )
+		dst[x] = GlyphKernels_BlurTap( src, kernel, radius, x, count );
+
+	for( ; x + 4 <= count - radius; x += 4 )
+	{
+		float32x4_t accum = vdupq_n_f32( 0.0f );
+
+		for( int i = -radius; i < radius; i++ )
+			accum = vaddq_f32( accum, vmulq_n_f32( vld1q_f32( src + x + i ), kernel[i] ));
+
+		vst1q_f32( dst + x, accum );
+	}
+
+	for( ; x < count; x++ )
+		dst[x] = GlyphKernels_BlurTap( src, kernel, radius, x, count );
+}
+
+static void AccumRow_NEON( float *dst, const float *src, float weight, int count )
+{
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+		vst1q_f32( dst + i, vaddq_f32( vld1q_f32( dst + i ), vmulq_n_f32( vld1q_f32( src + i ), weight )));
+
+	g_GlyphKernelsScalar.AccumRow( dst + i, src + i, weight, count - i );
+}
+
+static void StoreAlpha_NEON( byte *rgba, const float *src, int count )
+{
+	const float32x4_t half = vdupq_n_f32( 0.5f );
+	const float32x4_t maxval = vdupq_n_f32( 255.0f );
+	const uint32x4_t white = vdupq_n_u32( 0x00FFFFFF );
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		float32x4_t v = vminq_f32( vaddq_f32( vld1q_f32( src + i ), half ), maxval );
+		uint32x4_t a = vshlq_n_u32( vcvtq_u32_f32( v ), 24 );
+
+		vst1q_u32( (uint32_t *)( rgba + i * 4 ), vorrq_u32( a, white ));
+	}
+
+	g_GlyphKernelsScalar.StoreAlpha( rgba + i * 4, src + i, count - i );
+}
+
+static void ScaleRGB_NEON( byte *rgba, int count, float scale )
+{
+	int i = 0;
+
+	for( ; i + 8 <= count; i += 8 )
+	{
+		uint8x8x4_t px = vld4_u8( rgba + i * 4 );
+
+		for( int c = 0; c < 3; c++ )
+		{
+			uint16x8_t v16 = vmovl_u8( px.val[c] );
+			uint32x4_t lo = vcvtq_u32_f32( vmulq_n_f32( vcvtq_f32_u32( vmovl_u16( vget_low_u16( v16 ))), scale ));
+			uint32x4_t hi = vcvtq_u32_f32( vmulq_n_f32( vcvtq_f32_u32( vmovl_u16( vget_high_u16( v16 ))), scale ));
+
+			px.val[c] = vqmovn_u16( vcombine_u16( vqmovn_u32( lo ), vqmovn_u32( hi )));
+		}
+
+		vst4_u8( rgba + i * 4, px );
+	}
+
+	g_GlyphKernelsScalar.ScaleRGB( rgba + i * 4, count - i, scale );
+}
+
+static void FillStrikeout_NEON( byte *rgba, int count )
+{
+	const uint32x4_t px = vdupq_n_u32( STRIKEOUT_PIXEL );
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+		vst1q_u32( (uint32_t *)( rgba + i * 4 ), px );
+
+	g_GlyphKernelsScalar.FillStrikeout( rgba + i * 4, count - i );
+}
+
+static void OutlineMask_NEON( byte *dst, const byte *rgba, int count )
+{
+	int i = 0;
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		uint8x16x4_t px = vld4q_u8( rgba + i * 4 );
+		uint8x16_t m = vandq_u8( vandq_u8( vtstq_u8( px.val[0], px.val[0] ), vtstq_u8( px.val[1], px.val[1] )), vtstq_u8( px.val[3], px.val[3] ));
+
+		vst1q_u8( dst + i, m );
+	}
+
+	g_GlyphKernelsScalar.OutlineMask( dst + i, rgba + i * 4, count - i );
+}
+
+static const glyphkernels_t s_GlyphKernelsNEON =
+{
+	"neon",
+	ExpandAlpha_NEON,
+	ExtractAlpha_NEON,
+	BlurRow_NEON,
+	AccumRow_NEON,
+	StoreAlpha_NEON,
+	ScaleRGB_NEON,
+	FillStrikeout_NEON,
+	OutlineMask_NEON
+};
+
+const glyphkernels_t *GlyphKernels_NEON( void )
+{
+	return &s_GlyphKernelsNEON;
+}
+#else
+const glyphkernels_t *GlyphKernels_NEON( void )
+{
+	return NULL;
+}
+#endif
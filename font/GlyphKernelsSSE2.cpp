@@ -0,0 +1,200 @@
+/*
+GlyphKernelsSSE2.cpp - SSE2 glyph post-processing kernels
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include "BaseMenu.h"
+#include "GlyphKernels.h"
+
+// 32-bit x86 builds pass -msse2 to this file only, CPU is checked at runtime.
+// MSVC has SSE2 intrinsics without /arch:SSE2
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || defined(_M_IX86)
+#include <emmintrin.h>
+
+#define STRIKEOUT_PIXEL 0xFF7F7F7F // R, G, B = 127, A = 255 in memory order
+
+/*
+=========================
+SSE2 kernels
+=========================
+*/
+static void ExpandAlpha_SSE2( uint32_t *dst, const byte *src, int count )
+{
+	const __m128i zero = _mm_setzero_si128();
+	int i = 0;
+
+	for( ; i + 16 <= count; i += 16 )
+	{
+		__m128i a = _mm_loadu_si128( (const __m128i *)( src + i ));
+		__m128i w = _mm_andnot_si128( _mm_cmpeq_epi8( a, zero ), _mm_set1_epi8( -1 ));
+
+		__m128i ww_lo = _mm_unpacklo_epi8( w, w );
+		__m128i ww_hi = _mm_unpackhi_epi8( w, w );
+		__m128i wa_lo = _mm_unpacklo_epi8( w, a );
+		__m128i wa_hi = _mm_unpackhi_epi8( w, a );
+
+		_mm_storeu_si128( (__m128i *)( dst + i + 0 ), _mm_unpacklo_epi16( ww_lo, wa_lo ));
+		_mm_storeu_si128( (__m128i *)( dst + i + 4 ), _mm_unpackhi_epi16( ww_lo, wa_lo ));
+		_mm_storeu_si128( (__m128i *)( dst + i + 8 ), _mm_unpacklo_epi16( ww_hi, wa_hi ));
+		_mm_storeu_si128( (__m128i *)( dst + i + 12 ), _mm_unpackhi_epi16( ww_hi, wa_hi ));
+	}
+
+	g_GlyphKernelsScalar.ExpandAlpha( dst + i, src + i, count - i );
+}
+
+static void ExtractAlpha_SSE2( float *dst, const byte *rgba, int count )
+{
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i px = _mm_loadu_si128( (const __m128i *)( rgba + i * 4 ));
+		_mm_storeu_ps( dst + i, _mm_cvtepi32_ps( _mm_srli_epi32( px, 24 )));
+	}
+
+	g_GlyphKernelsScalar.ExtractAlpha( dst + i, rgba + i * 4, count - i );
+}
+
+static void BlurRow_SSE2( float *dst, const float *src, const float *kernel, int radius, int count )
+{
+	int x = 0;
+
+	// borders are clipped, do them in scalar
+	for( ; x < radius && x < count; x++ )
+		dst[x] = GlyphKernels_BlurTap( src, kernel, radius, x, count );
+
+	// taps are summed in same order as in scalar version
+	for( ; x + 4 <= count - radius; x += 4 )
+	{
+		__m128 accum = _mm_setzero_ps();
+
+		for( int i = -radius; i < radius; i++ )
+			accum = _mm_add_ps( accum, _mm_mul_ps( _mm_loadu_ps( src + x + i ), _mm_set1_ps( kernel[i] )));
+
+		_mm_storeu_ps( dst + x, accum );
+	}
+
+	for( ; x < count; x++ )
+		dst[x] = GlyphKernels_BlurTap( src, kernel, radius, x, count );
+}
+
+static void AccumRow_SSE2( float *dst, const float *src, float weight, int count )
+{
+	const __m128 w = _mm_set1_ps( weight );
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+		_mm_storeu_ps( dst + i, _mm_add_ps( _mm_loadu_ps( dst + i ), _mm_mul_ps( _mm_loadu_ps( src + i ), w )));
+
+	g_GlyphKernelsScalar.AccumRow( dst + i, src + i, weight, count - i );
+}
+
+static void StoreAlpha_SSE2( byte *rgba, const float *src, int count )
+{
+	const __m128 half = _mm_set1_ps( 0.5f );
+	const __m128 maxval = _mm_set1_ps( 255.0f );
+	const __m128i white = _mm_set1_epi32( 0x00FFFFFF );
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 v = _mm_min_ps( _mm_add_ps( _mm_loadu_ps( src + i ), half ), maxval );
+		__m128i a = _mm_slli_epi32( _mm_cvttps_epi32( v ), 24 );
+
+		_mm_storeu_si128( (__m128i *)( rgba + i * 4 ), _mm_or_si128( a, white ));
+	}
+
+	g_GlyphKernelsScalar.StoreAlpha( rgba + i * 4, src + i, count - i );
+}
+
+static void ScaleRGB_SSE2( byte *rgba, int count, float scale )
+{
+	const __m128 s = _mm_set_ps( 1.0f, scale, scale, scale );
+	const __m128i zero = _mm_setzero_si128();
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i px = _mm_loadu_si128( (const __m128i *)( rgba + i * 4 ));
+		__m128i lo16 = _mm_unpacklo_epi8( px, zero );
+		__m128i hi16 = _mm_unpackhi_epi8( px, zero );
+
+		__m128i p0 = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( lo16, zero )), s ));
+		__m128i p1 = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( lo16, zero )), s ));
+		__m128i p2 = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpacklo_epi16( hi16, zero )), s ));
+		__m128i p3 = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( _mm_unpackhi_epi16( hi16, zero )), s ));
+
+		px = _mm_packus_epi16( _mm_packs_epi32( p0, p1 ), _mm_packs_epi32( p2, p3 ));
+		_mm_storeu_si128( (__m128i *)( rgba + i * 4 ), px );
+	}
+
+	g_GlyphKernelsScalar.ScaleRGB( rgba + i * 4, count - i, scale );
+}
+
+static void FillStrikeout_SSE2( byte *rgba, int count )
+{
+	const __m128i px = _mm_set1_epi32( (int)STRIKEOUT_PIXEL );
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+		_mm_storeu_si128( (__m128i *)( rgba + i * 4 ), px );
+
+	g_GlyphKernelsScalar.FillStrikeout( rgba + i * 4, count - i );
+}
+
+static void OutlineMask_SSE2( byte *dst, const byte *rgba, int count )
+{
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i sel = _mm_set1_epi32( 0xFF00FFFF ); // R, G and A
+	int i = 0;
+
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128i px = _mm_loadu_si128( (const __m128i *)( rgba + i * 4 ));
+
+		// 0xFF for every zero channel, then any zero channel among R, G, A makes pixel masked out
+		__m128i z = _mm_and_si128( _mm_cmpeq_epi8( px, zero ), sel );
+		__m128i m = _mm_cmpeq_epi32( z, zero );
+
+		m = _mm_packs_epi32( m, m );
+		m = _mm_packs_epi16( m, m );
+
+		int packed = _mm_cvtsi128_si32( m );
+		memcpy( dst + i, &packed, sizeof( packed ));
+	}
+
+	g_GlyphKernelsScalar.OutlineMask( dst + i, rgba + i * 4, count - i );
+}
+
+static const glyphkernels_t s_GlyphKernelsSSE2 =
+{
+	"sse2",
+	ExpandAlpha_SSE2,
+	ExtractAlpha_SSE2,
+	BlurRow_SSE2,
+	AccumRow_SSE2,
+	StoreAlpha_SSE2,
+	ScaleRGB_SSE2,
+	FillStrikeout_SSE2,
+	OutlineMask_SSE2
+};
+
+const glyphkernels_t *GlyphKernels_SSE2( void )
+{
+	return &s_GlyphKernelsSSE2;
+}
+#else
+const glyphkernels_t *GlyphKernels_SSE2( void )
+{
+	return NULL;
+}
+#endif
@@ -0,0 +1,355 @@
+/*
+GlyphWorkers.cpp - worker threads for font atlas building
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include <stdarg.h>
+#include "BaseMenu.h"
+#include "GlyphWorkers.h"
+
+// MSVC6 have no interlocked intrinsics we need, just run everything on main thread
+#if !defined(MY_COMPILER_SUCKS) && !defined(MAINUI_NO_THREADS)
+#if defined(_WIN32)
+#define GLYPHWORKERS_WIN32 1
+#include <windows.h>
+#else
+#define GLYPHWORKERS_PTHREAD 1
+#include <pthread.h>
+#include <unistd.h>
+#endif
+#endif
+
+static int s_iWorkers = 1;
+
+#define GLYPHWORKERS_LOG_SIZE 4096
+
+static char s_szLog[GLYPHWORKERS_LOG_SIZE];
+static int  s_iLogLength;
+
+struct glyphtask_t
+{
+	pfnGlyphTask task;
+	void *ctx;
+	bool started;
+	volatile long done;
+};
+
+static glyphtask_t s_Task;
+
+#if defined(GLYPHWORKERS_WIN32)
+static DWORD s_MainThread;
+static CRITICAL_SECTION s_LogLock;
+static HANDLE s_TaskHandle;
+#elif defined(GLYPHWORKERS_PTHREAD)
+static pthread_t s_MainThread;
+static pthread_mutex_t s_LogLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_t s_TaskHandle;
+#endif
+
+struct glyphbatch_t
+{
+	pfnGlyphJob job;
+	void *ctx;
+	int count;
+	volatile long next; // next job index to take
+};
+
+struct glyphworker_t
+{
+	glyphbatch_t *batch;
+	int thread;
+};
+
+static void GlyphWorkers_Loop( glyphbatch_t *batch, int thread )
+{
+	while( true )
+	{
+#if defined(GLYPHWORKERS_WIN32)
+		int index = InterlockedIncrement( &batch->next ) - 1;
+#elif defined(GLYPHWORKERS_PTHREAD)
+		int index = __sync_fetch_and_add( &batch->next, 1 );
+#else
+		int index = batch->next++;
+#endif
+		if( index >= batch->count )
+			break;
+
+		batch->job( batch->ctx, index, thread );
+	}
+}
+
+#if defined(GLYPHWORKERS_WIN32)
+static DWORD WINAPI GlyphWorkers_Thread( LPVOID arg )
+{
+	glyphworker_t *worker = (glyphworker_t *)arg;
+	GlyphWorkers_Loop( worker->batch, worker->thread );
+	return 0;
+}
+#elif defined(GLYPHWORKERS_PTHREAD)
+static void *GlyphWorkers_Thread( void *arg )
+{
+	glyphworker_t *worker = (glyphworker_t *)arg;
+	GlyphWorkers_Loop( worker->batch, worker->thread );
+	return NULL;
+}
+#endif
+
+static int GlyphWorkers_NumProcessors( void )
+{
+#if defined(GLYPHWORKERS_WIN32)
+	SYSTEM_INFO info;
+	GetSystemInfo( &info );
+	return info.dwNumberOfProcessors;
+#elif defined(GLYPHWORKERS_PTHREAD) && defined(_SC_NPROCESSORS_ONLN)
+	return sysconf( _SC_NPROCESSORS_ONLN );
+#else
+	return 1;
+#endif
+}
+
+void GlyphWorkers_Init( int threads )
+{
+	if( threads <= 0 )
+		threads = GlyphWorkers_NumProcessors();
+
+	s_iWorkers = bound( 1, threads, MAX_GLYPH_WORKERS );
+
+#if defined(GLYPHWORKERS_WIN32)
+	static bool lockInitialized = false;
+
+	if( !lockInitialized )
+	{
+		InitializeCriticalSection( &s_LogLock );
+		lockInitialized = true;
+	}
+
+	s_MainThread = GetCurrentThreadId();
+#elif defined(GLYPHWORKERS_PTHREAD)
+	s_MainThread = pthread_self();
+#endif
+
+	Con_DPrintf( "GlyphWorkers_Init: %i threads\n", s_iWorkers );
+}
+
+int GlyphWorkers_Count( void )
+{
+	return s_iWorkers;
+}
+
+/*
+=========================
+GlyphWorkers_Run
+
+Threads are started per batch, it happens only few times on VidInit, so
+keeping them sleeping all the time isn't worth it. Calling thread works too
+=========================
+*/
+void GlyphWorkers_Run( pfnGlyphJob job, void *ctx, int count, int maxThreads )
+{
+	glyphbatch_t batch;
+	glyphworker_t workers[MAX_GLYPH_WORKERS];
+	int threads = Q_min( Q_min( s_iWorkers, maxThreads ), count );
+	int started = 1;
+
+	batch.job = job;
+	batch.ctx = ctx;
+	batch.count = count;
+	batch.next = 0;
+
+#if defined(GLYPHWORKERS_WIN32)
+	HANDLE handles[MAX_GLYPH_WORKERS];
+
+	for( ; started < threads; started++ )
+	{
+		workers[started].batch = &batch;
+		workers[started].thread = started;
+
+		handles[started] = CreateThread( NULL, 0, GlyphWorkers_Thread, &workers[started], 0, NULL );
+		if( !handles[started] )
+			break;
+	}
+#elif defined(GLYPHWORKERS_PTHREAD)
+	pthread_t handles[MAX_GLYPH_WORKERS];
+
+	for( ; started < threads; started++ )
+	{
+		workers[started].batch = &batch;
+		workers[started].thread = started;
+
+		if( pthread_create( &handles[started], NULL, GlyphWorkers_Thread, &workers[started] ))
+			break;
+	}
+#endif
+
+	// failed thread creation is fine, remaining jobs are taken by someone else
+	GlyphWorkers_Loop( &batch, 0 );
+
+	for( int i = 1; i < started; i++ )
+	{
+#if defined(GLYPHWORKERS_WIN32)
+		WaitForSingleObject( handles[i], INFINITE );
+		CloseHandle( handles[i] );
+#elif defined(GLYPHWORKERS_PTHREAD)
+		pthread_join( handles[i], NULL );
+#endif
+	}
+}
+
+#if defined(GLYPHWORKERS_WIN32)
+static DWORD WINAPI GlyphWorkers_TaskThread( LPVOID arg )
+{
+	s_Task.task( s_Task.ctx );
+	InterlockedExchange( &s_Task.done, 1 );
+	return 0;
+}
+#elif defined(GLYPHWORKERS_PTHREAD)
+static void *GlyphWorkers_TaskThread( void *arg )
+{
+	s_Task.task( s_Task.ctx );
+	__sync_lock_test_and_set( &s_Task.done, 1 );
+	return NULL;
+}
+#endif
+
+bool GlyphWorkers_StartTask( pfnGlyphTask task, void *ctx )
+{
+	GlyphWorkers_WaitTask();
+
+	s_Task.task = task;
+	s_Task.ctx = ctx;
+	s_Task.done = 0;
+
+#if defined(GLYPHWORKERS_WIN32)
+	s_TaskHandle = CreateThread( NULL, 0, GlyphWorkers_TaskThread, NULL, 0, NULL );
+	s_Task.started = s_TaskHandle != NULL;
+#elif defined(GLYPHWORKERS_PTHREAD)
+	s_Task.started = !pthread_create( &s_TaskHandle, NULL, GlyphWorkers_TaskThread, NULL );
+#else
+	s_Task.started = false;
+#endif
+
+	return s_Task.started;
+}
+
+/*
+=========================
+GlyphWorkers_TaskRunning
+
+Finished task thread is joined here, so it's never left behind
+=========================
+*/
+bool GlyphWorkers_TaskRunning( void )
+{
+	if( !s_Task.started )
+		return false;
+
+#if defined(GLYPHWORKERS_WIN32)
+	if( !InterlockedCompareExchange( &s_Task.done, 0, 0 ))
+		return true;
+#elif defined(GLYPHWORKERS_PTHREAD)
+	if( !__sync_fetch_and_add( &s_Task.done, 0 ))
+		return true;
+#endif
+
+	GlyphWorkers_WaitTask();
+	return false;
+}
+
+void GlyphWorkers_WaitTask( void )
+{
+	if( !s_Task.started )
+		return;
+
+#if defined(GLYPHWORKERS_WIN32)
+	WaitForSingleObject( s_TaskHandle, INFINITE );
+	CloseHandle( s_TaskHandle );
+#elif defined(GLYPHWORKERS_PTHREAD)
+	pthread_join( s_TaskHandle, NULL );
+#endif
+
+	s_Task.started = false;
+}
+
+static bool GlyphWorkers_OnMainThread( void )
+{
+#if defined(GLYPHWORKERS_WIN32)
+	return GetCurrentThreadId() == s_MainThread;
+#elif defined(GLYPHWORKERS_PTHREAD)
+	return pthread_equal( pthread_self(), s_MainThread ) != 0;
+#else
+	return true;
+#endif
+}
+
+/*
+=========================
+GlyphWorkers_DPrintf
+
+Message that doesn't fit is dropped, it's only a developer log
+=========================
+*/
+void GlyphWorkers_DPrintf( const char *fmt, ... )
+{
+	char msg[512];
+	va_list args;
+
+	va_start( args, fmt );
+	vsnprintf( msg, sizeof( msg ), fmt, args );
+	va_end( args );
+
+	if( GlyphWorkers_OnMainThread( ))
+	{
+		Con_DPrintf( "%s", msg );
+		return;
+	}
+
+#if defined(GLYPHWORKERS_WIN32)
+	EnterCriticalSection( &s_LogLock );
+#elif defined(GLYPHWORKERS_PTHREAD)
+	pthread_mutex_lock( &s_LogLock );
+#endif
+
+	int len = strlen( msg );
+
+	if( s_iLogLength + len < GLYPHWORKERS_LOG_SIZE )
+	{
+		memcpy( &s_szLog[s_iLogLength], msg, len + 1 );
+		s_iLogLength += len;
+	}
+
+#if defined(GLYPHWORKERS_WIN32)
+	LeaveCriticalSection( &s_LogLock );
+#elif defined(GLYPHWORKERS_PTHREAD)
+	pthread_mutex_unlock( &s_LogLock );
+#endif
+}
+
+void GlyphWorkers_FlushLog( void )
+{
+#if defined(GLYPHWORKERS_WIN32)
+	EnterCriticalSection( &s_LogLock );
+#elif defined(GLYPHWORKERS_PTHREAD)
+	pthread_mutex_lock( &s_LogLock );
+#endif
+
+	if( s_iLogLength )
+	{
+		Con_DPrintf( "%s", s_szLog );
+		s_iLogLength = 0;
+	}
+
+#if defined(GLYPHWORKERS_WIN32)
+	LeaveCriticalSection( &s_LogLock );
+#elif defined(GLYPHWORKERS_PTHREAD)
+	pthread_mutex_unlock( &s_LogLock );
+#endif
+}
@@ -0,0 +1,51 @@
+/*
+GlyphWorkers.h - worker threads for font atlas building
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef GLYPHWORKERS_H
+#define GLYPHWORKERS_H
+
+// max threads, including the calling one
+#define MAX_GLYPH_WORKERS 8
+
+/*
+ * Job gets index in [0;count) and number of thread in [0;GlyphWorkers_Count()),
+ * which can be used to select per-thread scratch buffers.
+ * Jobs must not call engine functions, they are not thread safe
+ **/
+typedef void (*pfnGlyphJob)( void *ctx, int index, int thread );
+
+// 0 means use all processors, up to MAX_GLYPH_WORKERS
+void GlyphWorkers_Init( int threads = 0 );
+int  GlyphWorkers_Count( void );
+
+// run jobs on at most maxThreads threads and wait until all of them are done
+void GlyphWorkers_Run( pfnGlyphJob job, void *ctx, int count, int maxThreads = MAX_GLYPH_WORKERS );
+
+/*
+ * One background task at a time, it runs while main thread keeps drawing frames.
+ * Task can use GlyphWorkers_Run itself. Returns false if threads aren't available,
+ * then caller must do the work by itself
+ **/
+typedef void (*pfnGlyphTask)( void *ctx );
+
+bool GlyphWorkers_StartTask( pfnGlyphTask task, void *ctx );
+bool GlyphWorkers_TaskRunning( void );
+void GlyphWorkers_WaitTask( void );
+
+// engine console isn't thread safe, messages from other threads are kept until GlyphWorkers_FlushLog
+void GlyphWorkers_DPrintf( const char *fmt, ... );
+void GlyphWorkers_FlushLog( void );
+
+#endif // GLYPHWORKERS_H
@@ -0,0 +1,210 @@
+/*
+LZ4Block.cpp - LZ4 block format codec for font cache
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include <stdint.h>
+#include <string.h>
+#include "LZ4Block.h"
+
+#define LZ4_MINMATCH      4
+#define LZ4_HASH_BITS     14
+#define LZ4_MAX_OFFSET    65535
+#define LZ4_LAST_LITERALS 5  // block must end with literals
+#define LZ4_MFLIMIT       12 // last match must start before this
+
+static inline uint32_t LZ4_Read32( const unsigned char *p )
+{
+	uint32_t v;
+	memcpy( &v, p, sizeof( v ));
+	return v;
+}
+
+static inline uint32_t LZ4_Hash( uint32_t v )
+{
+	return ( v * 2654435761U ) >> ( 32 - LZ4_HASH_BITS );
+}
+
+static unsigned char *LZ4_WriteLength( unsigned char *op, int len )
+{
+	for( ; len >= 255; len -= 255 )
+		*op++ = 255;
+	*op++ = len;
+	return op;
+}
+
+static bool LZ4_ReadLength( const unsigned char *&ip, const unsigned char *iend, int &len )
+{
+	unsigned char s;
+
+	do
+	{
+		if( ip >= iend )
+			return false;
+		s = *ip++;
+		len += s;
+	} while( s == 255 );
+
+	return true;
+}
+
+int LZ4Block_Bound( int size )
+{
+	return size + size / 255 + 16;
+}
+
+int LZ4Block_Compress( const unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity )
+{
+	const unsigned char *ip = src, *anchor = src;
+	const unsigned char *iend = src + srcSize;
+	const unsigned char *mflimit = iend - LZ4_MFLIMIT;
+	const unsigned char *matchlimit = iend - LZ4_LAST_LITERALS;
+	unsigned char *op = dst, *oend = dst + dstCapacity;
+	int *table = new int[1 << LZ4_HASH_BITS];
+	int litLen;
+
+	for( int i = 0; i < ( 1 << LZ4_HASH_BITS ); i++ )
+		table[i] = -1;
+
+	while( srcSize > LZ4_MFLIMIT && ip < mflimit )
+	{
+		const uint32_t seq = LZ4_Read32( ip );
+		const uint32_t h = LZ4_Hash( seq );
+		const int pos = ip - src;
+		const int ref = table[h];
+
+		table[h] = pos;
+
+		if( ref < 0 || pos - ref > LZ4_MAX_OFFSET || LZ4_Read32( src + ref ) != seq )
+		{
+			ip++;
+			continue;
+		}
+
+		// extend match, source may overlap with it, that's fine for LZ4
+		const unsigned char *match = src + ref;
+		const unsigned char *mp = ip + LZ4_MINMATCH;
+		const unsigned char *mm = match + LZ4_MINMATCH;
+
+		while( mp < matchlimit && *mp == *mm )
+		{
+			mp++;
+			mm++;
+		}
+
+		const int matchLen = mp - ip - LZ4_MINMATCH;
+		const int offset = ip - match;
+		litLen = ip - anchor;
+
+		if( op + 1 + litLen / 255 + 1 + litLen + 2 + matchLen / 255 + 1 > oend )
+		{
+			delete[] table;
+			return 0;
+		}
+
+		unsigned char *token = op++;
+
+		*token = ( litLen >= 15 ? 15 : litLen ) << 4;
+		if( litLen >= 15 )
+			op = LZ4_WriteLength( op, litLen - 15 );
+
+		memcpy( op, anchor, litLen );
+		op += litLen;
+
+		*op++ = offset & 0xFF;
+		*op++ = offset >> 8;
+
+		*token |= matchLen >= 15 ? 15 : matchLen;
+		if( matchLen >= 15 )
+			op = LZ4_WriteLength( op, matchLen - 15 );
+
+		ip = anchor = mp;
+	}
+
+	delete[] table;
+
+	// last literals
+	litLen = iend - anchor;
+
+	if( op + 1 + litLen / 255 + 1 + litLen > oend )
+		return 0;
+
+	*op++ = ( litLen >= 15 ? 15 : litLen ) << 4;
+	if( litLen >= 15 )
+		op = LZ4_WriteLength( op, litLen - 15 );
+
+	memcpy( op, anchor, litLen );
+	op += litLen;
+
+	return op - dst;
+}
+
+int LZ4Block_Decompress( const unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity )
+{
+	const unsigned char *ip = src, *iend = src + srcSize;
+	unsigned char *op = dst, *oend = dst + dstCapacity;
+
+	while( ip < iend )
+	{
+		const int token = *ip++;
+		int litLen = token >> 4;
+
+		if( litLen == 15 && !LZ4_ReadLength( ip, iend, litLen ))
+			return -1;
+
+		if( litLen > iend - ip || litLen > oend - op )
+			return -1;
+
+		memcpy( op, ip, litLen );
+		op += litLen;
+		ip += litLen;
+
+		// last sequence has no match
+		if( ip >= iend )
+			break;
+
+		if( iend - ip < 2 )
+			return -1;
+
+		const int offset = ip[0] | ( ip[1] << 8 );
+		ip += 2;
+
+		if( !offset || offset > op - dst )
+			return -1;
+
+		int matchLen = token & 15;
+
+		if( matchLen == 15 && !LZ4_ReadLength( ip, iend, matchLen ))
+			return -1;
+
+		matchLen += LZ4_MINMATCH;
+
+		if( matchLen > oend - op )
+			return -1;
+
+		const unsigned char *match = op - offset;
+
+		if( offset >= matchLen )
+		{
+			memcpy( op, match, matchLen );
+			op += matchLen;
+		}
+		else
+		{
+			// overlapping, copy byte by byte to repeat the pattern
+			while( matchLen-- )
+				*op++ = *match++;
+		}
+	}
+
+	return op - dst;
+}
@@ -0,0 +1,33 @@
+/*
+LZ4Block.h - LZ4 block format codec for font cache
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef LZ4BLOCK_H
+#define LZ4BLOCK_H
+
+/*
+ * Minimal implementation of LZ4 block format, without frames
+ * Compressor is greedy and simple, font atlases are mostly empty anyway
+ **/
+
+// max compressed size for given input size
+int LZ4Block_Bound( int size );
+
+// returns compressed size or 0 if it doesn't fit in dstCapacity
+int LZ4Block_Compress( const unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity );
+
+// returns decompressed size or -1 if input is malformed or doesn't fit in dstCapacity
+int LZ4Block_Decompress( const unsigned char *src, int srcSize, unsigned char *dst, int dstCapacity );
+
+#endif // LZ4BLOCK_H
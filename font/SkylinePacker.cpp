@@ -0,0 +1,249 @@
+/*
+SkylinePacker.cpp - rectangle packer for glyph atlases
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include "BaseMenu.h"
+#include "SkylinePacker.h"
+#include <stdlib.h>
+
+void CSkylinePacker::Init( int width, int height )
+{
+	node_t node;
+
+	m_iWidth = width;
+	m_iHeight = height;
+	m_iUsedArea = 0;
+
+	node.x = 0;
+	node.y = 0;
+	node.w = width;
+
+	m_Skyline.RemoveAll();
+	m_Skyline.AddToTail( node );
+}
+
+/*
+=========================
+CSkylinePacker::FitAt
+
+Returns y where rect can be placed if it's left edge at skyline node, -1 if it doesn't fit
+=========================
+*/
+int CSkylinePacker::FitAt( int index, int w, int h ) const
+{
+	int x = m_Skyline[index].x;
+	int y = 0;
+	int widthLeft = w;
+
+	if( x + w > m_iWidth )
+		return -1;
+
+	for( int i = index; widthLeft > 0; i++ )
+	{
+		if( i >= m_Skyline.Count() )
+			return -1;
+
+		y = Q_max( y, m_Skyline[i].y );
+		if( y + h > m_iHeight )
+			return -1;
+
+		widthLeft -= m_Skyline[i].w;
+	}
+
+	return y;
+}
+
+/*
+=========================
+CSkylinePacker::AddNode
+
+Raise skyline under the placed rect and merge levels with same height
+=========================
+*/
+void CSkylinePacker::AddNode( int index, int x, int y, int w, int h )
+{
+	node_t node;
+	int i;
+
+	node.x = x;
+	node.y = y + h;
+	node.w = w;
+	m_Skyline.InsertBefore( index, node );
+
+	// cut nodes shadowed by new one
+	for( i = index + 1; i < m_Skyline.Count(); )
+	{
+		node_t &prev = m_Skyline[i - 1];
+		node_t &cur = m_Skyline[i];
+
+		if( cur.x >= prev.x + prev.w )
+			break;
+
+		int shrink = prev.x + prev.w - cur.x;
+
+		cur.x += shrink;
+		cur.w -= shrink;
+
+		if( cur.w > 0 )
+			break;
+
+		m_Skyline.Remove( i );
+	}
+
+	for( i = 0; i < m_Skyline.Count() - 1; )
+	{
+		if( m_Skyline[i].y == m_Skyline[i + 1].y )
+		{
+			m_Skyline[i].w += m_Skyline[i + 1].w;
+			m_Skyline.Remove( i + 1 );
+		}
+		else i++;
+	}
+}
+
+/*
+=========================
+CSkylinePacker::Insert
+
+Bottom-left heuristic: choose position with lowest top edge, then the leftmost one
+=========================
+*/
+bool CSkylinePacker::Insert( int w, int h, int &x, int &y )
+{
+	int bestIndex = -1;
+	int bestBottom = m_iHeight + 1;
+	int bestWidth = m_iWidth + 1;
+
+	if( w <= 0 || h <= 0 )
+	{
+		x = y = 0;
+		return true;
+	}
+
+	for( int i = 0; i < m_Skyline.Count(); i++ )
+	{
+		int fitY = FitAt( i, w, h );
+
+		if( fitY < 0 )
+			continue;
+
+		if( fitY + h < bestBottom || ( fitY + h == bestBottom && m_Skyline[i].w < bestWidth ))
+		{
+			bestIndex = i;
+			bestBottom = fitY + h;
+			bestWidth = m_Skyline[i].w;
+			x = m_Skyline[i].x;
+			y = fitY;
+		}
+	}
+
+	if( bestIndex < 0 )
+		return false;
+
+	AddNode( bestIndex, x, y, w, h );
+	m_iUsedArea += w * h;
+
+	return true;
+}
+
+static int RectCompare( const void *a, const void *b )
+{
+	const CSkylinePacker::rect_t *r1 = *(const CSkylinePacker::rect_t **)a;
+	const CSkylinePacker::rect_t *r2 = *(const CSkylinePacker::rect_t **)b;
+
+	if( r1->h != r2->h )
+		return r2->h - r1->h;
+
+	if( r1->w != r2->w )
+		return r2->w - r1->w;
+
+	// keep it deterministic, qsort is not stable
+	return r1 < r2 ? -1 : ( r1 > r2 ? 1 : 0 );
+}
+
+static bool TryPage( CSkylinePacker &packer, CSkylinePacker::rect_t **sorted, int count, int width, int height )
+{
+	packer.Init( width, height );
+
+	for( int i = 0; i < count; i++ )
+	{
+		if( !packer.Insert( sorted[i]->w, sorted[i]->h, sorted[i]->x, sorted[i]->y ))
+			return false;
+	}
+
+	return true;
+}
+
+/*
+=========================
+CSkylinePacker::Pack
+
+Pages are tried in order of growing area, for same area wider pages go first
+=========================
+*/
+bool CSkylinePacker::Pack( rect_t *rects, int count, int minSize, int maxSize, int &pageWidth, int &pageHeight )
+{
+	CUtlVector<rect_t *> sorted;
+	CSkylinePacker packer;
+	int totalArea = 0;
+	int i;
+
+	sorted.SetCount( count );
+	for( i = 0; i < count; i++ )
+	{
+		sorted[i] = &rects[i];
+		totalArea += rects[i].w * rects[i].h;
+	}
+
+	qsort( sorted.Base(), count, sizeof( rect_t * ), RectCompare );
+
+	for( int area = minSize * minSize; area <= maxSize * maxSize; area *= 2 )
+	{
+		if( area < totalArea )
+			continue;
+
+		// wide pages, starting from square
+		for( int w = minSize; w <= maxSize; w *= 2 )
+		{
+			int h = area / w;
+
+			if( h > w ) continue;
+			if( h < minSize ) break;
+
+			if( TryPage( packer, sorted.Base(), count, w, h ))
+			{
+				pageWidth = w;
+				pageHeight = h;
+				return true;
+			}
+		}
+
+		// tall pages
+		for( int h = minSize; h <= maxSize; h *= 2 )
+		{
+			int w = area / h;
+
+			if( w >= h ) continue;
+			if( w < minSize ) break;
+
+			if( TryPage( packer, sorted.Base(), count, w, h ))
+			{
+				pageWidth = w;
+				pageHeight = h;
+				return true;
+			}
+		}
+	}
+
+	return false;
+}
@@ -0,0 +1,65 @@
+/*
+SkylinePacker.h - rectangle packer for glyph atlases
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef SKYLINEPACKER_H
+#define SKYLINEPACKER_H
+
+#include "utlvector.h"
+
+/*
+ * Skyline bottom-left rectangle packer
+ *
+ * Coordinates are top-down, rect is placed as high(as close to y = 0) as possible
+ **/
+class CSkylinePacker
+{
+public:
+	CSkylinePacker() : m_iWidth( 0 ), m_iHeight( 0 ), m_iUsedArea( 0 ) { }
+
+	void Init( int width, int height );
+
+	// returns false if there is no free space for rect
+	bool Insert( int w, int h, int &x, int &y );
+
+	inline int Width() const    { return m_iWidth; }
+	inline int Height() const   { return m_iHeight; }
+	inline int UsedArea() const { return m_iUsedArea; }
+
+	struct rect_t
+	{
+		int w, h;
+		int x, y; // filled by Pack
+		int id;   // user data, not touched by packer
+	};
+
+	// find smallest power of two page that fits all rects, and place them
+	// rects are placed in order of decreasing height, array order is not changed
+	static bool Pack( rect_t *rects, int count, int minSize, int maxSize, int &pageWidth, int &pageHeight );
+
+private:
+	struct node_t
+	{
+		int x, y, w;
+	};
+
+	int FitAt( int index, int w, int h ) const;
+	void AddNode( int index, int x, int y, int w, int h );
+
+	CUtlVector<node_t> m_Skyline;
+	int m_iWidth, m_iHeight;
+	int m_iUsedArea;
+};
+
+#endif // SKYLINEPACKER_H
@@ -36,6 +36,8 @@ GNU General Public License for more details.
 #endif
 
 #include "Utils.h"
+#include "GlyphKernels.h"
+#include "FontIndex.h"
 
 CStbFont::CStbFont() : CBaseFont(),
 	m_szRealFontFile(), m_pFontData( NULL )
@@ -44,7 +46,8 @@ CStbFont::CStbFont() : CBaseFont(),
 
 CStbFont::~CStbFont()
 {
-	delete [] m_pFontData;
+	if( m_pFontData )
+		g_FontMgr->ReleaseFontFile( m_pFontData );
 }
 
 bool CStbFont::FindFontDataFile(const char *name, int tall, int weight, int flags, char *dataFile, int dataFileChars)
@@ -118,45 +121,14 @@ bool CStbFont::FindFontDataFile(const char *name, int tall, int weight, int flag
 	}
 
 	return true;
-#elif defined __linux__ // call fontconfig
-	char cmd[256];
-	int len = 0;
-	FILE *fp;
-
-	len = snprintf( cmd, sizeof( cmd ) - len, "fc-match -f %%{file} \"%s\"", name );
-	if( flags & FONT_ITALIC )
-		len += snprintf( cmd + len, sizeof( cmd ) - len, ":style=Italic" );
-
-	if( weight > 500 )
-		len += snprintf( cmd + len, sizeof( cmd ) - len, ":weight=%d", weight );
-
-	cmd[len] = 0;
-
-	if( (fp = popen( cmd, "r") ) == NULL )
+#elif defined __linux__
+	if( !FontIndex_Find( name, weight, ( flags & FONT_ITALIC ) != 0, dataFile, dataFileChars ))
 	{
-		Con_DPrintf( "fontconfig: Error opening pipe!\n" );
+		GlyphWorkers_DPrintf( "fontindex: no fonts found\n" );
 		return false;
 	}
 
-	fgets( dataFile, dataFileChars, fp );
-
-	if( pclose(fp) )
-	{
-		Con_DPrintf( "fontconfig: Command not found or exited with error status\n" );
-        return false;
-    }
-
-	Con_DPrintf( "fontconfig: %s -> %s\n", name, dataFile );
-
-	// fallback with empty fontname if font not found
-	if( strlen( dataFile ) < 2 )
-	{
-		if( name[0] )
-			return FindFontDataFile( "", tall, weight, flags, dataFile, dataFileChars );
-		else
-			return false;
-	}
-
+	GlyphWorkers_DPrintf( "fontindex: %s -> %s\n", name, dataFile );
 	return true;
 #elif defined(__APPLE__)
 	const char *fontFileName, *fontFileNamePost = NULL;
@@ -251,36 +223,24 @@ bool CStbFont::Create(const char *name, int tall, int weight, int blur, float br
 
 	if( !FindFontDataFile( name, tall, weight, flags, m_szRealFontFile, 4096 ) )
 	{
-		Con_DPrintf( "Unable to find font named %s\n", name );
+		GlyphWorkers_DPrintf( "Unable to find font named %s\n", name );
 		m_szName[0] = 0;
 		return false;
 	}
 
 
-	// EngFuncs::COM_LoadFile does not allow open files from /
-	FILE *fd = fopen( m_szRealFontFile, "rb" );
-	if( !fd )
-	{
-		Con_DPrintf( "Unable to open font %s!\n", m_szRealFontFile );
-		return false;
-	}
-
-	fseek( fd, 0, SEEK_END );
-	size_t len = ftell( fd );
-	fseek( fd, 0, SEEK_SET );
+	size_t len;
+	m_pFontData = g_FontMgr->AcquireFontFile( m_szRealFontFile, len );
 
-	m_pFontData = new byte[len+1];
-	size_t red = fread( m_pFontData, 1, len, fd );
-	fclose( fd );
-	if( red != len )
+	if( !m_pFontData )
 	{
-		Con_DPrintf( "Unable to read font file %s!\n", m_szRealFontFile );
+		GlyphWorkers_DPrintf( "Unable to open font %s!\n", m_szRealFontFile );
 		return false;
 	}
 
 	if( !stbtt_InitFont( &m_fontInfo, m_pFontData, 0 ) )
 	{
-		Con_DPrintf( "Unable to create font %s!\n", m_szRealFontFile );
+		GlyphWorkers_DPrintf( "Unable to create font %s!\n", m_szRealFontFile );
 		m_szName[0] = 0;
 		return false;
 	}
@@ -299,7 +259,7 @@ bool CStbFont::Create(const char *name, int tall, int weight, int blur, float br
 	return true;
 }
 
-void CStbFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize )
+void CStbFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize, int thread )
 {
 	byte *buf, *dst;
 	int a, b, c;
@@ -337,27 +297,17 @@ void CStbFont::GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size
 	// iterate through copying the generated dib into the texture
 	for (int j = ystart; j < yend; j++, dst += 4 * sz.w, buf += bm_width )
 	{
-		unsigned int *xdst = (unsigned int*)(dst + 4 * ( m_iBlur + m_iOutlineSize ));
-		for (int i = xstart; i < xend; i++, xdst++)
-		{
-			if( buf[i] > 0 )
-			{
-				// paint white and alpha
-				*xdst = PackRGBA( 0xFF, 0xFF, 0xFF, buf[i] );
-			}
-			else
-			{
-				// paint black and null alpha
-				*xdst = 0;
-			}
-		}
+		uint32_t *xdst = (uint32_t*)(dst + 4 * ( m_iBlur + m_iOutlineSize ));
+
+		// paint white and alpha, or black and null alpha
+		g_GlyphKernels.ExpandAlpha( xdst, buf + xstart, xend - xstart );
 	}
 
 	drawSize.w = xend - xstart + m_iBlur * 2 + m_iOutlineSize * 2;
 	drawSize.h = yend - ystart + m_iBlur * 2 + m_iOutlineSize * 2;
 
-	ApplyBlur( sz, rgba );
-	ApplyOutline( Point( xstart, ystart ), sz, rgba );
+	ApplyBlur( sz, rgba, thread );
+	ApplyOutline( Point( xstart, ystart ), sz, rgba, thread );
 	ApplyScanline( sz, rgba );
 	ApplyStrikeout( sz, rgba );
 }
@@ -385,7 +335,17 @@ void CStbFont::GetCharABCWidthsNoCache(int ch, int &a, int &b, int &c)
 
 bool CStbFont::HasChar(int ch) const
 {
-	return true;
+	return stbtt_FindGlyphIndex( &m_fontInfo, ch ) != 0;
+}
+
+int CStbFont::GetGlyphIndex( int ch ) const
+{
+	return stbtt_FindGlyphIndex( &m_fontInfo, ch );
+}
+
+int CStbFont::ScaleKerning( int units ) const
+{
+	return (int)floor( units * scale + 0.5f );
 }
 
 #endif // WIN32 && MAINUI_USE_FREETYPE
@@ -33,15 +33,23 @@ public:
 		int outlineSize,
 		int scanlineOffset, float scanlineScale,
 		int flags) override;
-	void GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize) override;
+	void GetCharRGBA(int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize, int thread) override;
 	void GetCharABCWidthsNoCache( int ch, int &a, int &b, int &c ) override;
 	bool HasChar( int ch ) const override;
 
+protected:
+	const char *GetFontFilePath( void ) const override { return m_szRealFontFile; }
+	// stbtt only reads font data, so it's reentrant
+	int PrepareWorkers( int threads ) override { return threads; }
+	bool HasKerning( void ) const override { return m_fontInfo.kern != 0; }
+	int  GetGlyphIndex( int ch ) const override;
+	int  ScaleKerning( int units ) const override;
+
 private:
 	char m_szRealFontFile[4096];
 	bool FindFontDataFile(const char *name, int tall, int weight, int flags, char *dataFile, int dataFileChars);
 
-	byte *m_pFontData;
+	const byte *m_pFontData; // shared by CFontManager
 	stbtt_fontinfo m_fontInfo;
 
 	float scale;
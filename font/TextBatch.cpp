@@ -0,0 +1,192 @@
+/*
+TextBatch.cpp - glyph quad batching for text rendering
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include "BaseMenu.h"
+#include "Utils.h"
+#include "utlvector.h"
+#include "TextBatch.h"
+
+struct textquad_t
+{
+	HIMAGE texture;
+	const HIMAGE *textureRef; // read on submit if set
+	Point pt;
+	Size sz;
+	wrect_t rc;
+	unsigned int color;
+	bool additive;
+	bool underlay;
+};
+
+struct textupload_t
+{
+	pfnTextBatchUpload upload;
+	void *ctx;
+};
+
+static CUtlVector<textquad_t> s_Quads;
+static CUtlVector<textupload_t> s_Uploads;
+static int  s_iDepth;
+static bool s_bUnderlay;
+
+/*
+=========================
+TextBatch_RunUploads
+
+Bring referenced textures up to date before any quad uses them
+=========================
+*/
+static void TextBatch_RunUploads( void )
+{
+	// callbacks may reload textures, but don't request uploads again
+	for( int i = 0; i < s_Uploads.Count(); i++ )
+		s_Uploads[i].upload( s_Uploads[i].ctx );
+
+	s_Uploads.RemoveAll();
+}
+
+static void TextBatch_DrawQuad( const textquad_t &q )
+{
+	if( q.additive )
+		EngFuncs::PIC_DrawAdditive( q.pt, q.sz, &q.rc );
+	else
+		EngFuncs::PIC_DrawTrans( q.pt, q.sz, &q.rc );
+}
+
+/*
+=========================
+TextBatch_Submit
+
+Engine have no batch entry point, so replay quads one by one,
+but set texture and color only when run changes
+=========================
+*/
+static void TextBatch_Submit( bool underlay, HIMAGE &curTexture, unsigned int &curColor )
+{
+	for( int i = 0; i < s_Quads.Count(); i++ )
+	{
+		const textquad_t &q = s_Quads[i];
+		HIMAGE texture = q.textureRef ? *q.textureRef : q.texture;
+
+		if( q.underlay != underlay )
+			continue;
+
+		if( texture != curTexture || q.color != curColor )
+		{
+			int r, g, b, a;
+
+			UnpackRGBA( r, g, b, a, q.color );
+			EngFuncs::PIC_Set( texture, r, g, b, a );
+
+			curTexture = texture;
+			curColor = q.color;
+		}
+
+		TextBatch_DrawQuad( q );
+	}
+}
+
+void TextBatch_Flush( void )
+{
+	HIMAGE curTexture = 0;
+	unsigned int curColor = 0;
+
+	TextBatch_RunUploads();
+
+	if( !s_Quads.Count() )
+		return;
+
+	TextBatch_Submit( true, curTexture, curColor );
+	TextBatch_Submit( false, curTexture, curColor );
+
+	s_Quads.RemoveAll();
+}
+
+void TextBatch_Begin( void )
+{
+	s_iDepth++;
+}
+
+void TextBatch_End( void )
+{
+	if( s_iDepth <= 0 )
+		return;
+
+	if( --s_iDepth == 0 )
+	{
+		TextBatch_Flush();
+		s_bUnderlay = false;
+	}
+}
+
+void TextBatch_SetUnderlay( bool underlay )
+{
+	s_bUnderlay = underlay;
+}
+
+static void TextBatch_Add( HIMAGE texture, const HIMAGE *textureRef, Point pt, Size sz, const wrect_t &rc, unsigned int color, bool additive )
+{
+	textquad_t q;
+
+	q.texture = texture;
+	q.textureRef = textureRef;
+	q.pt = pt;
+	q.sz = sz;
+	q.rc = rc;
+	q.color = color;
+	q.additive = additive;
+	q.underlay = s_bUnderlay;
+
+	if( !s_iDepth )
+	{
+		int r, g, b, a;
+
+		if( textureRef )
+		{
+			TextBatch_RunUploads();
+			texture = *textureRef;
+		}
+
+		UnpackRGBA( r, g, b, a, color );
+		EngFuncs::PIC_Set( texture, r, g, b, a );
+		TextBatch_DrawQuad( q );
+		return;
+	}
+
+	s_Quads.AddToTail( q );
+}
+
+void TextBatch_AddQuad( HIMAGE texture, Point pt, Size sz, const wrect_t &rc, unsigned int color, bool additive )
+{
+	TextBatch_Add( texture, NULL, pt, sz, rc, color, additive );
+}
+
+void TextBatch_AddQuadRef( const HIMAGE *texture, Point pt, Size sz, const wrect_t &rc, unsigned int color, bool additive )
+{
+	TextBatch_Add( 0, texture, pt, sz, rc, color, additive );
+}
+
+void TextBatch_RequestUpload( pfnTextBatchUpload upload, void *ctx )
+{
+	for( int i = 0; i < s_Uploads.Count(); i++ )
+	{
+		if( s_Uploads[i].upload == upload && s_Uploads[i].ctx == ctx )
+			return;
+	}
+
+	textupload_t u;
+	u.upload = upload;
+	u.ctx = ctx;
+	s_Uploads.AddToTail( u );
+}
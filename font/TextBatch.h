@@ -0,0 +1,45 @@
+/*
+TextBatch.h - glyph quad batching for text rendering
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef TEXTBATCH_H
+#define TEXTBATCH_H
+
+/*
+ * Glyph quads added between TextBatch_Begin and TextBatch_End are kept
+ * and submitted at the outermost TextBatch_End, one PIC_Set per run of
+ * quads sharing texture, color and blend mode.
+ * Underlay quads (shadows) are submitted before all others, otherwise
+ * order is preserved, so overlapping glyphs look the same as unbatched.
+ * Outside of batch quads are drawn immediately
+ *
+ * Textures that are changed while text is drawn (dynamic glyph pages)
+ * are passed by pointer and read when quad is submitted. Their owner
+ * requests upload, it's done once before submitting, so texture can be
+ * changed by many glyphs but reloaded only once.
+ **/
+typedef void (*pfnTextBatchUpload)( void *ctx );
+
+void TextBatch_Begin( void );
+void TextBatch_End( void );
+void TextBatch_Flush( void );
+
+void TextBatch_SetUnderlay( bool underlay );
+void TextBatch_AddQuad( HIMAGE texture, Point pt, Size sz, const wrect_t &rc, unsigned int color, bool additive );
+void TextBatch_AddQuadRef( const HIMAGE *texture, Point pt, Size sz, const wrect_t &rc, unsigned int color, bool additive );
+
+// callback runs on next flush or unbatched quad, once per ctx
+void TextBatch_RequestUpload( pfnTextBatchUpload upload, void *ctx );
+
+#endif // TEXTBATCH_H
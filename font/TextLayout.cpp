@@ -0,0 +1,142 @@
+/*
+TextLayout.cpp - cache of laid out strings for UI_DrawString
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#include "BaseMenu.h"
+#include "TextLayout.h"
+
+static textlayout_t s_Layouts[TEXT_LAYOUT_SETS * TEXT_LAYOUT_WAYS];
+static unsigned int s_iClock;
+static int s_iHits, s_iMisses;
+
+/*
+=========================
+TextLayout_Hash
+
+FNV-1a over string and layout parameters
+=========================
+*/
+static unsigned int TextLayout_Hash( HFont font, const char *string, int len, int w, int charH, uint flags, bool multiline )
+{
+	const int params[] = { font, w, charH, (int)flags, multiline };
+	const byte *p = (const byte *)params;
+	unsigned int hash = 2166136261u;
+	int i;
+
+	for( i = 0; i < (int)sizeof( params ); i++ )
+		hash = ( hash ^ p[i] ) * 16777619u;
+
+	for( i = 0; i < len; i++ )
+		hash = ( hash ^ (byte)string[i] ) * 16777619u;
+
+	return hash;
+}
+
+static unsigned int TextLayout_Tick( void )
+{
+	// clock wrapped, forget everything instead of breaking LRU order
+	if( ++s_iClock == 0 )
+	{
+		TextLayout_Invalidate();
+		s_iClock = 1;
+	}
+
+	return s_iClock;
+}
+
+static bool TextLayout_Match( const textlayout_t &layout, unsigned int hash, HFont font, const char *string, int len, int w, int charH, uint flags, bool multiline )
+{
+	// lastUsed is zero for empty entries
+	return layout.lastUsed && layout.hash == hash && layout.font == font
+		&& layout.w == w && layout.charH == charH && layout.flags == flags
+		&& layout.multiline == multiline && layout.string.Count() == len + 1
+		&& !memcmp( layout.string.Base(), string, len );
+}
+
+textlayout_t *TextLayout_Find( HFont font, const char *string, int w, int charH, uint flags, bool multiline )
+{
+	int len = strlen( string );
+	unsigned int hash = TextLayout_Hash( font, string, len, w, charH, flags, multiline );
+	textlayout_t *set = &s_Layouts[( hash & ( TEXT_LAYOUT_SETS - 1 )) * TEXT_LAYOUT_WAYS];
+
+	for( int i = 0; i < TEXT_LAYOUT_WAYS; i++ )
+	{
+		if( TextLayout_Match( set[i], hash, font, string, len, w, charH, flags, multiline ))
+		{
+			set[i].lastUsed = TextLayout_Tick();
+			s_iHits++;
+			return &set[i];
+		}
+	}
+
+	s_iMisses++;
+	return NULL;
+}
+
+textlayout_t *TextLayout_Alloc( HFont font, const char *string, int w, int charH, uint flags, bool multiline )
+{
+	int len = strlen( string );
+	unsigned int hash = TextLayout_Hash( font, string, len, w, charH, flags, multiline );
+	textlayout_t *set = &s_Layouts[( hash & ( TEXT_LAYOUT_SETS - 1 )) * TEXT_LAYOUT_WAYS];
+	textlayout_t *layout = &set[0];
+
+	for( int i = 1; i < TEXT_LAYOUT_WAYS; i++ )
+	{
+		if( set[i].lastUsed < layout->lastUsed )
+			layout = &set[i];
+	}
+
+	layout->hash = hash;
+	layout->font = font;
+	layout->w = w;
+	layout->charH = charH;
+	layout->flags = flags;
+	layout->multiline = multiline;
+	layout->string.SetCount( len + 1 );
+	memcpy( layout->string.Base(), string, len + 1 );
+
+	layout->lines.RemoveAll();
+	layout->glyphs.RemoveAll();
+	layout->measured = false;
+	layout->lastUsed = TextLayout_Tick();
+
+	return layout;
+}
+
+void TextLayout_Invalidate( void )
+{
+	for( int i = 0; i < V_ARRAYSIZE( s_Layouts ); i++ )
+		s_Layouts[i].lastUsed = 0;
+}
+
+void TextLayout_InvalidateFont( HFont font )
+{
+	for( int i = 0; i < V_ARRAYSIZE( s_Layouts ); i++ )
+	{
+		if( s_Layouts[i].font == font )
+			s_Layouts[i].lastUsed = 0;
+	}
+}
+
+void TextLayout_GetStats( int &hits, int &misses, int &entries )
+{
+	hits = s_iHits;
+	misses = s_iMisses;
+	entries = 0;
+
+	for( int i = 0; i < V_ARRAYSIZE( s_Layouts ); i++ )
+	{
+		if( s_Layouts[i].lastUsed )
+			entries++;
+	}
+}
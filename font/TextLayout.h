@@ -0,0 +1,93 @@
+/*
+TextLayout.h - cache of laid out strings for UI_DrawString
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+#pragma once
+#ifndef TEXTLAYOUT_H
+#define TEXTLAYOUT_H
+
+#include "utlvector.h"
+
+// set associative, least recently used entry of set is replaced
+#define TEXT_LAYOUT_SETS 256
+#define TEXT_LAYOUT_WAYS 2
+
+struct textglyph_t
+{
+	int ch;      // decoded codepoint, 0 is color change
+	int color;   // color index for color changes
+	int advance; // filled when layout is drawn first time
+	int kern;    // pair kerning with previous glyph on the line
+};
+
+struct textline_t
+{
+	int pixelWide;
+	int firstGlyph;
+	int numGlyphs;
+};
+
+struct textlayout_t
+{
+	// key
+	unsigned int hash;
+	HFont font;
+	int w, charH;
+	uint flags;
+	bool multiline;
+	CUtlVector<char> string;
+
+	CUtlVector<textline_t> lines;
+	CUtlVector<textglyph_t> glyphs;
+	bool measured; // advances are known
+	unsigned int lastUsed;
+
+	void AddLine( int pixelWide )
+	{
+		textline_t line;
+
+		line.pixelWide = pixelWide;
+		line.firstGlyph = glyphs.Count();
+		line.numGlyphs = 0;
+
+		lines.AddToTail( line );
+	}
+
+	void AddGlyph( int ch, int color = 0, int kern = 0 )
+	{
+		textglyph_t glyph;
+
+		glyph.ch = ch;
+		glyph.color = color;
+		glyph.advance = 0;
+		glyph.kern = kern;
+
+		glyphs.AddToTail( glyph );
+		lines[lines.Count() - 1].numGlyphs++;
+	}
+};
+
+/*
+ * Layout depends only on font, string, box width, char height, flags
+ * and whether box is taller than one line, position and color are applied when drawing.
+ * Find counts hits and misses, on miss Alloc gives emptied entry for same key
+ **/
+textlayout_t *TextLayout_Find( HFont font, const char *string, int w, int charH, uint flags, bool multiline );
+textlayout_t *TextLayout_Alloc( HFont font, const char *string, int w, int charH, uint flags, bool multiline );
+
+void TextLayout_Invalidate( void );
+void TextLayout_InvalidateFont( HFont font );
+
+void TextLayout_GetStats( int &hits, int &misses, int &entries );
+
+#endif // TEXTLAYOUT_H
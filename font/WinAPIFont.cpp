@@ -67,7 +67,7 @@ bool CWinAPIFont::Create( const char *name, int tall, int weight, int blur, floa
 	::EnumFontFamiliesExA( m_hDC, &font, &FontEnumProc, (LPARAM)this, 0 );
 	if( !m_bFound )
 	{
-		Con_DPrintf( "Couldn't create windows font %s: no font found\n", name );
+		GlyphWorkers_DPrintf( "Couldn't create windows font %s: no font found\n", name );
 		return false;
 	}
 
@@ -80,7 +80,7 @@ bool CWinAPIFont::Create( const char *name, int tall, int weight, int blur, floa
 
 	if( !m_hFont )
 	{
-		Con_DPrintf( "Couldn't create windows font %s: CreateFont failed\n", name );
+		GlyphWorkers_DPrintf( "Couldn't create windows font %s: CreateFont failed\n", name );
 		return false;
 	}
 
@@ -92,7 +92,7 @@ bool CWinAPIFont::Create( const char *name, int tall, int weight, int blur, floa
 	::TEXTMETRIC tm = { 0 };
 	if( !GetTextMetrics( m_hDC, &tm ) )
 	{
-		Con_DPrintf( "Couldn't create windows font %s: GetTextMetrics failed\n", name );
+		GlyphWorkers_DPrintf( "Couldn't create windows font %s: GetTextMetrics failed\n", name );
 		return false;
 	}
 
@@ -117,7 +117,7 @@ bool CWinAPIFont::Create( const char *name, int tall, int weight, int blur, floa
 	return true;
 }
 
-void CWinAPIFont::GetCharRGBA( int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize )
+void CWinAPIFont::GetCharRGBA( int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize, int thread )
 {
 	// set us up to render into our dib
 	::SelectObject( m_hDC, m_hFont );
@@ -269,8 +269,8 @@ void CWinAPIFont::GetCharRGBA( int ch, Point pt, Size sz, unsigned char *rgba, S
 		drawSize.w = wide + m_iOutlineSize + m_iBlur * 2;
 		drawSize.h = tall;
 	}
-	ApplyBlur( sz, rgba );
-	ApplyOutline( Point( 0, 0 ), sz, rgba );
+	ApplyBlur( sz, rgba, thread );
+	ApplyOutline( Point( 0, 0 ), sz, rgba, thread );
 	ApplyScanline( sz, rgba );
 	ApplyStrikeout( sz, rgba );
 }
@@ -297,7 +297,19 @@ void CWinAPIFont::GetCharABCWidthsNoCache( int ch, int &a, int &b, int &c )
 
 bool CWinAPIFont::HasChar( int ch ) const
 {
-	return true;
+	WCHAR wch = ch;
+	WORD index;
+
+	// surrogate pairs can't be checked this way
+	if( ch > 0xFFFF )
+		return true;
+
+	::SelectObject( m_hDC, m_hFont );
+
+	if( ::GetGlyphIndicesW( m_hDC, &wch, 1, &index, GGI_MARK_NONEXISTING_GLYPHS ) == GDI_ERROR )
+		return true;
+
+	return index != 0xFFFF;
 }
 
 #endif // WIN32
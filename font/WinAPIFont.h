@@ -39,7 +39,7 @@ public:
 		int outlineSize,
 		int scanlineOffset, float scanlineScale,
 		int flags ) override;
-	void GetCharRGBA( int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize ) override;
+	void GetCharRGBA( int ch, Point pt, Size sz, unsigned char *rgba, Size &drawSize, int thread ) override;
 	void GetCharABCWidthsNoCache( int ch, int &a, int &b, int &c ) override;
 	bool HasChar( int ch ) const override;
 
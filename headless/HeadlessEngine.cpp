@@ -0,0 +1,1659 @@
+/*
+HeadlessEngine.cpp - stand-in engine for running menu without renderer
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <direct.h>
+#include <io.h>
+#else
+#include <dirent.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+#include "extdll_menu.h"
+#include "const.h"
+#include "cl_entity.h"
+#include "gameinfo.h"
+#include "cvardef.h"
+#include "netadr.h"
+#include "HeadlessEngine.h"
+
+#define MAX_HOST_IMAGES		1024
+#define MAX_HOST_COMMANDS	512
+#define MAX_HOST_ARGS		80
+#define MAX_HOST_TOKEN		1024
+#define MAX_HOST_CBUF		32768
+#define MAX_HOST_KEYS		256
+#define MAX_HOST_PATH		1024
+
+// console font metrics, engine uses 8x16 conchars at 640x480
+#define CON_CHAR_WIDTH		8
+#define CON_CHAR_HEIGHT		16
+
+struct hostimage_t
+{
+	char name[256];
+	int width, height;
+	bool used;
+};
+
+struct hostcmd_t
+{
+	char name[64];
+	void (*function)( void );
+};
+
+static hostparams_t	s_params;
+static char		s_basedir[MAX_HOST_PATH / 2];
+static char		s_gamedir[64];
+static ui_globalvars_t	*s_globals;
+
+static double		s_time;
+static double		s_startTime;
+
+static hostimage_t	s_images[MAX_HOST_IMAGES];
+static hostcmd_t	s_commands[MAX_HOST_COMMANDS];
+static int		s_numCommands;
+static cvar_t		*s_cvars;
+
+static int		s_argc;
+static char		s_argv[MAX_HOST_ARGS][MAX_HOST_TOKEN];
+static char		s_args[MAX_HOST_CBUF];
+static char		s_cbuf[MAX_HOST_CBUF];
+static int		s_cbufLength;
+static bool		s_quit;
+
+static char		*s_bindings[MAX_HOST_KEYS];
+static int		s_overstrike;
+
+static drawcmd_t	*s_draws;
+static int		s_numDraws;
+static int		s_maxDraws;
+static HIMAGE		s_curPic;
+static HIMAGE		s_boundPic;	// last texture used by PIC_Set or DrawCharacter
+static int		s_curColor[4];
+static int		s_textColor[4];
+static hoststats_t	s_stats;
+
+static char		**s_fileList;
+static int		s_numFileList;
+
+static GAMEINFO		s_gameInfo;
+static GAMEINFO		*s_gamesList[1];
+static cl_entity_t	s_playerModel;
+static unsigned int	s_randSeed = 0x1234;
+
+/*
+=================================================================
+
+CLOCK
+
+=================================================================
+*/
+/*
+=================
+Host_RealTime
+
+monotonic clock in seconds, used for timing frames
+and for DoubleTime, which menu uses only for measurements
+=================
+*/
+double Host_RealTime( void )
+{
+#ifdef _WIN32
+	static LARGE_INTEGER freq;
+	LARGE_INTEGER counter;
+
+	if( !freq.QuadPart )
+		QueryPerformanceFrequency( &freq );
+	QueryPerformanceCounter( &counter );
+	return (double)counter.QuadPart / (double)freq.QuadPart;
+#else
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+#endif
+}
+
+/*
+=================
+Host_AdvanceClock
+
+virtual clock ticks exactly 1/fps per frame,
+so animations are the same from run to run
+=================
+*/
+double Host_AdvanceClock( void )
+{
+	double oldtime = s_time;
+
+	if( s_params.realtime )
+		s_time = Host_RealTime() - s_startTime;
+	else s_time += 1.0 / s_params.fps;
+
+	s_globals->time = (float)s_time;
+	s_globals->frametime = (float)( s_time - oldtime );
+
+	return s_time;
+}
+
+static double Host_DoubleTime( void )
+{
+	return Host_RealTime();
+}
+
+/*
+=================================================================
+
+CONSOLE
+
+=================================================================
+*/
+static void Host_Printf( const char *fmt, ... )
+{
+	va_list args;
+
+	va_start( args, fmt );
+	vprintf( fmt, args );
+	va_end( args );
+}
+
+static void Host_DPrintf( const char *fmt, ... )
+{
+	va_list args;
+
+	if( !s_params.developer )
+		return;
+
+	va_start( args, fmt );
+	vprintf( fmt, args );
+	va_end( args );
+}
+
+static void Host_NPrintf( int pos, const char *fmt, ... )
+{
+	va_list args;
+
+	if( !s_params.developer )
+		return;
+
+	va_start( args, fmt );
+	vprintf( fmt, args );
+	va_end( args );
+}
+
+static void Host_NXPrintf( struct con_nprint_s *info, const char *fmt, ... )
+{
+	va_list args;
+
+	if( !s_params.developer )
+		return;
+
+	va_start( args, fmt );
+	vprintf( fmt, args );
+	va_end( args );
+}
+
+static void Host_HostError( const char *fmt, ... )
+{
+	va_list args;
+
+	printf( "Host_Error: " );
+	va_start( args, fmt );
+	vprintf( fmt, args );
+	va_end( args );
+	fflush( stdout );
+
+	exit( 1 );
+}
+
+/*
+=================================================================
+
+FILESYSTEM
+
+everything is rooted at basedir, gamedir is searched first
+=================================================================
+*/
+static bool Host_ValidPath( const char *path )
+{
+	if( !path || !*path )
+		return false;
+
+	if( path[0] == '/' || path[0] == '\\' || strchr( path, ':' ))
+		return false;
+
+	return strstr( path, ".." ) == NULL;
+}
+
+static bool Host_FileStat( const char *path, struct stat *st )
+{
+	return stat( path, st ) == 0 && !( st->st_mode & S_IFDIR );
+}
+
+/*
+=================
+Host_ResolvePath
+
+find file on disk, returns false if file is missing
+=================
+*/
+static bool Host_ResolvePath( const char *filename, char *out, size_t size, int gamedironly )
+{
+	struct stat st;
+
+	if( !Host_ValidPath( filename ))
+		return false;
+
+	snprintf( out, size, "%s/%s/%s", s_basedir, s_gamedir, filename );
+	if( Host_FileStat( out, &st ))
+		return true;
+
+	if( gamedironly )
+		return false;
+
+	snprintf( out, size, "%s/%s", s_basedir, filename );
+	return Host_FileStat( out, &st );
+}
+
+static void Host_CreatePath( char *path )
+{
+	for( char *p = path + 1; *p; p++ )
+	{
+		if( *p != '/' )
+			continue;
+
+		*p = 0;
+#ifdef _WIN32
+		_mkdir( path );
+#else
+		mkdir( path, 0755 );
+#endif
+		*p = '/';
+	}
+}
+
+static byte *Host_LoadFile( const char *filename, int *pLength )
+{
+	char path[MAX_HOST_PATH];
+	FILE *f;
+	long len;
+	byte *buf;
+
+	if( pLength )
+		*pLength = 0;
+
+	if( !Host_ResolvePath( filename, path, sizeof( path ), false ))
+		return NULL;
+
+	if( !( f = fopen( path, "rb" )))
+		return NULL;
+
+	fseek( f, 0, SEEK_END );
+	len = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	// always zero-terminated, menu parses text files in place
+	buf = (byte *)malloc( len + 1 );
+	if( fread( buf, 1, len, f ) != (size_t)len )
+	{
+		fclose( f );
+		free( buf );
+		return NULL;
+	}
+	fclose( f );
+	buf[len] = 0;
+
+	if( pLength )
+		*pLength = (int)len;
+
+	s_stats.numFileLoads++;
+
+	return buf;
+}
+
+static void Host_FreeFile( void *buffer )
+{
+	free( buffer );
+}
+
+static int Host_SaveFile( const char *filename, const void *data, int len )
+{
+	char path[MAX_HOST_PATH];
+	FILE *f;
+	bool ok;
+
+	if( !Host_ValidPath( filename ))
+		return FALSE;
+
+	snprintf( path, sizeof( path ), "%s/%s/%s", s_basedir, s_gamedir, filename );
+	Host_CreatePath( path );
+
+	if( !( f = fopen( path, "wb" )))
+		return FALSE;
+
+	ok = fwrite( data, 1, len, f ) == (size_t)len;
+	fclose( f );
+
+	return ok;
+}
+
+static int Host_RemoveFile( const char *filename )
+{
+	char path[MAX_HOST_PATH];
+
+	if( !Host_ResolvePath( filename, path, sizeof( path ), true ))
+		return FALSE;
+
+	return remove( path ) == 0;
+}
+
+static int Host_FileExists( const char *filename, int gamedironly )
+{
+	char path[MAX_HOST_PATH];
+
+	return Host_ResolvePath( filename, path, sizeof( path ), gamedironly );
+}
+
+static void Host_GetGameDir( char *szGetGameDir )
+{
+	strcpy( szGetGameDir, s_gamedir );
+}
+
+static int Host_CompareFileTime( const char *filename1, const char *filename2, int *iCompare )
+{
+	char path1[MAX_HOST_PATH], path2[MAX_HOST_PATH];
+	struct stat st1, st2;
+
+	*iCompare = 0;
+
+	if( !Host_ResolvePath( filename1, path1, sizeof( path1 ), false )
+		|| !Host_ResolvePath( filename2, path2, sizeof( path2 ), false ))
+		return FALSE;
+
+	stat( path1, &st1 );
+	stat( path2, &st2 );
+
+	if( st1.st_mtime < st2.st_mtime )
+		*iCompare = -1;
+	else if( st1.st_mtime > st2.st_mtime )
+		*iCompare = 1;
+
+	return TRUE;
+}
+
+/*
+=================
+Host_MatchPattern
+
+simple case-insensitive wildcard match, supports * and ?
+=================
+*/
+static bool Host_MatchPattern( const char *pattern, const char *name )
+{
+	for( ; *pattern; pattern++, name++ )
+	{
+		if( *pattern == '*' )
+		{
+			for( ; *name; name++ )
+			{
+				if( Host_MatchPattern( pattern + 1, name ))
+					return true;
+			}
+			return Host_MatchPattern( pattern + 1, name );
+		}
+
+		if( !*name )
+			return false;
+
+		if( *pattern != '?' && tolower( *pattern ) != tolower( *name ))
+			return false;
+	}
+
+	return *name == 0;
+}
+
+static void Host_AddToFileList( const char *dir, const char *name )
+{
+	char path[MAX_HOST_PATH];
+
+	snprintf( path, sizeof( path ), "%s%s", dir, name );
+
+	// same file may be found in gamedir and in basedir
+	for( int i = 0; i < s_numFileList; i++ )
+	{
+		if( !stricmp( s_fileList[i], path ))
+			return;
+	}
+
+	s_fileList = (char **)realloc( s_fileList, sizeof( char * ) * ( s_numFileList + 1 ));
+	s_fileList[s_numFileList++] = strdup( path );
+}
+
+static void Host_ScanDirectory( const char *root, const char *dir, const char *pattern )
+{
+	char path[MAX_HOST_PATH];
+
+	snprintf( path, sizeof( path ), "%s/%s", root, dir );
+
+#ifdef _WIN32
+	struct _finddata_t data;
+	intptr_t handle;
+
+	strncat( path, "*", sizeof( path ) - strlen( path ) - 1 );
+	if(( handle = _findfirst( path, &data )) == -1 )
+		return;
+
+	do
+	{
+		if( !( data.attrib & _A_SUBDIR ) && Host_MatchPattern( pattern, data.name ))
+			Host_AddToFileList( dir, data.name );
+	} while( _findnext( handle, &data ) == 0 );
+
+	_findclose( handle );
+#else
+	DIR *d;
+	struct dirent *entry;
+
+	if( !( d = opendir( path )))
+		return;
+
+	while(( entry = readdir( d )) != NULL )
+	{
+		if( entry->d_name[0] == '.' )
+			continue;
+
+		if( Host_MatchPattern( pattern, entry->d_name ))
+			Host_AddToFileList( dir, entry->d_name );
+	}
+
+	closedir( d );
+#endif
+}
+
+static char **Host_GetFilesList( const char *pattern, int *numFiles, int gamedironly )
+{
+	char dir[MAX_HOST_PATH], root[MAX_HOST_PATH];
+	const char *name;
+
+	// list is valid until next call, like in engine
+	for( int i = 0; i < s_numFileList; i++ )
+		free( s_fileList[i] );
+	s_numFileList = 0;
+
+	if( numFiles )
+		*numFiles = 0;
+
+	if( !Host_ValidPath( pattern ))
+		return NULL;
+
+	name = strrchr( pattern, '/' );
+	name = name ? name + 1 : pattern;
+
+	strncpy( dir, pattern, name - pattern );
+	dir[name - pattern] = 0;
+
+	snprintf( root, sizeof( root ), "%s/%s", s_basedir, s_gamedir );
+	Host_ScanDirectory( root, dir, name );
+	if( !gamedironly )
+		Host_ScanDirectory( s_basedir, dir, name );
+
+	if( numFiles )
+		*numFiles = s_numFileList;
+
+	return s_numFileList ? s_fileList : NULL;
+}
+
+static int Host_IsMapValid( char *filename )
+{
+	char path[MAX_HOST_PATH];
+
+	snprintf( path, sizeof( path ), "maps/%s.bsp", filename );
+
+	return Host_FileExists( path, false );
+}
+
+/*
+=================
+Host_CreateMapsList
+
+writes maps.lst with every map found, titles are not known here
+=================
+*/
+static int Host_CreateMapsList( int fRefresh )
+{
+	char **maps;
+	char *buf, *p;
+	int numMaps, len, result;
+
+	maps = Host_GetFilesList( "maps/*.bsp", &numMaps, false );
+	if( !maps )
+		return FALSE;
+
+	buf = p = (char *)malloc( numMaps * 128 + 1 );
+	*p = 0;
+
+	for( int i = 0; i < numMaps; i++ )
+	{
+		char mapname[64];
+
+		snprintf( mapname, sizeof( mapname ), "%s", maps[i] + 5 ); // skip "maps/"
+		if(( len = strlen( mapname )) > 4 )
+			mapname[len - 4] = 0; // strip ".bsp"
+
+		p += sprintf( p, "%s \"%s\"\n", mapname, mapname );
+	}
+
+	result = Host_SaveFile( "maps.lst", buf, p - buf );
+	free( buf );
+
+	return result;
+}
+
+/*
+=================
+Host_ParseFile
+
+engine tokenizer without any special flags
+=================
+*/
+static char *Host_ParseFileEx( char *data, char *token, const int size, unsigned int flags, int *plen )
+{
+	int c, len = 0;
+
+	if( plen )
+		*plen = 0;
+
+	token[0] = 0;
+
+	if( !data )
+		return NULL;
+skipwhite:
+	while(( c = ((byte)*data)) <= ' ' )
+	{
+		if( c == 0 )
+			return NULL;
+		data++;
+	}
+
+	// skip // comments
+	if( c == '/' && data[1] == '/' )
+	{
+		while( *data && *data != '\n' )
+			data++;
+		goto skipwhite;
+	}
+
+	// handle quoted strings specially
+	if( c == '\"' )
+	{
+		data++;
+		while( 1 )
+		{
+			c = (byte)*data;
+
+			if( c == 0 || c == '\"' )
+			{
+				if( c ) data++;
+				token[len] = 0;
+				if( plen ) *plen = len;
+				return data;
+			}
+
+			data++;
+			if( len + 1 < size )
+				token[len++] = c;
+		}
+	}
+
+	// parse single characters
+	if( c == '{' || c == '}' || c == ')' || c == '(' || c == '\'' || c == ',' )
+	{
+		token[len++] = c;
+		token[len] = 0;
+		if( plen ) *plen = len;
+		return data + 1;
+	}
+
+	// parse a regular word
+	do
+	{
+		if( len + 1 < size )
+			token[len++] = c;
+		data++;
+		c = ((byte)*data);
+
+		if( c == '{' || c == '}' || c == ')' || c == '(' || c == '\'' || c == ',' )
+			break;
+	} while( c > 32 );
+
+	token[len] = 0;
+	if( plen ) *plen = len;
+
+	return data;
+}
+
+static char *Host_ParseFile( char *data, char *token )
+{
+	return Host_ParseFileEx( data, token, MAX_HOST_TOKEN, 0, NULL );
+}
+
+/*
+=================================================================
+
+CVARS
+
+=================================================================
+*/
+static cvar_t *Host_FindCvar( const char *name )
+{
+	for( cvar_t *var = s_cvars; var; var = var->next )
+	{
+		if( !stricmp( var->name, name ))
+			return var;
+	}
+
+	return NULL;
+}
+
+void Host_SetCvar( const char *name, const char *value )
+{
+	cvar_t *var = Host_FindCvar( name );
+
+	if( !var )
+	{
+		var = (cvar_t *)calloc( 1, sizeof( cvar_t ));
+		var->name = strdup( name );
+		var->next = s_cvars;
+		s_cvars = var;
+	}
+	else
+	{
+		free( var->string );
+	}
+
+	var->string = strdup( value );
+	var->value = (float)atof( value );
+}
+
+/*
+=================
+Host_RegisterVariable
+
+value preset from command line wins over default, like in engine
+=================
+*/
+static cvar_t *Host_RegisterVariable( const char *szName, const char *szValue, int flags )
+{
+	cvar_t *var = Host_FindCvar( szName );
+
+	if( !var )
+	{
+		Host_SetCvar( szName, szValue );
+		var = Host_FindCvar( szName );
+	}
+
+	var->flags |= flags;
+
+	return var;
+}
+
+static float Host_GetCvarFloat( const char *szName )
+{
+	cvar_t *var = Host_FindCvar( szName );
+
+	return var ? var->value : 0.0f;
+}
+
+static char *Host_GetCvarString( const char *szName )
+{
+	static char empty[1];
+	cvar_t *var = Host_FindCvar( szName );
+
+	return var ? var->string : empty;
+}
+
+static void Host_CvarSetString( const char *szName, const char *szValue )
+{
+	Host_SetCvar( szName, szValue );
+}
+
+static void Host_CvarSetValue( const char *szName, float flValue )
+{
+	char value[64];
+
+	if( flValue == (int)flValue )
+		snprintf( value, sizeof( value ), "%d", (int)flValue );
+	else snprintf( value, sizeof( value ), "%f", flValue );
+
+	Host_SetCvar( szName, value );
+}
+
+/*
+=================================================================
+
+COMMANDS
+
+=================================================================
+*/
+static int Host_AddCommand( const char *cmd_name, void (*function)( void ))
+{
+	for( int i = 0; i < s_numCommands; i++ )
+	{
+		if( !stricmp( s_commands[i].name, cmd_name ))
+		{
+			Host_DPrintf( "Host_AddCommand: %s already defined\n", cmd_name );
+			return FALSE;
+		}
+	}
+
+	if( s_numCommands == MAX_HOST_COMMANDS )
+	{
+		Host_Printf( "Host_AddCommand: too many commands\n" );
+		return FALSE;
+	}
+
+	snprintf( s_commands[s_numCommands].name, sizeof( s_commands[0].name ), "%s", cmd_name );
+	s_commands[s_numCommands].function = function;
+	s_numCommands++;
+
+	return TRUE;
+}
+
+static void Host_DelCommand( const char *cmd_name )
+{
+	for( int i = 0; i < s_numCommands; i++ )
+	{
+		if( stricmp( s_commands[i].name, cmd_name ))
+			continue;
+
+		s_commands[i] = s_commands[--s_numCommands];
+		return;
+	}
+}
+
+static int Host_CmdArgc( void )
+{
+	return s_argc;
+}
+
+static char *Host_CmdArgv( int argc )
+{
+	static char empty[1];
+
+	if( argc < 0 || argc >= s_argc )
+		return empty;
+
+	return s_argv[argc];
+}
+
+static char *Host_Cmd_Args( void )
+{
+	return s_args;
+}
+
+static void Host_TokenizeString( const char *text )
+{
+	char *data = (char *)text;
+	const char *args = NULL;
+
+	s_argc = 0;
+	s_args[0] = 0;
+
+	while( s_argc < MAX_HOST_ARGS )
+	{
+		// remember remaining text after command name
+		if( s_argc == 1 )
+		{
+			for( args = data; *args && *args <= ' '; args++ );
+			snprintf( s_args, sizeof( s_args ), "%s", args );
+		}
+
+		data = Host_ParseFileEx( data, s_argv[s_argc], MAX_HOST_TOKEN, 0, NULL );
+		if( !data )
+			break;
+
+		s_argc++;
+	}
+}
+
+static void Host_ExecuteString( const char *text )
+{
+	cvar_t *var;
+
+	Host_TokenizeString( text );
+
+	if( !s_argc )
+		return;
+
+	s_stats.numCommands++;
+
+	for( int i = 0; i < s_numCommands; i++ )
+	{
+		if( stricmp( s_commands[i].name, s_argv[0] ))
+			continue;
+
+		if( s_commands[i].function )
+			s_commands[i].function();
+		return;
+	}
+
+	if(( var = Host_FindCvar( s_argv[0] )) != NULL )
+	{
+		if( s_argc > 1 )
+			Host_SetCvar( var->name, s_argv[1] );
+		else Host_Printf( "\"%s\" is \"%s\"\n", var->name, var->string );
+		return;
+	}
+
+	if( !stricmp( s_argv[0], "quit" ) || !stricmp( s_argv[0], "exit" ))
+	{
+		s_quit = true;
+		return;
+	}
+
+	if( !stricmp( s_argv[0], "echo" ))
+	{
+		Host_Printf( "%s\n", s_args );
+		return;
+	}
+
+	Host_DPrintf( "Unknown command \"%s\"\n", s_argv[0] );
+}
+
+void Host_Cbuf_AddText( const char *text )
+{
+	int len = strlen( text );
+
+	if( s_cbufLength + len + 1 >= MAX_HOST_CBUF )
+	{
+		Host_Printf( "Host_Cbuf_AddText: overflow\n" );
+		return;
+	}
+
+	memcpy( s_cbuf + s_cbufLength, text, len );
+	s_cbufLength += len;
+	s_cbuf[s_cbufLength++] = '\n';
+}
+
+/*
+=================
+Host_Cbuf_Execute
+
+splits buffer by newlines and semicolons out of quotes
+=================
+*/
+void Host_Cbuf_Execute( void )
+{
+	char line[MAX_HOST_CBUF];
+
+	while( s_cbufLength )
+	{
+		bool quotes = false;
+		int i;
+
+		for( i = 0; i < s_cbufLength; i++ )
+		{
+			if( s_cbuf[i] == '"' )
+				quotes = !quotes;
+
+			if(( !quotes && s_cbuf[i] == ';' ) || s_cbuf[i] == '\n' )
+				break;
+		}
+
+		memcpy( line, s_cbuf, i );
+		line[i] = 0;
+
+		// remove line before executing, commands may add new text
+		if( i == s_cbufLength )
+			s_cbufLength = 0;
+		else
+		{
+			s_cbufLength -= i + 1;
+			memmove( s_cbuf, s_cbuf + i + 1, s_cbufLength );
+		}
+
+		Host_ExecuteString( line );
+	}
+}
+
+static void Host_ClientCmd( int execute_now, const char *szCmdString )
+{
+	Host_Cbuf_AddText( szCmdString );
+
+	if( execute_now )
+		Host_Cbuf_Execute();
+}
+
+bool Host_QuitRequested( void )
+{
+	return s_quit;
+}
+
+/*
+=================================================================
+
+IMAGES
+
+only dimensions are read from headers, nothing is decoded
+=================================================================
+*/
+static int Host_ReadLittleLong( const byte *p )
+{
+	return (int)( p[0] | ( p[1] << 8 ) | ( p[2] << 16 ) | ( (unsigned)p[3] << 24 ));
+}
+
+static int Host_ReadBigLong( const byte *p )
+{
+	return (int)(( (unsigned)p[0] << 24 ) | ( p[1] << 16 ) | ( p[2] << 8 ) | p[3] );
+}
+
+static bool Host_ImageSize( const char *name, const byte *data, int size, int *width, int *height )
+{
+	const char *ext = strrchr( name, '.' );
+
+	if( size >= 26 && data[0] == 'B' && data[1] == 'M' )
+	{
+		*width = Host_ReadLittleLong( data + 18 );
+		*height = abs( Host_ReadLittleLong( data + 22 ));
+		return true;
+	}
+
+	if( size >= 24 && !memcmp( data, "\x89PNG", 4 ))
+	{
+		*width = Host_ReadBigLong( data + 16 );
+		*height = Host_ReadBigLong( data + 20 );
+		return true;
+	}
+
+	if( size >= 18 && ext && !stricmp( ext, ".tga" ))
+	{
+		*width = data[12] | ( data[13] << 8 );
+		*height = data[14] | ( data[15] << 8 );
+		return true;
+	}
+
+	return false;
+}
+
+static hostimage_t *Host_GetImage( HIMAGE hPic )
+{
+	if( hPic <= 0 || hPic > MAX_HOST_IMAGES || !s_images[hPic - 1].used )
+		return NULL;
+
+	return &s_images[hPic - 1];
+}
+
+static HIMAGE Host_PIC_Load( const char *szPicName, const byte *ucRawImage, int ulRawImageSize, int flags )
+{
+	hostimage_t *image = NULL;
+	byte *buf = NULL;
+	int width, height, i;
+	bool ok;
+
+	if( !szPicName || !*szPicName )
+		return 0;
+
+	for( i = 0; i < MAX_HOST_IMAGES; i++ )
+	{
+		if( s_images[i].used && !stricmp( s_images[i].name, szPicName ))
+			return i + 1;
+
+		if( !image && !s_images[i].used )
+			image = &s_images[i];
+	}
+
+	if( !image )
+	{
+		Host_Printf( "Host_PIC_Load: too many images\n" );
+		return 0;
+	}
+
+	// '#' prefix means image is passed from memory
+	if( ucRawImage )
+		ok = Host_ImageSize( szPicName, ucRawImage, ulRawImageSize, &width, &height );
+	else
+	{
+		const char *name = szPicName[0] == '#' ? szPicName + 1 : szPicName;
+		int len;
+
+		if( !( buf = Host_LoadFile( name, &len )))
+			return 0;
+
+		ok = Host_ImageSize( name, buf, len, &width, &height );
+		free( buf );
+	}
+
+	if( !ok )
+	{
+		Host_DPrintf( "Host_PIC_Load: %s has unknown format\n", szPicName );
+		return 0;
+	}
+
+	snprintf( image->name, sizeof( image->name ), "%s", szPicName );
+	image->width = width;
+	image->height = height;
+	image->used = true;
+
+	s_stats.numImages++;
+	s_stats.numImageLoads++;
+
+	return (HIMAGE)( image - s_images ) + 1;
+}
+
+static void Host_PIC_Free( const char *szPicName )
+{
+	for( int i = 0; i < MAX_HOST_IMAGES; i++ )
+	{
+		if( !s_images[i].used || stricmp( s_images[i].name, szPicName ))
+			continue;
+
+		s_images[i].used = false;
+		s_stats.numImages--;
+		return;
+	}
+}
+
+static int Host_PIC_Width( HIMAGE hPic )
+{
+	hostimage_t *image = Host_GetImage( hPic );
+
+	return image ? image->width : 0;
+}
+
+static int Host_PIC_Height( HIMAGE hPic )
+{
+	hostimage_t *image = Host_GetImage( hPic );
+
+	return image ? image->height : 0;
+}
+
+const char *Host_ImageName( HIMAGE hPic )
+{
+	hostimage_t *image = Host_GetImage( hPic );
+
+	return image ? image->name : "";
+}
+
+/*
+=================================================================
+
+DRAWING
+
+every call is appended to the frame draw list
+=================================================================
+*/
+static drawcmd_t *Host_AddDraw( int type, int x, int y, int w, int h, const int *rgba )
+{
+	drawcmd_t *cmd;
+
+	if( s_numDraws == s_maxDraws )
+	{
+		s_maxDraws = s_maxDraws ? s_maxDraws * 2 : 1024;
+		s_draws = (drawcmd_t *)realloc( s_draws, sizeof( drawcmd_t ) * s_maxDraws );
+	}
+
+	cmd = &s_draws[s_numDraws++];
+	memset( cmd, 0, sizeof( *cmd ));
+	cmd->type = type;
+	cmd->x = x;
+	cmd->y = y;
+	cmd->w = w;
+	cmd->h = h;
+	if( rgba )
+		memcpy( cmd->rgba, rgba, sizeof( cmd->rgba ));
+
+	s_stats.numDraws[type]++;
+
+	return cmd;
+}
+
+static void Host_BindPic( HIMAGE hPic )
+{
+	if( hPic == s_boundPic )
+		return;
+
+	s_boundPic = hPic;
+	s_stats.numTextureSwitches++;
+}
+
+static void Host_PIC_Set( HIMAGE hPic, int r, int g, int b, int a )
+{
+	Host_BindPic( hPic );
+
+	// engine remembers image and color for the next draw calls
+	s_curPic = hPic;
+	s_curColor[0] = r;
+	s_curColor[1] = g;
+	s_curColor[2] = b;
+	s_curColor[3] = a;
+}
+
+static void Host_PIC_DrawGeneric( int type, int x, int y, int width, int height, const wrect_t *prc )
+{
+	drawcmd_t *cmd = Host_AddDraw( type, x, y, width, height, s_curColor );
+
+	cmd->pic = s_curPic;
+	if( prc )
+	{
+		cmd->rc = *prc;
+		cmd->hasRect = true;
+	}
+}
+
+static void Host_PIC_Draw( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Host_PIC_DrawGeneric( DRAW_PIC, x, y, width, height, prc );
+}
+
+static void Host_PIC_DrawHoles( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Host_PIC_DrawGeneric( DRAW_PIC_HOLES, x, y, width, height, prc );
+}
+
+static void Host_PIC_DrawTrans( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Host_PIC_DrawGeneric( DRAW_PIC_TRANS, x, y, width, height, prc );
+}
+
+static void Host_PIC_DrawAdditive( int x, int y, int width, int height, const wrect_t *prc )
+{
+	Host_PIC_DrawGeneric( DRAW_PIC_ADDITIVE, x, y, width, height, prc );
+}
+
+static void Host_PIC_EnableScissor( int x, int y, int width, int height )
+{
+	Host_AddDraw( DRAW_SCISSOR, x, y, width, height, NULL );
+}
+
+static void Host_PIC_DisableScissor( void )
+{
+	Host_AddDraw( DRAW_NOSCISSOR, 0, 0, 0, 0, NULL );
+}
+
+static void Host_FillRGBA( int x, int y, int width, int height, int r, int g, int b, int a )
+{
+	int rgba[4] = { r, g, b, a };
+
+	Host_AddDraw( DRAW_FILL, x, y, width, height, rgba );
+}
+
+static void Host_DrawCharacter( int x, int y, int width, int height, int ch, int ulRGBA, HIMAGE hFont )
+{
+	int rgba[4];
+	drawcmd_t *cmd;
+
+	rgba[0] = ( ulRGBA >> 16 ) & 0xFF;
+	rgba[1] = ( ulRGBA >> 8 ) & 0xFF;
+	rgba[2] = ulRGBA & 0xFF;
+	rgba[3] = ( ulRGBA >> 24 ) & 0xFF;
+
+	Host_BindPic( hFont );
+
+	cmd = Host_AddDraw( DRAW_CHAR, x, y, width, height, rgba );
+	cmd->pic = hFont;
+	cmd->rc.left = ch;
+}
+
+static int Host_ConsoleStringLength( const char *string )
+{
+	int len = 0;
+
+	for( ; *string; string++ )
+	{
+		// skip color codes
+		if( string[0] == '^' && string[1] >= '0' && string[1] <= '9' )
+		{
+			string++;
+			continue;
+		}
+
+		len++;
+	}
+
+	return len;
+}
+
+static int Host_DrawConsoleString( int x, int y, const char *string )
+{
+	int width = Host_ConsoleStringLength( string ) * CON_CHAR_WIDTH;
+
+	Host_AddDraw( DRAW_STRING, x, y, width, CON_CHAR_HEIGHT, s_textColor );
+
+	return x + width;
+}
+
+static void Host_DrawSetTextColor( int r, int g, int b, int alpha )
+{
+	s_textColor[0] = r;
+	s_textColor[1] = g;
+	s_textColor[2] = b;
+	s_textColor[3] = alpha;
+}
+
+static void Host_DrawConsoleStringLen( const char *string, int *length, int *height )
+{
+	if( length )
+		*length = Host_ConsoleStringLength( string ) * CON_CHAR_WIDTH;
+	if( height )
+		*height = CON_CHAR_HEIGHT;
+}
+
+static void Host_DrawLogo( const char *filename, float x, float y, float width, float height )
+{
+	Host_AddDraw( DRAW_LOGO, (int)x, (int)y, (int)width, (int)height, NULL );
+}
+
+static float Host_GetLogoLength( void )
+{
+	return 0.0f;
+}
+
+void Host_BeginFrame( void )
+{
+	s_numDraws = 0;
+}
+
+int Host_FrameDrawCount( void )
+{
+	return s_numDraws;
+}
+
+const drawcmd_t *Host_FrameDraws( void )
+{
+	return s_draws;
+}
+
+const char *Host_DrawCmdName( int type )
+{
+	static const char *names[DRAW_NUMCMDS] =
+	{
+		"pic", "holes", "trans", "additive", "fill",
+		"char", "string", "logo", "scissor", "noscissor"
+	};
+
+	if( type < 0 || type >= DRAW_NUMCMDS )
+		return "unknown";
+
+	return names[type];
+}
+
+const hoststats_t *Host_Stats( void )
+{
+	return &s_stats;
+}
+
+/*
+=================
+Host_CountDraws
+
+everything that puts pixels on screen
+=================
+*/
+int Host_CountDraws( const hoststats_t *stats )
+{
+	int count = 0;
+
+	for( int i = DRAW_PIC; i <= DRAW_LOGO; i++ )
+		count += stats->numDraws[i];
+
+	return count;
+}
+
+/*
+=================================================================
+
+MISC
+
+=================================================================
+*/
+static struct cl_entity_s *Host_GetPlayerModel( void )
+{
+	return &s_playerModel;
+}
+
+static int Host_CreateVisibleEntity( int type, struct cl_entity_s *ent )
+{
+	return TRUE;
+}
+
+static const char *Host_KeynumToString( int keynum )
+{
+	static char name[16];
+
+	snprintf( name, sizeof( name ), "<KEY %i>", keynum );
+
+	return name;
+}
+
+static const char *Host_KeyGetBinding( int keynum )
+{
+	if( keynum < 0 || keynum >= MAX_HOST_KEYS )
+		return NULL;
+
+	return s_bindings[keynum];
+}
+
+static void Host_KeySetBinding( int keynum, const char *binding )
+{
+	if( keynum < 0 || keynum >= MAX_HOST_KEYS )
+		return;
+
+	free( s_bindings[keynum] );
+	s_bindings[keynum] = binding && *binding ? strdup( binding ) : NULL;
+}
+
+static int Host_KeyGetOverstrikeMode( void )
+{
+	return s_overstrike;
+}
+
+static void Host_KeySetOverstrikeMode( int fActive )
+{
+	s_overstrike = fActive;
+}
+
+static void *Host_KeyGetState( const char *name )
+{
+	static int state[4];
+
+	return state;
+}
+
+static void *Host_MemAlloc( size_t cb, const char *filename, const int fileline )
+{
+	return calloc( 1, cb );
+}
+
+static void Host_MemFree( void *mem, const char *filename, const int fileline )
+{
+	free( mem );
+}
+
+static int Host_GetGameInfo( GAMEINFO *pgameinfo )
+{
+	*pgameinfo = s_gameInfo;
+
+	return TRUE;
+}
+
+static GAMEINFO **Host_GetGamesList( int *numGames )
+{
+	if( numGames )
+		*numGames = 1;
+
+	return s_gamesList;
+}
+
+static int Host_CheckGameDll( void )
+{
+	return TRUE;
+}
+
+static char *Host_GetClipboardData( void )
+{
+	return NULL;
+}
+
+static void Host_HostEndGame( const char *szFinalMessage )
+{
+	Host_Printf( "Host_EndGame: %s\n", szFinalMessage ? szFinalMessage : "" );
+	s_quit = true;
+}
+
+/*
+=================
+Host_RandomLong
+
+fixed seed, so runs are reproducible
+=================
+*/
+static int Host_RandomLong( int lLow, int lHigh )
+{
+	unsigned int range;
+
+	if( lLow >= lHigh )
+		return lLow;
+
+	s_randSeed = s_randSeed * 1103515245 + 12345;
+	range = (unsigned int)( lHigh - lLow ) + 1;
+
+	return lLow + (int)(( s_randSeed >> 8 ) % range );
+}
+
+static float Host_RandomFloat( float flLow, float flHigh )
+{
+	s_randSeed = s_randSeed * 1103515245 + 12345;
+
+	return flLow + ( flHigh - flLow ) * (float)( s_randSeed >> 8 ) / (float)0xFFFFFF;
+}
+
+static const char *Host_GetModeString( int vid_mode )
+{
+	static const char *modes[] =
+	{
+		"640x480", "800x600", "1024x768", "1280x720", "1366x768", "1600x900", "1920x1080"
+	};
+
+	if( vid_mode < 0 || vid_mode >= (int)( sizeof( modes ) / sizeof( modes[0] )))
+		return NULL;
+
+	return modes[vid_mode];
+}
+
+static int Host_GetRenderers( unsigned int num, char *shortName, size_t size1, char *readableName, size_t size2 )
+{
+	if( num > 0 )
+		return FALSE;
+
+	if( shortName )
+		snprintf( shortName, size1, "null" );
+	if( readableName )
+		snprintf( readableName, size2, "Headless" );
+
+	return TRUE;
+}
+
+static const char *Host_AdrToString( const netadr_t a )
+{
+	static char s[64];
+
+	snprintf( s, sizeof( s ), "%i.%i.%i.%i:%i", a.ip[0], a.ip[1], a.ip[2], a.ip[3],
+		(( a.port & 0xFF ) << 8 ) | (( a.port >> 8 ) & 0xFF ));
+
+	return s;
+}
+
+/*
+=================================================================
+
+INIT
+
+=================================================================
+*/
+typedef intptr_t (*pfnGeneric_t)( void );
+
+/*
+=================
+Host_NotImplemented
+
+engine functions not needed for headless run return zero
+=================
+*/
+static intptr_t Host_NotImplemented( void )
+{
+	return 0;
+}
+
+static void Host_FillTable( void *table, size_t size )
+{
+	pfnGeneric_t *slots = (pfnGeneric_t *)table;
+
+	for( size_t i = 0; i < size / sizeof( pfnGeneric_t ); i++ )
+		slots[i] = Host_NotImplemented;
+}
+
+// cast protects against small const differences between SDK revisions
+#define HOST_FUNC( table, member, func ) ( (table)->member = (decltype( (table)->member ))( func ))
+
+void Host_EngineInit( const hostparams_t *params, ui_enginefuncs_t *engfuncs, ui_extendedfuncs_t *textfuncs, ui_globalvars_t *globals )
+{
+	s_params = *params;
+	snprintf( s_basedir, sizeof( s_basedir ), "%s", params->basedir );
+	snprintf( s_gamedir, sizeof( s_gamedir ), "%s", params->gamedir );
+
+	s_globals = globals;
+	memset( globals, 0, sizeof( *globals ));
+	globals->scrWidth = params->width;
+	globals->scrHeight = params->height;
+	globals->maxClients = 1;
+	globals->developer = params->developer;
+
+	s_startTime = Host_RealTime();
+	s_time = 0.0;
+
+	memset( &s_gameInfo, 0, sizeof( s_gameInfo ));
+	snprintf( s_gameInfo.gamefolder, sizeof( s_gameInfo.gamefolder ), "%s", s_gamedir );
+	snprintf( s_gameInfo.title, sizeof( s_gameInfo.title ), "%s", s_gamedir );
+	snprintf( s_gameInfo.startmap, sizeof( s_gameInfo.startmap ), "c0a0" );
+	snprintf( s_gameInfo.version, sizeof( s_gameInfo.version ), "1.0" );
+	s_gamesList[0] = &s_gameInfo;
+
+	Host_SetCvar( "developer", params->developer ? "1" : "0" );
+
+	Host_FillTable( engfuncs, sizeof( *engfuncs ));
+	Host_FillTable( textfuncs, sizeof( *textfuncs ));
+
+	// image handlers
+	HOST_FUNC( engfuncs, pfnPIC_Load, Host_PIC_Load );
+	HOST_FUNC( engfuncs, pfnPIC_Free, Host_PIC_Free );
+	HOST_FUNC( engfuncs, pfnPIC_Width, Host_PIC_Width );
+	HOST_FUNC( engfuncs, pfnPIC_Height, Host_PIC_Height );
+	HOST_FUNC( engfuncs, pfnPIC_Set, Host_PIC_Set );
+	HOST_FUNC( engfuncs, pfnPIC_Draw, Host_PIC_Draw );
+	HOST_FUNC( engfuncs, pfnPIC_DrawHoles, Host_PIC_DrawHoles );
+	HOST_FUNC( engfuncs, pfnPIC_DrawTrans, Host_PIC_DrawTrans );
+	HOST_FUNC( engfuncs, pfnPIC_DrawAdditive, Host_PIC_DrawAdditive );
+	HOST_FUNC( engfuncs, pfnPIC_EnableScissor, Host_PIC_EnableScissor );
+	HOST_FUNC( engfuncs, pfnPIC_DisableScissor, Host_PIC_DisableScissor );
+	HOST_FUNC( engfuncs, pfnFillRGBA, Host_FillRGBA );
+
+	// cvar & command handlers
+	HOST_FUNC( engfuncs, pfnRegisterVariable, Host_RegisterVariable );
+	HOST_FUNC( engfuncs, pfnGetCvarFloat, Host_GetCvarFloat );
+	HOST_FUNC( engfuncs, pfnGetCvarString, Host_GetCvarString );
+	HOST_FUNC( engfuncs, pfnCvarSetString, Host_CvarSetString );
+	HOST_FUNC( engfuncs, pfnCvarSetValue, Host_CvarSetValue );
+	HOST_FUNC( engfuncs, pfnAddCommand, Host_AddCommand );
+	HOST_FUNC( engfuncs, pfnClientCmd, Host_ClientCmd );
+	HOST_FUNC( engfuncs, pfnDelCommand, Host_DelCommand );
+	HOST_FUNC( engfuncs, pfnCmdArgc, Host_CmdArgc );
+	HOST_FUNC( engfuncs, pfnCmdArgv, Host_CmdArgv );
+	HOST_FUNC( engfuncs, pfnCmd_Args, Host_Cmd_Args );
+
+	// console
+	HOST_FUNC( engfuncs, Con_Printf, Host_Printf );
+	HOST_FUNC( engfuncs, Con_DPrintf, Host_DPrintf );
+	HOST_FUNC( engfuncs, Con_NPrintf, Host_NPrintf );
+	HOST_FUNC( engfuncs, Con_NXPrintf, Host_NXPrintf );
+	HOST_FUNC( engfuncs, pfnHostError, Host_HostError );
+
+	// text & logo
+	HOST_FUNC( engfuncs, pfnDrawLogo, Host_DrawLogo );
+	HOST_FUNC( engfuncs, pfnGetLogoLength, Host_GetLogoLength );
+	HOST_FUNC( engfuncs, pfnDrawCharacter, Host_DrawCharacter );
+	HOST_FUNC( engfuncs, pfnDrawConsoleString, Host_DrawConsoleString );
+	HOST_FUNC( engfuncs, pfnDrawSetTextColor, Host_DrawSetTextColor );
+	HOST_FUNC( engfuncs, pfnDrawConsoleStringLen, Host_DrawConsoleStringLen );
+
+	// scene
+	HOST_FUNC( engfuncs, pfnGetPlayerModel, Host_GetPlayerModel );
+	HOST_FUNC( engfuncs, CL_CreateVisibleEntity, Host_CreateVisibleEntity );
+
+	// filesystem
+	HOST_FUNC( engfuncs, pfnFileExists, Host_FileExists );
+	HOST_FUNC( engfuncs, pfnGetGameDir, Host_GetGameDir );
+	HOST_FUNC( engfuncs, pfnCreateMapsList, Host_CreateMapsList );
+	HOST_FUNC( engfuncs, COM_LoadFile, Host_LoadFile );
+	HOST_FUNC( engfuncs, COM_ParseFile, Host_ParseFile );
+	HOST_FUNC( engfuncs, COM_FreeFile, Host_FreeFile );
+	HOST_FUNC( engfuncs, COM_SaveFile, Host_SaveFile );
+	HOST_FUNC( engfuncs, COM_RemoveFile, Host_RemoveFile );
+	HOST_FUNC( engfuncs, pfnGetFilesList, Host_GetFilesList );
+	HOST_FUNC( engfuncs, pfnCompareFileTime, Host_CompareFileTime );
+	HOST_FUNC( engfuncs, pfnIsMapValid, Host_IsMapValid );
+
+	// keys
+	HOST_FUNC( engfuncs, pfnKeynumToString, Host_KeynumToString );
+	HOST_FUNC( engfuncs, pfnKeyGetBinding, Host_KeyGetBinding );
+	HOST_FUNC( engfuncs, pfnKeySetBinding, Host_KeySetBinding );
+	HOST_FUNC( engfuncs, pfnKeyGetOverstrikeMode, Host_KeyGetOverstrikeMode );
+	HOST_FUNC( engfuncs, pfnKeySetOverstrikeMode, Host_KeySetOverstrikeMode );
+	HOST_FUNC( engfuncs, pfnKeyGetState, Host_KeyGetState );
+
+	// misc
+	HOST_FUNC( engfuncs, pfnMemAlloc, Host_MemAlloc );
+	HOST_FUNC( engfuncs, pfnMemFree, Host_MemFree );
+	HOST_FUNC( engfuncs, pfnGetGameInfo, Host_GetGameInfo );
+	HOST_FUNC( engfuncs, pfnGetGamesList, Host_GetGamesList );
+	HOST_FUNC( engfuncs, pfnCheckGameDll, Host_CheckGameDll );
+	HOST_FUNC( engfuncs, pfnGetClipboardData, Host_GetClipboardData );
+	HOST_FUNC( engfuncs, pfnHostEndGame, Host_HostEndGame );
+	HOST_FUNC( engfuncs, pfnRandomFloat, Host_RandomFloat );
+	HOST_FUNC( engfuncs, pfnRandomLong, Host_RandomLong );
+	HOST_FUNC( engfuncs, pfnGetModeString, Host_GetModeString );
+
+	// extended API
+	HOST_FUNC( textfuncs, pfnGetRenderers, Host_GetRenderers );
+	HOST_FUNC( textfuncs, pfnDoubleTime, Host_DoubleTime );
+	HOST_FUNC( textfuncs, pfnParseFile, Host_ParseFileEx );
+	HOST_FUNC( textfuncs, pfnAdrToString, Host_AdrToString );
+}
+
+void Host_EngineShutdown( void )
+{
+	while( s_cvars )
+	{
+		cvar_t *next = s_cvars->next;
+
+		free( s_cvars->name );
+		free( s_cvars->string );
+		free( s_cvars );
+		s_cvars = next;
+	}
+
+	for( int i = 0; i < MAX_HOST_KEYS; i++ )
+	{
+		free( s_bindings[i] );
+		s_bindings[i] = NULL;
+	}
+
+	for( int i = 0; i < s_numFileList; i++ )
+		free( s_fileList[i] );
+	free( s_fileList );
+	s_fileList = NULL;
+	s_numFileList = 0;
+
+	free( s_draws );
+	s_draws = NULL;
+	s_numDraws = s_maxDraws = 0;
+	s_numCommands = 0;
+}
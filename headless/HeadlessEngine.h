@@ -0,0 +1,94 @@
+/*
+HeadlessEngine.h - stand-in engine for running menu without renderer
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#pragma once
+#ifndef HEADLESSENGINE_H
+#define HEADLESSENGINE_H
+
+#include "extdll_menu.h"
+
+enum drawcmd_e
+{
+	DRAW_PIC = 0,
+	DRAW_PIC_HOLES,
+	DRAW_PIC_TRANS,
+	DRAW_PIC_ADDITIVE,
+	DRAW_FILL,
+	DRAW_CHAR,
+	DRAW_STRING,
+	DRAW_LOGO,
+	DRAW_SCISSOR,
+	DRAW_NOSCISSOR,
+
+	DRAW_NUMCMDS
+};
+
+// one recorded engine draw call
+struct drawcmd_t
+{
+	int type;
+	HIMAGE pic;		// image handle, character for DRAW_CHAR
+	int x, y, w, h;
+	int rgba[4];	// color set by PIC_Set/FillRGBA/DrawSetTextColor
+	wrect_t rc;		// source rectangle, if any
+	bool hasRect;
+};
+
+struct hoststats_t
+{
+	int numDraws[DRAW_NUMCMDS];
+	int numImages;		// images alive at the moment
+	int numImageLoads;	// PIC_Load calls since start
+	int numFileLoads;	// COM_LoadFile calls since start
+	int numCommands;	// commands executed since start
+	int numTextureSwitches;	// PIC_Set or DrawCharacter with different image
+};
+
+struct hostparams_t
+{
+	const char *basedir;	// filesystem root
+	const char *gamedir;	// game directory inside basedir
+	int width, height;
+	float fps;				// virtual clock rate
+	bool realtime;			// use real clock instead of virtual
+	int developer;
+};
+
+void Host_EngineInit( const hostparams_t *params, ui_enginefuncs_t *engfuncs, ui_extendedfuncs_t *textfuncs, ui_globalvars_t *globals );
+void Host_EngineShutdown( void );
+
+// clock
+double Host_RealTime( void );
+double Host_AdvanceClock( void );
+
+// cvars & commands
+void Host_SetCvar( const char *name, const char *value );
+void Host_Cbuf_AddText( const char *text );
+void Host_Cbuf_Execute( void );
+bool Host_QuitRequested( void );
+
+// draw command recording
+void Host_BeginFrame( void );
+int Host_FrameDrawCount( void );
+const drawcmd_t *Host_FrameDraws( void );
+const char *Host_ImageName( HIMAGE pic );
+const char *Host_DrawCmdName( int type );
+const hoststats_t *Host_Stats( void );
+int Host_CountDraws( const hoststats_t *stats );
+
+// trace replay, see DrawTraceFormat.h
+int Host_ReplayTrace( const ui_enginefuncs_t *engfuncs, const char *filename, const char *difffile );
+
+#endif // HEADLESSENGINE_H
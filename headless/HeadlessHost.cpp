@@ -0,0 +1,276 @@
+/*
+HeadlessHost.cpp - runs menu library frames without renderer
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+usage: menu_headless [-game dir] [-basedir dir] [-frames N] [-fps N]
+		[-width N] [-height N] [-menu "command"] [-log file]
+		[-realtime] [-dev] [-dll path] [+cvar value ...]
+       menu_headless -replay trace.dtr [-diff other.dtr]
+*/
+
+#include <stdarg.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <dlfcn.h>
+#endif
+
+#include "extdll_menu.h"
+#include "HeadlessEngine.h"
+
+#ifdef _WIN32
+#define MENU_LIBRARY "menu.dll"
+#elif defined(__APPLE__)
+#define MENU_LIBRARY "./menu.dylib"
+#else
+#define MENU_LIBRARY "./libmenu.so"
+#endif
+
+typedef int (*pfnGetMenuAPI_t)( UI_FUNCTIONS *pFunctionTable, ui_enginefuncs_t *pEngfuncsFromEngine, ui_globalvars_t *pGlobals );
+typedef int (*pfnGetExtAPI_t)( int version, UI_EXTENDED_FUNCTIONS *pFunctionTable, ui_extendedfuncs_t *pEngfuncsFromEngine );
+
+static UI_FUNCTIONS		s_dllFuncs;
+static UI_EXTENDED_FUNCTIONS	s_dllExtFuncs;
+static ui_enginefuncs_t		s_engfuncs;
+static ui_extendedfuncs_t	s_textfuncs;
+static ui_globalvars_t		s_globals;
+
+static void *Sys_LoadLibrary( const char *path )
+{
+#ifdef _WIN32
+	return (void *)LoadLibraryA( path );
+#else
+	return dlopen( path, RTLD_NOW );
+#endif
+}
+
+static void *Sys_GetProcAddress( void *hInstance, const char *name )
+{
+#ifdef _WIN32
+	return (void *)GetProcAddress( (HMODULE)hInstance, name );
+#else
+	return dlsym( hInstance, name );
+#endif
+}
+
+static void Sys_FreeLibrary( void *hInstance )
+{
+#ifdef _WIN32
+	FreeLibrary( (HMODULE)hInstance );
+#else
+	dlclose( hInstance );
+#endif
+}
+
+static const char *Sys_LibraryError( void )
+{
+#ifdef _WIN32
+	static char err[32];
+
+	snprintf( err, sizeof( err ), "error %lu", GetLastError( ));
+	return err;
+#else
+	return dlerror();
+#endif
+}
+
+/*
+=================
+Host_WriteDrawLog
+
+dumps draw commands of the last frame, one per line
+=================
+*/
+static void Host_WriteDrawLog( const char *filename )
+{
+	const drawcmd_t *draws = Host_FrameDraws();
+	int count = Host_FrameDrawCount();
+	FILE *f;
+
+	if( !( f = fopen( filename, "w" )))
+	{
+		printf( "Can't write %s\n", filename );
+		return;
+	}
+
+	for( int i = 0; i < count; i++ )
+	{
+		const drawcmd_t *cmd = &draws[i];
+
+		fprintf( f, "%s %i %i %i %i rgba %i %i %i %i", Host_DrawCmdName( cmd->type ),
+			cmd->x, cmd->y, cmd->w, cmd->h, cmd->rgba[0], cmd->rgba[1], cmd->rgba[2], cmd->rgba[3] );
+
+		if( cmd->type == DRAW_CHAR )
+			fprintf( f, " char %i", cmd->rc.left );
+		else if( cmd->type <= DRAW_PIC_ADDITIVE )
+			fprintf( f, " pic \"%s\"", Host_ImageName( cmd->pic ));
+
+		if( cmd->hasRect )
+			fprintf( f, " rect %i %i %i %i", cmd->rc.left, cmd->rc.right, cmd->rc.top, cmd->rc.bottom );
+
+		fprintf( f, "\n" );
+	}
+
+	fclose( f );
+}
+
+static const char *Host_CheckParm( int argc, char **argv, const char *parm )
+{
+	for( int i = 1; i < argc - 1; i++ )
+	{
+		if( !stricmp( argv[i], parm ))
+			return argv[i + 1];
+	}
+
+	return NULL;
+}
+
+static bool Host_CheckFlag( int argc, char **argv, const char *parm )
+{
+	for( int i = 1; i < argc; i++ )
+	{
+		if( !stricmp( argv[i], parm ))
+			return true;
+	}
+
+	return false;
+}
+
+int main( int argc, char **argv )
+{
+	hostparams_t params;
+	pfnGetMenuAPI_t GetMenuAPI;
+	pfnGetExtAPI_t GetExtAPI;
+	const char *dllpath, *menucmd, *logfile, *parm;
+	double frameMin = 1e9, frameMax = 0.0, frameTotal = 0.0, start, t;
+	int frames, totalDraws = 0;
+	void *hInstance;
+
+	memset( &params, 0, sizeof( params ));
+	params.basedir = ( parm = Host_CheckParm( argc, argv, "-basedir" )) ? parm : ".";
+	params.gamedir = ( parm = Host_CheckParm( argc, argv, "-game" )) ? parm : "valve";
+	params.width = ( parm = Host_CheckParm( argc, argv, "-width" )) ? atoi( parm ) : 640;
+	params.height = ( parm = Host_CheckParm( argc, argv, "-height" )) ? atoi( parm ) : 480;
+	params.fps = ( parm = Host_CheckParm( argc, argv, "-fps" )) ? atof( parm ) : 60.0f;
+	params.realtime = Host_CheckFlag( argc, argv, "-realtime" );
+	params.developer = Host_CheckFlag( argc, argv, "-dev" );
+
+	frames = ( parm = Host_CheckParm( argc, argv, "-frames" )) ? atoi( parm ) : 100;
+	dllpath = ( parm = Host_CheckParm( argc, argv, "-dll" )) ? parm : MENU_LIBRARY;
+	menucmd = Host_CheckParm( argc, argv, "-menu" );
+	logfile = Host_CheckParm( argc, argv, "-log" );
+
+	if( params.fps <= 0.0f )
+		params.fps = 60.0f;
+
+	Host_EngineInit( &params, &s_engfuncs, &s_textfuncs, &s_globals );
+
+	// traces are replayed against stub engine only, menu isn't needed
+	if(( parm = Host_CheckParm( argc, argv, "-replay" )) != NULL )
+	{
+		int result = Host_ReplayTrace( &s_engfuncs, parm, Host_CheckParm( argc, argv, "-diff" ));
+
+		Host_EngineShutdown();
+		return result;
+	}
+
+	// +cvar value, set before menu registers them
+	for( int i = 1; i < argc - 1; i++ )
+	{
+		if( argv[i][0] == '+' )
+			Host_SetCvar( argv[i] + 1, argv[i + 1] );
+	}
+
+	if( !( hInstance = Sys_LoadLibrary( dllpath )))
+	{
+		printf( "Can't load %s: %s\n", dllpath, Sys_LibraryError( ));
+		return 1;
+	}
+
+	if( !( GetMenuAPI = (pfnGetMenuAPI_t)Sys_GetProcAddress( hInstance, "GetMenuAPI" )))
+	{
+		printf( "%s: GetMenuAPI not found\n", dllpath );
+		Sys_FreeLibrary( hInstance );
+		return 1;
+	}
+
+	if( !GetMenuAPI( &s_dllFuncs, &s_engfuncs, &s_globals ))
+	{
+		printf( "%s: GetMenuAPI failed\n", dllpath );
+		Sys_FreeLibrary( hInstance );
+		return 1;
+	}
+
+	// extended API is optional, like in engine
+	GetExtAPI = (pfnGetExtAPI_t)Sys_GetProcAddress( hInstance, "GetExtAPI" );
+	if( !GetExtAPI || !GetExtAPI( MENU_EXTENDED_API_VERSION, &s_dllExtFuncs, &s_textfuncs ))
+		printf( "%s: extended menu API not available\n", dllpath );
+
+	start = Host_RealTime();
+	s_dllFuncs.pfnInit();
+	s_dllFuncs.pfnVidInit();
+	printf( "Init: %.2f ms\n", ( Host_RealTime() - start ) * 1000.0 );
+
+	s_dllFuncs.pfnSetActiveMenu( TRUE );
+
+	if( menucmd )
+		Host_Cbuf_AddText( menucmd );
+
+	int i;
+	for( i = 0; i < frames && !Host_QuitRequested(); i++ )
+	{
+		Host_Cbuf_Execute();
+		Host_BeginFrame();
+
+		t = Host_AdvanceClock();
+
+		start = Host_RealTime();
+		s_dllFuncs.pfnRedraw( (float)t );
+		start = Host_RealTime() - start;
+
+		frameTotal += start;
+		if( start < frameMin ) frameMin = start;
+		if( start > frameMax ) frameMax = start;
+		totalDraws += Host_FrameDrawCount();
+	}
+	frames = i;
+
+	if( logfile )
+		Host_WriteDrawLog( logfile );
+
+	if( frames > 0 )
+	{
+		const hoststats_t *stats = Host_Stats();
+
+		printf( "Frames: %i\n", frames );
+		printf( "Frame time: avg %.3f ms, min %.3f ms, max %.3f ms\n",
+			frameTotal * 1000.0 / frames, frameMin * 1000.0, frameMax * 1000.0 );
+		printf( "Draws per frame: avg %.1f, last %i\n", (float)totalDraws / frames, Host_FrameDrawCount( ));
+		printf( "Texture switches per frame: avg %.1f\n", (float)stats->numTextureSwitches / frames );
+
+		for( i = 0; i < DRAW_NUMCMDS; i++ )
+		{
+			if( stats->numDraws[i] )
+				printf( "  %-10s %i\n", Host_DrawCmdName( i ), stats->numDraws[i] );
+		}
+
+		printf( "Images: %i alive, %i loaded\n", stats->numImages, stats->numImageLoads );
+		printf( "Files loaded: %i, commands executed: %i\n", stats->numFileLoads, stats->numCommands );
+	}
+
+	s_dllFuncs.pfnShutdown();
+	Sys_FreeLibrary( hInstance );
+	Host_EngineShutdown();
+
+	return 0;
+}
@@ -0,0 +1,478 @@
+/*
+HeadlessReplay.cpp - replays recorded menu draw traces
+Copyright (C) 2026 agent
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+*/
+
+#include "extdll_menu.h"
+#include "DrawTraceFormat.h"
+#include "HeadlessEngine.h"
+
+#define MAX_REPLAY_WINDOWS	64
+
+struct replaywindow_t
+{
+	char name[64];
+	int frames;
+	double cost;
+	double maxCost;
+	int draws;
+	int switches;
+};
+
+struct replaysummary_t
+{
+	const char *filename;
+	int size;
+	int width, height;
+
+	int frames;
+	double cost;		// menu frame cost recorded in trace, seconds
+	double maxCost;
+	int maxCostFrame;
+	char maxCostWindow[64];
+	int draws;			// counted by stub engine
+	int switches;
+
+	replaywindow_t windows[MAX_REPLAY_WINDOWS];
+	int numWindows;
+};
+
+struct tracereader_t
+{
+	const byte *data;
+	int size;
+	int pos;
+	bool error;
+};
+
+static int Trace_ReadByte( tracereader_t *r )
+{
+	if( r->pos >= r->size )
+	{
+		r->error = true;
+		return 0;
+	}
+
+	return r->data[r->pos++];
+}
+
+static unsigned int Trace_ReadVarint( tracereader_t *r )
+{
+	unsigned int value = 0;
+	int shift = 0, b;
+
+	do
+	{
+		b = Trace_ReadByte( r );
+		value |= (unsigned int)( b & 0x7F ) << shift;
+		shift += 7;
+	} while(( b & 0x80 ) && !r->error && shift < 35 );
+
+	return value;
+}
+
+static int Trace_ReadInt( tracereader_t *r )
+{
+	return DrawTrace_UnZigZag( Trace_ReadVarint( r ));
+}
+
+static void Trace_ReadString( tracereader_t *r, char *out, int size )
+{
+	int len = Trace_ReadVarint( r );
+	int i;
+
+	for( i = 0; i < len && !r->error; i++ )
+	{
+		int c = Trace_ReadByte( r );
+
+		if( i < size - 1 )
+			out[i] = c;
+	}
+
+	out[i < size - 1 ? i : size - 1] = 0;
+}
+
+static void Trace_ReadColor( tracereader_t *r, int *rgba )
+{
+	for( int i = 0; i < 4; i++ )
+		rgba[i] = Trace_ReadByte( r );
+}
+
+static void Trace_ReadRect( tracereader_t *r, int *rect )
+{
+	for( int i = 0; i < 4; i++ )
+		rect[i] = Trace_ReadInt( r );
+}
+
+/*
+=================
+Replay_LoadImage
+
+stub engine needs only dimensions, so image is a bare BMP header
+=================
+*/
+static HIMAGE Replay_LoadImage( const ui_enginefuncs_t *engfuncs, const char *name, int handle, int width, int height )
+{
+	char fakename[64];
+	byte header[26];
+
+	memset( header, 0, sizeof( header ));
+	header[0] = 'B';
+	header[1] = 'M';
+	for( int i = 0; i < 4; i++ )
+	{
+		header[18 + i] = ( width >> ( i * 8 )) & 0xFF;
+		header[22 + i] = ( height >> ( i * 8 )) & 0xFF;
+	}
+
+	if( !*name )
+	{
+		snprintf( fakename, sizeof( fakename ), "#trace%i", handle );
+		name = fakename;
+	}
+
+	return engfuncs->pfnPIC_Load( name, header, sizeof( header ), 0 );
+}
+
+static replaywindow_t *Replay_FindWindow( replaysummary_t *summary, const char *name )
+{
+	replaywindow_t *window;
+
+	for( int i = 0; i < summary->numWindows; i++ )
+	{
+		if( !strcmp( summary->windows[i].name, name ))
+			return &summary->windows[i];
+	}
+
+	if( summary->numWindows == MAX_REPLAY_WINDOWS )
+		return NULL;
+
+	window = &summary->windows[summary->numWindows++];
+	memset( window, 0, sizeof( *window ));
+	snprintf( window->name, sizeof( window->name ), "%s", name );
+
+	return window;
+}
+
+static byte *Replay_LoadFile( const char *filename, int *size )
+{
+	FILE *f;
+	byte *data;
+	long len;
+
+	if( !( f = fopen( filename, "rb" )))
+		return NULL;
+
+	fseek( f, 0, SEEK_END );
+	len = ftell( f );
+	fseek( f, 0, SEEK_SET );
+
+	data = (byte *)malloc( len > 0 ? len : 1 );
+	if( fread( data, 1, len, f ) != (size_t)len )
+	{
+		free( data );
+		data = NULL;
+	}
+	fclose( f );
+
+	*size = (int)len;
+
+	return data;
+}
+
+/*
+=================
+Replay_Run
+
+issues every recorded call to stub engine, which counts draws and texture switches
+=================
+*/
+static bool Replay_Run( const ui_enginefuncs_t *engfuncs, const char *filename, replaysummary_t *summary )
+{
+	tracereader_t r;
+	hoststats_t frameStats;
+	HIMAGE *images = NULL;
+	int numImages = 0;
+	bool ok = true, inFrame = false;
+	byte *data;
+
+	memset( summary, 0, sizeof( *summary ));
+	summary->filename = filename;
+	memset( &frameStats, 0, sizeof( frameStats ));
+
+	if( !( data = Replay_LoadFile( filename, &summary->size )))
+	{
+		printf( "Can't read %s\n", filename );
+		return false;
+	}
+
+	r.data = data;
+	r.size = summary->size;
+	r.pos = 0;
+	r.error = false;
+
+	if( r.size < 5 || memcmp( data, DRAWTRACE_MAGIC, 4 ) || data[4] != DRAWTRACE_VERSION )
+	{
+		printf( "%s is not a draw trace or has unsupported version\n", filename );
+		free( data );
+		return false;
+	}
+
+	r.pos = 5;
+	summary->width = Trace_ReadVarint( &r );
+	summary->height = Trace_ReadVarint( &r );
+
+	while( !r.error )
+	{
+		int op = Trace_ReadByte( &r );
+		int rect[4], rgba[4];
+		unsigned int handle;
+		HIMAGE pic;
+
+		if( r.error || op == TRACE_END )
+			break;
+
+		switch( op & TRACE_OPCODE_MASK )
+		{
+		case TRACE_FRAME:
+			Trace_ReadVarint( &r );
+			frameStats = *Host_Stats();
+			Host_BeginFrame();
+			inFrame = true;
+			break;
+		case TRACE_FRAME_END:
+		{
+			const hoststats_t *stats = Host_Stats();
+			double cost = Trace_ReadVarint( &r ) / 1000000.0;
+			replaywindow_t *window;
+			char name[64];
+			int draws, switches;
+
+			Trace_ReadString( &r, name, sizeof( name ));
+			if( !inFrame )
+				break;
+
+			draws = Host_CountDraws( stats ) - Host_CountDraws( &frameStats );
+			switches = stats->numTextureSwitches - frameStats.numTextureSwitches;
+
+			if( cost > summary->maxCost )
+			{
+				summary->maxCost = cost;
+				summary->maxCostFrame = summary->frames;
+				snprintf( summary->maxCostWindow, sizeof( summary->maxCostWindow ), "%s", name );
+			}
+
+			summary->frames++;
+			summary->cost += cost;
+			summary->draws += draws;
+			summary->switches += switches;
+
+			if(( window = Replay_FindWindow( summary, name )) != NULL )
+			{
+				window->frames++;
+				window->cost += cost;
+				window->draws += draws;
+				window->switches += switches;
+				if( cost > window->maxCost )
+					window->maxCost = cost;
+			}
+
+			inFrame = false;
+			break;
+		}
+		case TRACE_IMAGE:
+		{
+			char name[256];
+			int width, height;
+
+			handle = Trace_ReadVarint( &r );
+			width = Trace_ReadVarint( &r );
+			height = Trace_ReadVarint( &r );
+			Trace_ReadString( &r, name, sizeof( name ));
+
+			if( handle >= (1U << 20))
+			{
+				r.error = true;
+				break;
+			}
+
+			if( (int)handle >= numImages )
+			{
+				images = (HIMAGE *)realloc( images, sizeof( HIMAGE ) * ( handle + 1 ));
+				memset( images + numImages, 0, sizeof( HIMAGE ) * ( handle + 1 - numImages ));
+				numImages = handle + 1;
+			}
+
+			images[handle] = Replay_LoadImage( engfuncs, name, handle, width, height );
+			break;
+		}
+		case TRACE_SET:
+			handle = Trace_ReadVarint( &r );
+			Trace_ReadColor( &r, rgba );
+			pic = (int)handle < numImages ? images[handle] : 0;
+			engfuncs->pfnPIC_Set( pic, rgba[0], rgba[1], rgba[2], rgba[3] );
+			break;
+		case TRACE_DRAW:
+		case TRACE_DRAW_HOLES:
+		case TRACE_DRAW_TRANS:
+		case TRACE_DRAW_ADDITIVE:
+		{
+			wrect_t rc, *prc = NULL;
+
+			Trace_ReadRect( &r, rect );
+			if( op & TRACE_HAS_RECT )
+			{
+				rc.left = Trace_ReadInt( &r );
+				rc.right = Trace_ReadInt( &r );
+				rc.top = Trace_ReadInt( &r );
+				rc.bottom = Trace_ReadInt( &r );
+				prc = &rc;
+			}
+
+			switch( op & TRACE_OPCODE_MASK )
+			{
+			case TRACE_DRAW: engfuncs->pfnPIC_Draw( rect[0], rect[1], rect[2], rect[3], prc ); break;
+			case TRACE_DRAW_HOLES: engfuncs->pfnPIC_DrawHoles( rect[0], rect[1], rect[2], rect[3], prc ); break;
+			case TRACE_DRAW_TRANS: engfuncs->pfnPIC_DrawTrans( rect[0], rect[1], rect[2], rect[3], prc ); break;
+			case TRACE_DRAW_ADDITIVE: engfuncs->pfnPIC_DrawAdditive( rect[0], rect[1], rect[2], rect[3], prc ); break;
+			}
+			break;
+		}
+		case TRACE_FILL:
+			Trace_ReadRect( &r, rect );
+			Trace_ReadColor( &r, rgba );
+			engfuncs->pfnFillRGBA( rect[0], rect[1], rect[2], rect[3], rgba[0], rgba[1], rgba[2], rgba[3] );
+			break;
+		case TRACE_SCISSOR:
+			Trace_ReadRect( &r, rect );
+			engfuncs->pfnPIC_EnableScissor( rect[0], rect[1], rect[2], rect[3] );
+			break;
+		case TRACE_NOSCISSOR:
+			engfuncs->pfnPIC_DisableScissor();
+			break;
+		case TRACE_CHAR:
+		{
+			int ch;
+
+			Trace_ReadRect( &r, rect );
+			ch = Trace_ReadVarint( &r );
+			Trace_ReadColor( &r, rgba );
+			handle = Trace_ReadVarint( &r );
+			pic = (int)handle < numImages ? images[handle] : 0;
+			engfuncs->pfnDrawCharacter( rect[0], rect[1], rect[2], rect[3], ch,
+				( rgba[3] << 24 ) | ( rgba[0] << 16 ) | ( rgba[1] << 8 ) | rgba[2], pic );
+			break;
+		}
+		default:
+			printf( "%s: unknown opcode %i at offset %i\n", filename, op, r.pos - 1 );
+			ok = false;
+			r.error = true;
+			break;
+		}
+	}
+
+	if( r.error && ok )
+		printf( "%s: trace is truncated at offset %i\n", filename, r.pos );
+
+	free( images );
+	free( data );
+
+	return ok && summary->frames > 0;
+}
+
+static void Replay_PrintSummary( const replaysummary_t *s )
+{
+	printf( "%s: %i frames at %ix%i, %i bytes\n", s->filename, s->frames, s->width, s->height, s->size );
+	printf( "  menu cost: avg %.3f ms, max %.3f ms at frame %i (%s)\n",
+		s->cost * 1000.0 / s->frames, s->maxCost * 1000.0, s->maxCostFrame, s->maxCostWindow );
+	printf( "  per frame: %.1f draws, %.1f texture switches\n",
+		(float)s->draws / s->frames, (float)s->switches / s->frames );
+
+	printf( "  %-24s %7s %9s %9s %8s %9s\n", "window", "frames", "avg ms", "max ms", "draws", "switches" );
+	for( int i = 0; i < s->numWindows; i++ )
+	{
+		const replaywindow_t *w = &s->windows[i];
+
+		printf( "  %-24s %7i %9.3f %9.3f %8.1f %9.1f\n", w->name, w->frames,
+			w->cost * 1000.0 / w->frames, w->maxCost * 1000.0,
+			(float)w->draws / w->frames, (float)w->switches / w->frames );
+	}
+}
+
+static void Replay_PrintDelta( const char *what, double before, double after )
+{
+	printf( "  %-32s %10.3f %10.3f", what, before, after );
+	if( before != 0.0 )
+		printf( " %+8.1f%%", ( after - before ) * 100.0 / before );
+	printf( "\n" );
+}
+
+/*
+=================
+Replay_PrintDiff
+
+compares two builds, windows are matched by name
+=================
+*/
+static void Replay_PrintDiff( const replaysummary_t *a, const replaysummary_t *b )
+{
+	char what[96];
+
+	printf( "%s -> %s\n", a->filename, b->filename );
+	printf( "  %-32s %10s %10s %9s\n", "", "before", "after", "change" );
+
+	Replay_PrintDelta( "avg cost, ms", a->cost * 1000.0 / a->frames, b->cost * 1000.0 / b->frames );
+	Replay_PrintDelta( "max cost, ms", a->maxCost * 1000.0, b->maxCost * 1000.0 );
+	Replay_PrintDelta( "draws per frame", (double)a->draws / a->frames, (double)b->draws / b->frames );
+	Replay_PrintDelta( "switches per frame", (double)a->switches / a->frames, (double)b->switches / b->frames );
+
+	for( int i = 0; i < a->numWindows; i++ )
+	{
+		const replaywindow_t *wa = &a->windows[i];
+
+		for( int j = 0; j < b->numWindows; j++ )
+		{
+			const replaywindow_t *wb = &b->windows[j];
+
+			if( strcmp( wa->name, wb->name ))
+				continue;
+
+			snprintf( what, sizeof( what ), "%s avg ms", wa->name );
+			Replay_PrintDelta( what, wa->cost * 1000.0 / wa->frames, wb->cost * 1000.0 / wb->frames );
+			snprintf( what, sizeof( what ), "%s draws", wa->name );
+			Replay_PrintDelta( what, (double)wa->draws / wa->frames, (double)wb->draws / wb->frames );
+			break;
+		}
+	}
+}
+
+int Host_ReplayTrace( const ui_enginefuncs_t *engfuncs, const char *filename, const char *difffile )
+{
+	static replaysummary_t before, after;
+
+	if( !Replay_Run( engfuncs, filename, &before ))
+		return 1;
+
+	Replay_PrintSummary( &before );
+
+	if( !difffile )
+		return 0;
+
+	if( !Replay_Run( engfuncs, difffile, &after ))
+		return 1;
+
+	Replay_PrintSummary( &after );
+	Replay_PrintDiff( &before, &after );
+
+	return 0;
+}